@@ -0,0 +1,37 @@
+#include "db/column_family.h"
+
+#include "db/dbimpl.h"
+
+namespace lsmkv {
+
+const char* const KDefaultColumnFamilyName = "default";
+
+ColumnFamilyData::ColumnFamilyData(uint32_t id, const std::string& name,
+                                   const std::string& dbname,
+                                   const Option& option, VersionSet* root)
+    : id(id),
+      name(name),
+      internal_comparator(option.comparator),
+      internal_policies(option),
+      option(AdaptOption(dbname, &internal_comparator, &internal_policies,
+                         option)),
+      mem(nullptr),
+      imm(nullptr),
+      imm_log_number(0),
+      table_cache(new TableCache(dbname, this->option, 0)),
+      vset(new VersionSet(dbname, &this->option, table_cache,
+                          &internal_comparator, &internal_policies, root, id,
+                          name)) {}
+
+ColumnFamilyData::~ColumnFamilyData() {
+  if (mem != nullptr) {
+    mem->Unref();
+  }
+  if (imm != nullptr) {
+    imm->Unref();
+  }
+  delete vset;
+  delete table_cache;
+}
+
+}  // namespace lsmkv
@@ -0,0 +1,49 @@
+#ifndef STORAGE_XDB_DB_COLUMN_FAMILY_H_
+#define STORAGE_XDB_DB_COLUMN_FAMILY_H_
+
+#include "db/format/internal_key.h"
+#include "db/memtable/memtable.h"
+#include "db/sstable/table_cache.h"
+#include "db/version/version.h"
+#include "include/column_family.h"
+
+namespace lsmkv {
+
+// the state of a column family in DBImpl, guarded by DBImpl::mu_.
+struct ColumnFamilyData : public ColumnFamilyHandle {
+  // "option" must have the env, logger and table cache of the DB.
+  // "root" is the VersionSet of the default column family, nullptr
+  // if this is the default one.
+  ColumnFamilyData(uint32_t id, const std::string& name,
+                   const std::string& dbname, const Option& option,
+                   VersionSet* root);
+
+  ColumnFamilyData(const ColumnFamilyData&) = delete;
+  ColumnFamilyData& operator=(const ColumnFamilyData&) = delete;
+
+  ~ColumnFamilyData() override;
+
+  uint32_t GetID() const override { return id; }
+
+  const std::string& GetName() const override { return name; }
+
+  const uint32_t id;
+  const std::string name;
+  const InternalKeyComparator internal_comparator;
+  const InternalFilterPolicies internal_policies;
+  const Option option;
+
+  // in memory cache, written to the log shared by the column families
+  MemTable* mem;
+  MemTable* imm;
+  // the log created when imm is switched, the older logs are not needed
+  // by this column family after imm is flushed.
+  uint64_t imm_log_number;
+
+  TableCache* table_cache;
+  VersionSet* vset;
+};
+
+}  // namespace lsmkv
+
+#endif  // STORAGE_XDB_DB_COLUMN_FAMILY_H_
@@ -1,6 +1,7 @@
 #include "db/dbimpl.h"
 
 #include <algorithm>
+#include <random>
 
 #include "db/log/log_reader.h"
 #include "db/sstable/block_format.h"
@@ -8,21 +9,47 @@
 #include "db/writebatch/writebatch_helper.h"
 #include "include/env.h"
 #include "include/sstable_builder.h"
+#include "include/write_buffer_manager.h"
+#include "util/compression.h"
 #include "util/filename.h"
 
 namespace lsmkv {
 
-const int KNumNonTableCache = 10;
+// report the memtables' memory when it changes by this size
+const size_t KReportUsageInterval = 64 * 1024;
+// the partitions are cached in it if "metadata_cache" is not set
+const size_t KDefaultMetadataCacheSize = 8 * 1024 * 1024;
 
 static size_t TableCacheSize(const Option& option) {
   return option.max_open_file - KNumNonTableCache;
 }
 
+// the sstables must not be silently left uncompressed by a compression
+// which is not linked into this build.
+static Status CheckCompression(const Option& option) {
+  std::vector<CompressType> types = option.level_compress_type;
+  types.push_back(option.compress_type);
+  for (CompressType type : types) {
+    if (!CompressionSupported(type)) {
+      return Status::InvalidArgument(
+          "compress type is not supported by this build: ",
+          std::to_string(static_cast<int>(type)));
+    }
+  }
+  return Status::OK();
+}
+
 struct DBImpl::Writer {
   explicit Writer(Mutex* mu)
-      : batch(nullptr), done(false), sync(false), cv(mu) {}
+      : batch(nullptr),
+        column_families(nullptr),
+        done(false),
+        sync(false),
+        cv(mu) {}
   Status status;
   WriteBatch* batch;
+  // the column families written by batch, nullptr means all of them.
+  const std::set<uint32_t>* column_families;
   bool done;
   bool sync;
   CondVar cv;
@@ -34,13 +61,21 @@ struct DBImpl::CompactionState {
     uint64_t file_size;
     InternalKey smallest;
     InternalKey largest;
+    uint64_t num_entries;
+    uint64_t num_deletions;
+    bool marked_for_compaction;
   };
-  explicit CompactionState(Compaction* c)
-      : compaction(c), out_file(nullptr), builder(nullptr), total_bytes(0) {}
+  CompactionState(Compaction* c, ColumnFamilyData* cfd)
+      : compaction(c),
+        cfd(cfd),
+        out_file(nullptr),
+        builder(nullptr),
+        total_bytes(0) {}
 
   Output* CurrOutput() { return &outputs[outputs.size() - 1]; };
 
   Compaction* const compaction;
+  ColumnFamilyData* const cfd;
   WritableFile* out_file;
   SSTableBuilder* builder;
   std::vector<Output> outputs;
@@ -48,10 +83,11 @@ struct DBImpl::CompactionState {
   uint64_t total_bytes;
 };
 Option AdaptOption(const std::string& name, const InternalKeyComparator* icmp,
-                   const InteralKeyFilterPolicy* ipolicy, const Option& src) {
+                   const InternalFilterPolicies* ipolicies,
+                   const Option& src) {
   Option ret = src;
   ret.comparator = icmp;
-  ret.filter_policy = (src.filter_policy == nullptr ? nullptr : ipolicy);
+  ipolicies->Apply(&ret);
   if (ret.logger == nullptr) {
     src.env->CreatDir(name);
     Status s = src.env->NewLogger(LoggerFileName(name), &ret.logger);
@@ -65,56 +101,208 @@ Option AdaptOption(const std::string& name, const InternalKeyComparator* icmp,
 DBImpl::DBImpl(const Option& option, const std::string& name)
     : name_(name),
       internal_comparator_(option.comparator),
-      internal_policy_(option.filter_policy),
-      option_(
-          AdaptOption(name, &internal_comparator_, &internal_policy_, option)),
+      internal_policies_(option),
+      option_(AdaptOption(name, &internal_comparator_, &internal_policies_,
+                          option)),
       file_lock_(nullptr),
       env_(option.env),
-      mem_(nullptr),
-      imm_(nullptr),
+      table_cache_(option.table_cache != nullptr
+                       ? option.table_cache
+                       : NewLRUCache(TableCacheSize(option_))),
+      metadata_cache_(NewLRUCache(KDefaultMetadataCacheSize)),
+      default_cf_(nullptr),
       log_(nullptr),
       logfile_(nullptr),
       logfile_number_(0),
       last_seq_(0),
       background_cv_(&mu_),
       background_scheduled_(false),
+      switch_scheduled_(false),
+      switch_deferred_(false),
       closed_(false),
       has_imm_(false),
-      table_cache_(new TableCache(name, option_, TableCacheSize(option_))),
-      vset_(
-          new VersionSet(name, &option_, table_cache_, &internal_comparator_)),
-      tmp_batch_(new WriteBatch) {}
+      pause_compaction_outputs_(0),
+      creating_column_family_(false),
+      pending_compaction_(nullptr),
+      reported_usage_(0),
+      next_compaction_cf_(0),
+      vset_(nullptr),
+      db_id_(0),
+      tmp_batch_(new WriteBatch) {
+  mu_.Lock();
+  default_cf_ = AddColumnFamily(0, KDefaultColumnFamilyName, option);
+  mu_.Unlock();
+  vset_ = default_cf_->vset;
+  if (option_.arena_block_pool_size > 0) {
+    ArenaBlockPool::Default()->Reserve(option_.arena_block_pool_size);
+  }
+  if (option_.write_buffer_manager != nullptr) {
+    option_.write_buffer_manager->Register(this, &DBImpl::RequestSwitch);
+  }
+}
 
 DBImpl::~DBImpl() {
+  // no switch is requested after unregistered.
+  if (option_.write_buffer_manager != nullptr) {
+    option_.write_buffer_manager->Unregister(this);
+  }
   mu_.Lock();
   closed_.store(true, std::memory_order_release);
-  while (background_scheduled_) {
+  while (background_scheduled_ ||
+         switch_scheduled_.load(std::memory_order_acquire)) {
     background_cv_.Wait();
   }
   mu_.Unlock();
+  if (option_.arena_block_pool_size > 0) {
+    ArenaBlockPool::Default()->Release(option_.arena_block_pool_size);
+  }
   if (file_lock_ != nullptr) {
     env_->UnlockFile(file_lock_);
   }
-  if (mem_ != nullptr) {
-    mem_->Unref();
+  if (option_.table_cache != nullptr) {
+    // the tables in the shared cache would be never used again.
+    for (ColumnFamilyData* cfd : column_families_) {
+      std::set<uint64_t> live;
+      cfd->vset->AddLiveFiles(&live);
+      for (uint64_t number : live) {
+        cfd->table_cache->Evict(number);
+      }
+    }
   }
-  if (imm_ != nullptr) {
-    imm_->Unref();
+  delete pending_compaction_;
+  // the VersionSet of the default column family is deleted at last,
+  // which is shared by the others.
+  for (size_t i = column_families_.size(); i > 0; i--) {
+    delete column_families_[i - 1];
   }
-  delete vset_;
   delete tmp_batch_;
   delete log_;
   delete logfile_;
-  delete table_cache_;
+  if (option_.table_cache == nullptr) {
+    delete table_cache_;
+  }
+  delete metadata_cache_;
   delete option_.logger;
 }
 
-WriteBatch* DBImpl::MergeBatchGroup(Writer** last_writer) {
+Option DBImpl::ColumnFamilyOption(const Option& option) const {
+  Option ret = option;
+  ret.env = option_.env;
+  ret.logger = option_.logger;
+  ret.table_cache = table_cache_;
+  if (ret.metadata_cache == nullptr && ret.index_partition_size > 0) {
+    ret.metadata_cache = metadata_cache_;
+  }
+  ret.write_buffer_manager = nullptr;
+  return ret;
+}
+
+ColumnFamilyData* DBImpl::AddColumnFamily(uint32_t id, const std::string& name,
+                                          const Option& option) {
+  mu_.AssertHeld();
+  assert(id == column_families_.size());
+  ColumnFamilyData* cfd =
+      new ColumnFamilyData(id, name, name_, ColumnFamilyOption(option),
+                           id == 0 ? nullptr : vset_);
+  cfd->table_cache->SetDBId(db_id_);
+  column_families_.push_back(cfd);
+  return cfd;
+}
+
+Status DBImpl::NewColumnFamily(const std::string& name, const Option& option,
+                               ColumnFamilyData** result) {
+  mu_.AssertHeld();
+  const uint32_t id = column_families_.size();
+  ColumnFamilyData* cfd =
+      new ColumnFamilyData(id, name, name_, ColumnFamilyOption(option), vset_);
+  cfd->table_cache->SetDBId(db_id_);
+  cfd->mem = new MemTable(cfd->internal_comparator, cfd->option);
+  cfd->mem->Ref();
+  VersionEdit edit;
+  edit.AddColumnFamily(name);
+  edit.SetComparatorName(cfd->internal_comparator.UserComparator()->Name());
+  // the column family has no data in the logs before.
+  edit.SetLogNumber(logfile_number_);
+  Status s = cfd->vset->LogAndApply(&edit, &mu_);
+  if (s.ok()) {
+    column_families_.push_back(cfd);
+    *result = cfd;
+    Log(option_.logger, "Create column family %s: id %u", name.data(),
+        static_cast<unsigned>(id));
+  } else {
+    delete cfd;
+  }
+  return s;
+}
+
+ColumnFamilyData* DBImpl::FindColumnFamily(const std::string& name) {
+  mu_.AssertHeld();
+  for (ColumnFamilyData* cfd : column_families_) {
+    if (cfd->name == name) {
+      return cfd;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<MemTable*> DBImpl::MemTables() {
+  mu_.AssertHeld();
+  std::vector<MemTable*> mems;
+  mems.reserve(column_families_.size());
+  for (ColumnFamilyData* cfd : column_families_) {
+    mems.push_back(cfd->mem);
+  }
+  return mems;
+}
+
+uint64_t DBImpl::MinLogNumber() {
+  mu_.AssertHeld();
+  uint64_t min_log = vset_->LogNumber();
+  for (ColumnFamilyData* cfd : column_families_) {
+    min_log = std::min(min_log, cfd->vset->LogNumber());
+  }
+  return min_log;
+}
+
+Status DBImpl::CreateColumnFamily(const Option& option, const std::string& name,
+                                  ColumnFamilyHandle** handle) {
+  Status s = CheckCompression(option);
+  if (!s.ok()) {
+    return s;
+  }
+  MutexLock l(&mu_);
+  // the meta file is written by one thread at a time.
+  while (background_scheduled_ || creating_column_family_) {
+    background_cv_.Wait();
+  }
+  if (FindColumnFamily(name) != nullptr) {
+    return Status::InvalidArgument("column family exists: ", name);
+  }
+  if (!background_status_.ok()) {
+    return background_status_;
+  }
+  creating_column_family_ = true;
+  ColumnFamilyData* cfd = nullptr;
+  s = NewColumnFamily(name, option, &cfd);
+  creating_column_family_ = false;
+  background_cv_.SignalAll();
+  if (s.ok()) {
+    *handle = cfd;
+  }
+  MayScheduleCompaction();
+  return s;
+}
+
+WriteBatch* DBImpl::MergeBatchGroup(Writer** last_writer,
+                                    std::set<uint32_t>* column_families) {
   mu_.AssertHeld();
   assert(!writers_.empty());
   Writer* first = writers_.front();
   WriteBatch* ret = first->batch;
   assert(ret != nullptr);
+  assert(first->column_families != nullptr);
+  column_families->insert(first->column_families->begin(),
+                          first->column_families->end());
 
   size_t size = WriteBatchHelper::GetSize(ret);
 
@@ -143,7 +331,9 @@ WriteBatch* DBImpl::MergeBatchGroup(Writer** last_writer) {
         assert(WriteBatchHelper::GetCount(ret) == 0);
         WriteBatchHelper::Append(ret, first->batch);
       }
-      WriteBatchHelper::Append(ret, first->batch);
+      WriteBatchHelper::Append(ret, w->batch);
+      column_families->insert(w->column_families->begin(),
+                              w->column_families->end());
     }
     *last_writer = w;
   }
@@ -152,14 +342,22 @@ WriteBatch* DBImpl::MergeBatchGroup(Writer** last_writer) {
 
 Status DBImpl::Get(const ReadOption& option, std::string_view key,
                    std::string* value) {
+  return Get(option, default_cf_, key, value);
+}
+
+Status DBImpl::Get(const ReadOption& option, ColumnFamilyHandle* column_family,
+                   std::string_view key, std::string* value) {
+  ColumnFamilyData* cfd =
+      (column_family == nullptr ? default_cf_
+                                : static_cast<ColumnFamilyData*>(column_family));
   Status status;
   MutexLock l(&mu_);
   SequenceNum seq = vset_->LastSequence();
   Version::GetStats stats;
 
-  MemTable* mem = mem_;
-  MemTable* imm = imm_;
-  Version* current = vset_->Current();
+  MemTable* mem = cfd->mem;
+  MemTable* imm = cfd->imm;
+  Version* current = cfd->vset->Current();
 
   mem->Ref();
   if (imm != nullptr) imm->Ref();
@@ -191,37 +389,109 @@ Status DBImpl::Get(const ReadOption& option, std::string_view key,
 }
 
 Status DB::Open(const Option& option, const std::string& name, DB** ptr) {
+  std::vector<ColumnFamilyHandle*> handles;
+  return Open(option, name, std::vector<ColumnFamilyDescriptor>(), &handles,
+              ptr);
+}
+
+Status DB::Open(const Option& option, const std::string& name,
+                const std::vector<ColumnFamilyDescriptor>& families,
+                std::vector<ColumnFamilyHandle*>* handles, DB** ptr) {
   *ptr = nullptr;
+  handles->clear();
+  Status s = CheckCompression(option);
+  for (size_t i = 0; s.ok() && i < families.size(); i++) {
+    s = CheckCompression(families[i].option);
+  }
+  if (!s.ok()) {
+    return s;
+  }
 
   DBImpl* impl = new DBImpl(option, name);
   impl->mu_.Lock();
-  VersionEdit edit;
-  Status s = impl->Recover(&edit);
+  std::vector<VersionEdit> edits;
+  s = impl->Recover(families, &edits);
   if (s.ok()) {
     WritableFile* log_file;
     uint64_t log_number = impl->vset_->NextFileNumber();
     s = option.env->NewWritableFile(LogFileName(name, log_number), &log_file);
     if (s.ok()) {
-      edit.SetLogNumber(log_number);
       impl->logfile_ = log_file;
       impl->logfile_number_ = log_number;
       impl->log_ = new log::Writer(log_file);
-      impl->mem_ = new MemTable(impl->internal_comparator_);
-      impl->mem_->Ref();
+      for (ColumnFamilyData* cfd : impl->column_families_) {
+        edits[cfd->id].SetLogNumber(log_number);
+        cfd->mem = new MemTable(cfd->internal_comparator, cfd->option);
+        cfd->mem->Ref();
+      }
     }
   }
-  if (s.ok()) {
-    s = impl->vset_->LogAndApply(&edit, &impl->mu_);
+  // the default column family is logged first, which writes the
+  // snapshot of all the column families into the new meta file.
+  for (size_t i = 0; s.ok() && i < impl->column_families_.size(); i++) {
+    ColumnFamilyData* cfd = impl->column_families_[i];
+    s = cfd->vset->LogAndApply(&edits[cfd->id], &impl->mu_);
+  }
+  for (size_t i = 0; s.ok() && i < families.size(); i++) {
+    ColumnFamilyData* cfd = impl->FindColumnFamily(families[i].name);
+    if (cfd == nullptr) {
+      s = impl->NewColumnFamily(families[i].name, families[i].option, &cfd);
+    }
+    if (s.ok()) {
+      handles->push_back(cfd);
+    }
+  }
+  if (s.ok() && impl->pending_compaction_ != nullptr) {
+    impl->MayScheduleCompaction();
   }
   impl->mu_.Unlock();
   if (s.ok()) {
     *ptr = impl;
   } else {
+    handles->clear();
     delete impl;
   }
   return s;
 }
 
+std::vector<Status> DB::MultiGet(const ReadOption& option,
+                                 const std::vector<std::string_view>& keys,
+                                 std::vector<std::string>* values) {
+  std::vector<Status> ret(keys.size());
+  values->resize(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    ret[i] = Get(option, keys[i], &(*values)[i]);
+  }
+  return ret;
+}
+
+Status DB::CreateColumnFamily(const Option& option, const std::string& name,
+                              ColumnFamilyHandle** handle) {
+  return Status::InvalidArgument("column family is not supported");
+}
+
+Status DB::Get(const ReadOption& option, ColumnFamilyHandle* column_family,
+               std::string_view key, std::string* value) {
+  if (column_family != nullptr) {
+    return Status::InvalidArgument("column family is not supported");
+  }
+  return Get(option, key, value);
+}
+
+Status DB::Put(const WriteOption& option, ColumnFamilyHandle* column_family,
+               std::string_view key, std::string_view value) {
+  WriteBatch batch;
+  batch.Put(column_family, key, value);
+  return Write(option, &batch);
+}
+
+Status DB::Delete(const WriteOption& option, ColumnFamilyHandle* column_family,
+                  std::string_view key) {
+  WriteBatch batch;
+  batch.Delete(column_family, key);
+  return Write(option, &batch);
+}
+
 Status DBImpl::Put(const WriteOption& option, std::string_view key,
                    std::string_view value) {
   WriteBatch batch;
@@ -235,6 +505,20 @@ Status DBImpl::Delete(const WriteOption& option, std::string_view key) {
   return Write(option, &batch);
 }
 
+Status DBImpl::Put(const WriteOption& option, ColumnFamilyHandle* column_family,
+                   std::string_view key, std::string_view value) {
+  WriteBatch batch;
+  batch.Put(column_family, key, value);
+  return Write(option, &batch);
+}
+
+Status DBImpl::Delete(const WriteOption& option,
+                      ColumnFamilyHandle* column_family, std::string_view key) {
+  WriteBatch batch;
+  batch.Delete(column_family, key);
+  return Write(option, &batch);
+}
+
 Status DBImpl::Write(const WriteOption& option, WriteBatch* batch) {
   Writer w(&mu_);
   w.batch = batch;
@@ -243,6 +527,22 @@ Status DBImpl::Write(const WriteOption& option, WriteBatch* batch) {
 
   MutexLock l(&mu_);
 
+  // the default column family is the only one written by a batch without
+  // column family records.
+  static const std::set<uint32_t> default_only{0};
+  const std::set<uint32_t>* write_families =
+      (batch == nullptr ? nullptr : &default_only);
+  std::set<uint32_t> batch_families;
+  if (batch != nullptr && WriteBatchHelper::HasColumnFamily(batch)) {
+    // a record of an invalid column family would make the log unreadable.
+    ColumnFamilyChecker checker(column_families_.size(), &batch_families);
+    Status s = batch->Iterate(&checker);
+    if (!s.ok()) {
+      return s;
+    }
+    write_families = &batch_families;
+  }
+  w.column_families = write_families;
   writers_.push_back(&w);
   while (!w.done && &w != writers_.front()) {
     w.cv.Wait();
@@ -251,15 +551,23 @@ Status DBImpl::Write(const WriteOption& option, WriteBatch* batch) {
     return w.status;
   }
 
-  // merge the writebatch
-  Status status;
-  status = MakeRoomForWrite();
+  // merge the writebatch, the stall check covers the column families of
+  // all the merged batches.
   Writer* last_writer = &w;
+  WriteBatch* merged_batch = nullptr;
+  std::set<uint32_t> group_families;
+  if (batch != nullptr) {
+    merged_batch = MergeBatchGroup(&last_writer, &group_families);
+    write_families = &group_families;
+  }
+  Status status;
+  status = MakeRoomForWrite(write_families);
   SequenceNum last_seq = vset_->LastSequence();
   if (batch != nullptr) {
-    WriteBatch* merged_batch = MergeBatchGroup(&last_writer);
     WriteBatchHelper::SetSequenceNum(merged_batch, last_seq + 1);
     last_seq += WriteBatchHelper::GetCount(merged_batch);
+    // the memtables are not switched until the leader is done.
+    const std::vector<MemTable*> mems = MemTables();
     {
       // only one thread can reach here once time
       mu_.Unlock();
@@ -272,7 +580,7 @@ Status DBImpl::Write(const WriteOption& option, WriteBatch* batch) {
         }
       }
       if (status.ok()) {
-        status = WriteBatchHelper::InsertMemTable(merged_batch, mem_);
+        status = WriteBatchHelper::InsertMemTables(merged_batch, mems);
       }
       mu_.Lock();
       if (sync_error) {
@@ -296,55 +604,175 @@ Status DBImpl::Write(const WriteOption& option, WriteBatch* batch) {
   }
   if (!writers_.empty()) {
     writers_.front()->cv.Signal();
+  } else if (switch_deferred_) {
+    switch_deferred_ = false;
+    RequestSwitch(this);
   }
   // std::cout<<"thread "<< std::this_thread::get_id() <<"done" <<std::endl;
   return status;
 }
 
-Status DBImpl::MakeRoomForWrite() {
+void DBImpl::ReportMemoryUsage(bool force) {
+  mu_.AssertHeld();
+  WriteBufferManager* manager = option_.write_buffer_manager;
+  if (manager == nullptr) {
+    return;
+  }
+  size_t mutable_usage = 0;
+  size_t total_usage = 0;
+  for (ColumnFamilyData* cfd : column_families_) {
+    const size_t mem_usage =
+        (cfd->mem == nullptr ? 0 : cfd->mem->ApproximateSize());
+    mutable_usage += mem_usage;
+    total_usage +=
+        mem_usage + (cfd->imm == nullptr ? 0 : cfd->imm->ApproximateSize());
+  }
+  // avoid locking the manager on every write.
+  const size_t diff = (total_usage > reported_usage_
+                           ? total_usage - reported_usage_
+                           : reported_usage_ - total_usage);
+  if (force || diff >= KReportUsageInterval) {
+    manager->UpdateUsage(this, mutable_usage, total_usage);
+    reported_usage_ = total_usage;
+  }
+}
+
+ColumnFamilyData* DBImpl::ColumnFamilyToSwitch(bool force_switch) {
+  mu_.AssertHeld();
+  ColumnFamilyData* largest = nullptr;
+  for (ColumnFamilyData* cfd : column_families_) {
+    const size_t size = cfd->mem->ApproximateSize();
+    if (size > cfd->option.write_mem_size) {
+      return cfd;
+    }
+    if (largest == nullptr || size > largest->mem->ApproximateSize()) {
+      largest = cfd;
+    }
+  }
+  // the write buffer manager asks to switch the largest memtable,
+  // ignored if it is almost empty.
+  if (force_switch &&
+      largest->mem->ApproximateSize() > largest->option.arena_block_size) {
+    return largest;
+  }
+  return nullptr;
+}
+
+Status DBImpl::MakeRoomForWrite(const std::set<uint32_t>* column_families) {
   mu_.AssertHeld();
   Status s;
+  bool force_switch = false;
+  if (option_.write_buffer_manager != nullptr) {
+    ReportMemoryUsage(false);
+    force_switch = option_.write_buffer_manager->ShouldSwitch(this);
+  }
   while (true) {
+    ColumnFamilyData* cfd = nullptr;
+    // a column family with too many level-0 files doesn't stall the
+    // writes to the others.
+    bool l0_stop = false;
+    for (ColumnFamilyData* c : column_families_) {
+      if (column_families != nullptr && column_families->count(c->id) == 0) {
+        continue;
+      }
+      l0_stop = l0_stop || c->vset->LevelFileNum(0) >=
+                               static_cast<uint64_t>(
+                                   c->option.l0_stop_write_threshold);
+    }
     if (!background_status_.ok()) {
       s = background_status_;
       break;
-    } else if (vset_->LevelFileNum(0) >= config::kL0StopWriteThreshold) {
+    } else if (l0_stop) {
       // a memtable is being compact as SStable
       Log(option_.logger, "Too many level-0 files. waiting...\n");
       background_cv_.Wait();
-    } else if (mem_->ApproximateSize() <= option_.write_mem_size) {
+    } else if ((cfd = ColumnFamilyToSwitch(force_switch)) == nullptr) {
       // there is enough room for write
       break;
-    } else if (imm_ != nullptr) {
+    } else if (force_switch && cfd->imm != nullptr) {
+      // the memory will be freed by the flush of imm soon,
+      // don't stall the write for the switch.
+      break;
+    } else if (cfd->imm != nullptr) {
       // a memtable is being compact as SStable
       background_cv_.Wait();
     } else {
-      uint64_t log_number = vset_->NextFileNumber();
-      WritableFile* file;
-      s = env_->NewWritableFile(LogFileName(name_, log_number), &file);
+      s = SwitchMemTable(cfd);
       if (!s.ok()) {
         break;
       }
-      delete log_;
-      s = logfile_->Close();
+      force_switch = false;
+    }
+  }
+  return s;
+}
+
+Status DBImpl::SwitchMemTable(ColumnFamilyData* cfd) {
+  mu_.AssertHeld();
+  assert(cfd->imm == nullptr);
+  uint64_t log_number = vset_->NextFileNumber();
+  WritableFile* file;
+  Status s = env_->NewWritableFile(LogFileName(name_, log_number), &file);
+  if (!s.ok()) {
+    return s;
+  }
+  delete log_;
+  s = logfile_->Close();
+  if (!s.ok()) {
+    RecordBackgroundError(s);
+  }
+  delete logfile_;
+
+  logfile_ = file;
+  logfile_number_ = log_number;
+  log_ = new log::Writer(file);
+  // the other column families keep their memtables,
+  // whose records are in the older logs.
+  cfd->imm = cfd->mem;
+  cfd->imm_log_number = log_number;
+  cfd->mem = new MemTable(cfd->internal_comparator, cfd->option);
+  cfd->mem->Ref();
+  has_imm_.store(true, std::memory_order_release);
+  ReportMemoryUsage(true);
+  MayScheduleCompaction();
+  return Status::OK();
+}
+
+void DBImpl::RequestSwitch(const void* db) {
+  DBImpl* impl = const_cast<DBImpl*>(reinterpret_cast<const DBImpl*>(db));
+  if (!impl->switch_scheduled_.exchange(true, std::memory_order_acq_rel)) {
+    impl->env_->Schedule(&DBImpl::BackgroundSwitchCall, impl);
+  }
+}
+
+void DBImpl::BackgroundSwitchCall(void* db) {
+  reinterpret_cast<DBImpl*>(db)->BackgroundSwitch();
+}
+
+void DBImpl::BackgroundSwitch() {
+  MutexLock l(&mu_);
+  if (closed_.load(std::memory_order_acquire) || !background_status_.ok()) {
+    // nothing to do
+  } else if (!writers_.empty()) {
+    // the leader may be writing the log without mu_, the log can't be
+    // switched here.
+    switch_deferred_ = true;
+  } else if (option_.write_buffer_manager->ShouldSwitch(this)) {
+    ColumnFamilyData* cfd = ColumnFamilyToSwitch(true);
+    // the memory is freed by the flush of imm if it is not nullptr.
+    if (cfd != nullptr && cfd->imm == nullptr) {
+      Status s = SwitchMemTable(cfd);
       if (!s.ok()) {
         RecordBackgroundError(s);
       }
-      delete logfile_;
-
-      logfile_ = file;
-      log_ = new log::Writer(file);
-      imm_ = mem_;
-      mem_ = new MemTable(internal_comparator_);
-      mem_->Ref();
-      has_imm_.store(true, std::memory_order_release);
-      MayScheduleCompaction();
     }
   }
-  return s;
+  switch_scheduled_.store(false, std::memory_order_release);
+  background_cv_.SignalAll();
 }
 
-Status DBImpl::Recover(VersionEdit* edit) {
+Status DBImpl::Recover(const std::vector<ColumnFamilyDescriptor>& families,
+                       std::vector<VersionEdit>* edits) {
   mu_.AssertHeld();
 
   // Check if the DB is locked, to avoid multi-user access.
@@ -361,12 +789,42 @@ Status DBImpl::Recover(VersionEdit* edit) {
       return Status::Corruption("DB initialize fail");
     }
   }
+  s = RecoverIdentity();
+  if (!s.ok()) {
+    return s;
+  }
+
+  // every column family in the meta file must be opened.
+  std::map<uint32_t, std::string> existing;
+  s = vset_->ListColumnFamilies(&existing);
+  if (!s.ok()) {
+    return s;
+  }
+  for (const auto& family : existing) {
+    if (family.first != column_families_.size()) {
+      return Status::Corruption("column family id is not continuous");
+    }
+    auto it = std::find_if(families.begin(), families.end(),
+                           [&family](const ColumnFamilyDescriptor& desc) {
+                             return desc.name == family.second;
+                           });
+    if (it == families.end()) {
+      return Status::InvalidArgument("column family is not opened: ",
+                                     family.second);
+    }
+    AddColumnFamily(family.first, family.second, it->option);
+  }
 
   s = vset_->Recover();
   if (!s.ok()) {
     return s;
   }
-  uint64_t min_log = vset_->LogNumber();
+  s = RecoverCompactionProgress();
+  if (!s.ok()) {
+    return s;
+  }
+  edits->resize(column_families_.size());
+  uint64_t min_log = MinLogNumber();
   uint64_t number;
   FileType type;
   std::vector<uint64_t> log_numbers;
@@ -386,7 +844,7 @@ Status DBImpl::Recover(VersionEdit* edit) {
 
   SequenceNum max_sequence(0);
   for (size_t i = 0; i < log_numbers.size(); i++) {
-    s = RecoverLogFile(log_numbers[i], &max_sequence, edit);
+    s = RecoverLogFile(log_numbers[i], &max_sequence, edits);
     if (!s.ok()) {
       return s;
     }
@@ -398,6 +856,77 @@ Status DBImpl::Recover(VersionEdit* edit) {
   return Status::OK();
 }
 
+Status DBImpl::RecoverCompactionProgress() {
+  mu_.AssertHeld();
+  const std::string filename = CompactionFileName(name_);
+  if (!env_->FileExist(filename)) {
+    return Status::OK();
+  }
+  std::string content;
+  CompactionProgress* progress = new CompactionProgress;
+  Status s = ReadStringFromFile(env_, &content, filename);
+  if (s.ok()) {
+    s = progress->DecodeFrom(content);
+  }
+  bool resumable = s.ok() && option_.resumable_compaction &&
+                   progress->column_family < column_families_.size();
+  for (size_t i = 0; resumable && i < progress->outputs.size(); i++) {
+    const FileMeta& output = progress->outputs[i];
+    uint64_t file_size;
+    resumable = env_->FileSize(SSTableFileName(name_, output.number),
+                               &file_size)
+                    .ok() &&
+                file_size == output.file_size;
+  }
+  if (resumable) {
+    Compaction* c = column_families_[progress->column_family]
+                        ->vset->ResumeCompaction(*progress);
+    resumable = (c != nullptr);
+    delete c;
+  }
+  if (!resumable) {
+    // the progress is useless, its outputs are cleaned as garbage.
+    Log(option_.logger, "Discard compaction progress: %s",
+        s.ToString().data());
+    delete progress;
+    env_->RemoveFile(filename);
+    return Status::OK();
+  }
+  for (const FileMeta& output : progress->outputs) {
+    files_writing_.insert(output.number);
+    vset_->MarkFileNumberUsed(output.number);
+  }
+  Log(option_.logger, "Recover compaction progress: %d outputs finished",
+      static_cast<int>(progress->outputs.size()));
+  pending_compaction_ = progress;
+  return Status::OK();
+}
+
+Status DBImpl::RecoverIdentity() {
+  mu_.AssertHeld();
+  const std::string filename = IdentityFileName(name_);
+  std::string content;
+  Status s;
+  if (env_->FileExist(filename)) {
+    s = ReadStringFromFile(env_, &content, filename);
+    std::string_view input = content;
+    if (s.ok() && (!ParseNumder(&input, &db_id_) || db_id_ == 0)) {
+      s = Status::Corruption("bad identity file: ", filename);
+    }
+  } else {
+    std::random_device rd;
+    while (db_id_ == 0) {
+      db_id_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+    s = WriteStringToFileSync(env_, std::to_string(db_id_), filename);
+  }
+  if (s.ok()) {
+    // the default column family is created before the id is known.
+    default_cf_->table_cache->SetDBId(db_id_);
+  }
+  return s;
+}
+
 Status DBImpl::Initialize() {
   VersionEdit edit;
   edit.SetComparatorName(internal_comparator_.UserComparator()->Name());
@@ -432,7 +961,7 @@ Status DBImpl::Initialize() {
 }
 
 Status DBImpl::RecoverLogFile(uint64_t number, SequenceNum* max_sequence,
-                              VersionEdit* edit) {
+                              std::vector<VersionEdit>* edits) {
   mu_.AssertHeld();
 
   std::string filename = LogFileName(name_, number);
@@ -445,14 +974,18 @@ Status DBImpl::RecoverLogFile(uint64_t number, SequenceNum* max_sequence,
   std::string buffer;
   std::string_view record;
   WriteBatch batch;
-  MemTable* mem = nullptr;
+  // the records of a column family are skipped if they have been
+  // flushed, which is known by its log number.
+  std::vector<MemTable*> mems(column_families_.size(), nullptr);
   while (reader.ReadRecord(&record, &buffer)) {
     WriteBatchHelper::SetContent(&batch, record);
-    if (mem == nullptr) {
-      mem = new MemTable(internal_comparator_);
-      mem->Ref();
+    for (ColumnFamilyData* cfd : column_families_) {
+      if (mems[cfd->id] == nullptr && number >= cfd->vset->LogNumber()) {
+        mems[cfd->id] = new MemTable(cfd->internal_comparator, cfd->option);
+        mems[cfd->id]->Ref();
+      }
     }
-    s = WriteBatchHelper::InsertMemTable(&batch, mem);
+    s = WriteBatchHelper::InsertMemTables(&batch, mems);
     if (!s.ok()) {
       break;
     }
@@ -462,22 +995,31 @@ Status DBImpl::RecoverLogFile(uint64_t number, SequenceNum* max_sequence,
       *max_sequence = last_seq;
     }
 
-    if (mem->ApproximateSize() > option_.write_mem_size) {
-      s = WriteLevel0SSTable(mem, edit);
-      mem->Unref();
-      mem = nullptr;
-      if (!s.ok()) {
-        break;
+    for (ColumnFamilyData* cfd : column_families_) {
+      MemTable* mem = mems[cfd->id];
+      if (mem != nullptr &&
+          mem->ApproximateSize() > cfd->option.write_mem_size) {
+        s = WriteLevel0SSTable(cfd, mem, &(*edits)[cfd->id]);
+        mem->Unref();
+        mems[cfd->id] = nullptr;
+        if (!s.ok()) {
+          break;
+        }
       }
     }
+    if (!s.ok()) {
+      break;
+    }
   }
 
-  if (mem != nullptr) {
-    if (s.ok()) {
-      s = WriteLevel0SSTable(mem, edit);
+  for (ColumnFamilyData* cfd : column_families_) {
+    MemTable* mem = mems[cfd->id];
+    if (mem != nullptr) {
+      if (s.ok() && mem->NumEntries() > 0) {
+        s = WriteLevel0SSTable(cfd, mem, &(*edits)[cfd->id]);
+      }
+      mem->Unref();
     }
-    mem->Unref();
-    mem = nullptr;
   }
   delete file;
   return s;
@@ -512,29 +1054,33 @@ Status DestoryDB(const Option& option, const std::string& name) {
   return s;
 }
 
-Status DBImpl::WriteLevel0SSTable(MemTable* mem, VersionEdit* edit) {
+Status DBImpl::WriteLevel0SSTable(ColumnFamilyData* cfd, MemTable* mem,
+                                  VersionEdit* edit) {
   mu_.AssertHeld();
   FileMeta meta;
   meta.number = vset_->NextFileNumber();
   files_writing_.insert(meta.number);
   Iterator* iter = mem->NewIterator();
 
-  Log(option_.logger, "Level 0 SSTable #%llu: creating, level-0 num is %d",
-      (unsigned long long)meta.number, vset_->LevelFileNum(0));
+  Log(option_.logger,
+      "Level 0 SSTable #%llu of %s: creating, level-0 num is %d",
+      (unsigned long long)meta.number, cfd->name.data(),
+      cfd->vset->LevelFileNum(0));
 
   Status s;
   {
     mu_.Unlock();
-    s = BuildSSTable(name_, option_, table_cache_, iter, &meta);
+    s = BuildSSTable(name_, cfd->option, cfd->table_cache, iter, &meta);
     mu_.Lock();
   }
-  Log(option_.logger, "Level 0 SSTable #%llu: done, level-0 num is %d",
-      (unsigned long long)meta.number, vset_->LevelFileNum(0));
+  Log(option_.logger, "Level 0 SSTable #%llu of %s: done, level-0 num is %d",
+      (unsigned long long)meta.number, cfd->name.data(),
+      cfd->vset->LevelFileNum(0));
   delete iter;
   files_writing_.erase(meta.number);
 
   if (s.ok() && meta.file_size > 0) {
-    edit->AddFile(0, meta.number, meta.file_size, meta.smallest, meta.largest);
+    edit->AddFile(0, meta);
   }
   return s;
 }
@@ -546,7 +1092,10 @@ void DBImpl::MayScheduleCompaction() {
     // only one compaction could running
   } else if (!background_status_.ok()) {
     // compaction cause a error
-  } else if (imm_ == nullptr && !vset_->NeedCompaction()) {
+  } else if (creating_column_family_) {
+    // the meta file is being written
+  } else if (!has_imm_.load(std::memory_order_relaxed) &&
+             pending_compaction_ == nullptr && !NeedCompaction()) {
     // noting to do
   } else {
     background_scheduled_ = true;
@@ -554,6 +1103,16 @@ void DBImpl::MayScheduleCompaction() {
   }
 }
 
+bool DBImpl::NeedCompaction() {
+  mu_.AssertHeld();
+  for (ColumnFamilyData* cfd : column_families_) {
+    if (cfd->vset->NeedCompaction()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void DBImpl::CompactionSchedule(void* db) {
   reinterpret_cast<DBImpl*>(db)->BackgroundCompactionCall();
 }
@@ -571,34 +1130,97 @@ void DBImpl::BackgroundCompactionCall() {
   MayScheduleCompaction();
   background_cv_.SignalAll();
 }
+
+Status DBImpl::TEST_WaitForBackgroundWork() {
+  MutexLock l(&mu_);
+  MayScheduleCompaction();
+  while ((background_scheduled_ ||
+          switch_scheduled_.load(std::memory_order_acquire)) &&
+         background_status_.ok()) {
+    background_cv_.Wait();
+  }
+  return background_status_;
+}
+
+DBImpl::CompactionStats DBImpl::TEST_CompactionStats() {
+  MutexLock l(&mu_);
+  return compaction_stats_;
+}
+
+void DBImpl::TEST_PauseCompactionAfter(int outputs) {
+  pause_compaction_outputs_.store(outputs, std::memory_order_release);
+}
+
 Status DBImpl::DoCompactionLevel(CompactionState* state) {
   mu_.AssertHeld();
 
   Log(option_.logger, "Compaction SStable level-%d's %s to level-%d's %s",
       state->compaction->level(), state->compaction->InputToString(0).data(),
-      state->compaction->level() + 1,
+      state->compaction->output_level(),
       state->compaction->InputToString(1).data());
-  Iterator* input = vset_->MakeMergedIterator(state->compaction);
+  ColumnFamilyData* const cfd = state->cfd;
+  Iterator* input = cfd->vset->MakeMergedIterator(state->compaction);
 
   mu_.Unlock();
-  input->SeekToFirst();
+  const bool resumed = !state->outputs.empty();
+  const size_t resumed_outputs = state->outputs.size();
   Status s;
+  if (state->compaction->output_level() == 0) {
+    // the output of intra level-0 compaction must be numbered before
+    // the memtables flushed during the compaction, which are newer.
+    s = OpenCompactionSSTable(state);
+  }
   ParsedInternalKey ikey;
   std::string last_user_key;
   bool has_last_user_key = false;
-  bool same_key = false;
-  const Comparator* ucmp = internal_comparator_.UserComparator();
-  while (input->Valid() && !closed_.load(std::memory_order_acquire)) {
+  const Comparator* ucmp = cfd->internal_comparator.UserComparator();
+  if (!resumed) {
+    input->SeekToFirst();
+  } else {
+    // resumed compaction, skip the records in the finished outputs.
+    const InternalKey& resume_key = state->CurrOutput()->largest;
+    input->Seek(resume_key.Encode());
+    if (input->Valid() &&
+        cfd->internal_comparator.Compare(input->Key(), resume_key.Encode()) ==
+            0) {
+      input->Next();
+    }
+    has_last_user_key = true;
+    last_user_key.assign(resume_key.user_key().data(),
+                         resume_key.user_key().size());
+  }
+  while (s.ok() && input->Valid() &&
+         !closed_.load(std::memory_order_acquire)) {
     if (has_imm_.load(std::memory_order_acquire)) {
       mu_.Lock();
-      if (imm_ != nullptr) {
-        CompactionMemtable();
-        background_cv_.SignalAll();
-      }
+      CompactionMemtables();
+      background_cv_.SignalAll();
       mu_.Unlock();
     }
+    const int pause_outputs =
+        pause_compaction_outputs_.load(std::memory_order_acquire);
+    if (pause_outputs > 0 && state->compaction->output_level() != 0 &&
+        state->builder == nullptr &&
+        state->outputs.size() - resumed_outputs >=
+            static_cast<size_t>(pause_outputs)) {
+      // the memtables are still flushed while waiting for the close.
+      pause_compaction_outputs_.store(0, std::memory_order_release);
+      while (!closed_.load(std::memory_order_acquire)) {
+        if (has_imm_.load(std::memory_order_acquire)) {
+          mu_.Lock();
+          CompactionMemtables();
+          background_cv_.SignalAll();
+          mu_.Unlock();
+        }
+        env_->SleepMicroseconds(1000);
+      }
+      continue;
+    }
     std::string_view key = input->Key();
-    if (state->compaction->StopBefore(key) && state->builder != nullptr) {
+    const uint64_t output_size =
+        (state->builder == nullptr ? 0 : state->builder->FileSize());
+    if (state->compaction->StopBefore(key, output_size) &&
+        state->builder != nullptr) {
       s = FinishCompactionSSTable(state, input);
       if (!s.ok()) {
         break;
@@ -608,21 +1230,19 @@ Status DBImpl::DoCompactionLevel(CompactionState* state) {
       s = Status::Corruption("DoCompactionLevel: parse key error");
       break;
     }
-    if (!has_last_user_key ||
-        ucmp->Compare(last_user_key, ikey.user_key_) != 0) {
-      has_last_user_key = true;
-      last_user_key.assign(ikey.user_key_.data(), ikey.user_key_.size());
-      same_key = true;
-    }
     bool drop = false;
-    if (same_key) {
+    if (has_last_user_key &&
+        ucmp->Compare(last_user_key, ikey.user_key_) == 0) {
       // hidden the lower sequence for same key
       drop = true;
-    } else if (ikey.type_ == KTypeDeletion &&
-               state->compaction->IsBaseLevelForKey(ikey.user_key_)) {
-      drop = true;
+    } else {
+      has_last_user_key = true;
+      last_user_key.assign(ikey.user_key_.data(), ikey.user_key_.size());
+      if (ikey.type_ == KTypeDeletion &&
+          state->compaction->IsBaseLevelForKey(ikey.user_key_)) {
+        drop = true;
+      }
     }
-    same_key = false;
     if (!drop) {
       if (state->builder == nullptr) {
         s = OpenCompactionSSTable(state);
@@ -646,6 +1266,10 @@ Status DBImpl::DoCompactionLevel(CompactionState* state) {
     input->Next();
   }
   if (s.ok() && closed_.load(std::memory_order_acquire)) {
+    if (option_.resumable_compaction && state->builder != nullptr) {
+      // keep the written records, they are not compacted again.
+      FinishCompactionSSTable(state, input);
+    }
     s = Status::Corruption("Delete DB during compaction");
   }
   if (s.ok() && state->builder != nullptr) {
@@ -664,6 +1288,10 @@ Status DBImpl::DoCompactionLevel(CompactionState* state) {
   if (s.ok()) {
     s = LogCompactionResult(state);
   }
+  if (s.ok() && option_.resumable_compaction &&
+      env_->FileExist(CompactionFileName(name_))) {
+    env_->RemoveFile(CompactionFileName(name_));
+  }
   if (!s.ok()) {
     RecordBackgroundError(s);
   }
@@ -671,32 +1299,80 @@ Status DBImpl::DoCompactionLevel(CompactionState* state) {
 }
 void DBImpl::BackgroundCompaction() {
   mu_.AssertHeld();
-  if (imm_ != nullptr) {
-    CompactionMemtable();
-    return;
+  for (ColumnFamilyData* cfd : column_families_) {
+    if (cfd->imm != nullptr) {
+      CompactionMemtable(cfd);
+      return;
+    }
   }
   Compaction* c = nullptr;
-  c = vset_->PickCompaction();
+  ColumnFamilyData* cfd = nullptr;
+  CompactionProgress* progress = pending_compaction_;
+  pending_compaction_ = nullptr;
+  if (progress != nullptr) {
+    cfd = column_families_[progress->column_family];
+    c = cfd->vset->ResumeCompaction(*progress);
+    if (c == nullptr) {
+      for (const FileMeta& output : progress->outputs) {
+        files_writing_.erase(output.number);
+      }
+      delete progress;
+      progress = nullptr;
+      env_->RemoveFile(CompactionFileName(name_));
+    }
+  }
+  // pick the column families in turn
+  for (size_t i = 0; c == nullptr && i < column_families_.size(); i++) {
+    cfd = column_families_[next_compaction_cf_ % column_families_.size()];
+    next_compaction_cf_++;
+    c = cfd->vset->PickCompaction();
+  }
 
   Status s;
   if (c == nullptr) {
     // nothing to do
-  } else if (c->SingalMove()) {
-    FileMeta* meta = c->input(0, 0);
-    c->edit()->DeleteFile(c->level(), meta->number);
-    c->edit()->AddFile(c->level() + 1, meta->number, meta->file_size,
-                       meta->smallest, meta->largest);
-    s = vset_->LogAndApply(c->edit(), &mu_);
+  } else if (progress == nullptr && c->IsTrivialMove()) {
+    for (size_t i = 0; i < c->InputFilesNum(0); i++) {
+      FileMeta* meta = c->input(0, i);
+      c->edit()->DeleteFile(c->level(), meta->number);
+      c->edit()->AddFile(c->output_level(), *meta);
+    }
+    s = cfd->vset->LogAndApply(c->edit(), &mu_);
     if (!s.ok()) {
       RecordBackgroundError(s);
+    } else if (c->InputFilesNum(0) > 1) {
+      compaction_stats_.multi_file_trivial_moves++;
     }
-    Log(option_.logger, "Singal move SStable #%d level-%d to level-%d",
-        meta->number, c->level(), c->level() + 1);
+    Log(option_.logger, "Trivial move SStable %s level-%d to level-%d",
+        c->InputToString(0).data(), c->level(), c->output_level());
   } else {
-    CompactionState* state = new CompactionState(c);
+    CompactionState* state = new CompactionState(c, cfd);
+    if (progress != nullptr) {
+      for (const FileMeta& meta : progress->outputs) {
+        CompactionState::Output output;
+        output.number = meta.number;
+        output.file_size = meta.file_size;
+        output.smallest = meta.smallest;
+        output.largest = meta.largest;
+        output.num_entries = meta.num_entries;
+        output.num_deletions = meta.num_deletions;
+        output.marked_for_compaction = meta.marked_for_compaction;
+        state->outputs.push_back(output);
+        state->total_bytes += meta.file_size;
+      }
+      Log(option_.logger, "Resume compaction with %d finished outputs",
+          static_cast<int>(progress->outputs.size()));
+      compaction_stats_.resumed_outputs +=
+          static_cast<int>(progress->outputs.size());
+      delete progress;
+    }
     s = DoCompactionLevel(state);
     if (!s.ok()) {
       RecordBackgroundError(s);
+    } else if (c->output_level() == 0) {
+      compaction_stats_.intra_l0_compactions++;
+    } else if (c->deletion_compaction()) {
+      compaction_stats_.deletion_compactions++;
     }
     CleanCompaction(state);
     c->ReleaseInput();
@@ -722,41 +1398,90 @@ Status DBImpl::LogCompactionResult(CompactionState* state) {
   mu_.AssertHeld();
   Log(option_.logger, "Compaction SStable level-%d's %s to level-%d's %s OVER",
       state->compaction->level(), state->compaction->InputToString(0).data(),
-      state->compaction->level() + 1,
+      state->compaction->output_level(),
       state->compaction->InputToString(1).data());
   state->compaction->AddInputDeletions(state->compaction->edit());
-  const int level = state->compaction->level();
+  const int level = state->compaction->output_level();
+  // the next level data rewritten by the future compactions of outputs.
+  uint64_t overlap_bytes = 0;
   for (const auto& output : state->outputs) {
-    state->compaction->edit()->AddFile(level + 1, output.number,
-                                       output.file_size, output.smallest,
-                                       output.largest);
-  }
-  return vset_->LogAndApply(state->compaction->edit(), &mu_);
+    overlap_bytes += state->compaction->GrandparentsOverlapBytes(
+        output.smallest, output.largest);
+  }
+  Log(option_.logger,
+      "Compaction stats: %d outputs, %llu bytes, next level overlap %llu "
+      "bytes, %d boundary cuts saved about %llu bytes",
+      static_cast<int>(state->outputs.size()),
+      static_cast<unsigned long long>(state->total_bytes),
+      static_cast<unsigned long long>(overlap_bytes),
+      state->compaction->boundary_cuts(),
+      static_cast<unsigned long long>(
+          state->compaction->boundary_cut_saved_bytes()));
+  for (const auto& output : state->outputs) {
+    FileMeta meta;
+    meta.number = output.number;
+    meta.file_size = output.file_size;
+    meta.smallest = output.smallest;
+    meta.largest = output.largest;
+    meta.num_entries = output.num_entries;
+    meta.num_deletions = output.num_deletions;
+    meta.marked_for_compaction = output.marked_for_compaction;
+    state->compaction->edit()->AddFile(level, meta);
+  }
+  return state->cfd->vset->LogAndApply(state->compaction->edit(), &mu_);
 }
 
-void DBImpl::CompactionMemtable() {
+void DBImpl::CompactionMemtable(ColumnFamilyData* cfd) {
   mu_.AssertHeld();
   VersionEdit edit;
-  Status s = WriteLevel0SSTable(imm_, &edit);
+  Status s = WriteLevel0SSTable(cfd, cfd->imm, &edit);
 
   if (s.ok() && closed_.load(std::memory_order_acquire)) {
     s = Status::Corruption("DB is closed during compaction memtable");
   }
   if (s.ok()) {
-    // early log is unuseful
-    edit.SetLogNumber(logfile_number_);
-    s = vset_->LogAndApply(&edit, &mu_);
+    // the logs before the switch of imm are unuseful to this family
+    edit.SetLogNumber(cfd->imm_log_number);
+    s = cfd->vset->LogAndApply(&edit, &mu_);
+  }
+  // the column families with nothing in memory need no log, move their
+  // log numbers forward to free the old logs.
+  for (size_t i = 0; s.ok() && i < column_families_.size(); i++) {
+    ColumnFamilyData* other = column_families_[i];
+    if (other != cfd && other->imm == nullptr &&
+        other->mem->NumEntries() == 0 &&
+        other->vset->LogNumber() < logfile_number_) {
+      VersionEdit other_edit;
+      other_edit.SetLogNumber(logfile_number_);
+      s = other->vset->LogAndApply(&other_edit, &mu_);
+    }
   }
   if (s.ok()) {
-    imm_->Unref();
-    imm_ = nullptr;
-    has_imm_.store(false, std::memory_order_release);
+    cfd->imm->Unref();
+    cfd->imm = nullptr;
+    bool has_imm = false;
+    for (ColumnFamilyData* other : column_families_) {
+      has_imm = has_imm || other->imm != nullptr;
+    }
+    has_imm_.store(has_imm, std::memory_order_release);
+    ReportMemoryUsage(true);
     GarbageFilesClean();
   } else {
     RecordBackgroundError(s);
   }
 }
 
+void DBImpl::CompactionMemtables() {
+  mu_.AssertHeld();
+  // the column families may be added while the mutex is released.
+  for (size_t i = 0; i < column_families_.size(); i++) {
+    if (column_families_[i]->imm != nullptr &&
+        background_status_.ok()) {
+      CompactionMemtable(column_families_[i]);
+    }
+  }
+}
+
 void DBImpl::RecordBackgroundError(Status s) {
   mu_.AssertHeld();
   if (background_status_.ok()) {
@@ -775,7 +1500,10 @@ void DBImpl::GarbageFilesClean() {
   for (uint64_t number : files_writing_) {
     live.insert(number);
   }
-  vset_->AddLiveFiles(&live);
+  for (ColumnFamilyData* cfd : column_families_) {
+    cfd->vset->AddLiveFiles(&live);
+  }
+  const uint64_t min_log = MinLogNumber();
 
   std::vector<std::string> filenames;
   env_->GetChildren(name_, &filenames);
@@ -788,7 +1516,7 @@ void DBImpl::GarbageFilesClean() {
       bool keep = true;
       switch (type) {
         case KLogFile:
-          keep = number >= vset_->LogNumber();
+          keep = number >= min_log;
           break;
         case KMetaFile:
           keep = number >= vset_->MetaFileNumber();
@@ -802,6 +1530,8 @@ void DBImpl::GarbageFilesClean() {
         case KCurrentFile:
         case KLockFile:
         case KLoggerFile:
+        case KCompactionFile:
+        case KIdentityFile:
           keep = true;
           break;
       }
@@ -809,7 +1539,16 @@ void DBImpl::GarbageFilesClean() {
         Log(option_.logger, "Garbage Clean:%s\n", filename.data());
         file_delete.push_back(filename);
         if (type == KSSTableFile) {
-          table_cache_->Evict(number);
+          // the block keys do not depend on the column family, a cache
+          // shared by several of them is erased once.
+          std::set<Cache*> erased;
+          for (ColumnFamilyData* cfd : column_families_) {
+            Cache* cache = cfd->option.compressed_block_cache;
+            if (cache != nullptr && erased.insert(cache).second) {
+              cfd->table_cache->EraseCompressedBlocks(number);
+            }
+            cfd->table_cache->Evict(number);
+          }
         }
       }
     }
@@ -833,6 +1572,10 @@ Status DBImpl::FinishCompactionSSTable(CompactionState* state,
   const uint64_t file_size = state->builder->FileSize();
   std::string file_name = SSTableFileName(name_, number);
   state->CurrOutput()->file_size = file_size;
+  state->CurrOutput()->num_entries = num_entries;
+  state->CurrOutput()->num_deletions = state->builder->NumDeletions();
+  state->CurrOutput()->marked_for_compaction =
+      state->builder->NeedCompaction();
   state->total_bytes += file_size;
   delete state->builder;
   state->builder = nullptr;
@@ -849,7 +1592,8 @@ Status DBImpl::FinishCompactionSSTable(CompactionState* state,
   delete state->out_file;
   state->out_file = nullptr;
   if (s.ok() && num_entries > 0) {
-    Iterator* iter = table_cache_->NewIterator(ReadOption(), number, file_size);
+    Iterator* iter =
+        state->cfd->table_cache->NewIterator(ReadOption(), number, file_size);
     s = iter->status();
     delete iter;
     if (s.ok()) {
@@ -861,6 +1605,48 @@ Status DBImpl::FinishCompactionSSTable(CompactionState* state,
           s.ToString().data());
     }
   }
+  if (s.ok() && num_entries > 0 && option_.resumable_compaction &&
+      state->compaction->output_level() != 0) {
+    // failing to record progress only loses the resumption.
+    Status record_s = RecordCompactionProgress(state);
+    if (!record_s.ok()) {
+      Log(option_.logger, "Record compaction progress: ERROR:%s",
+          record_s.ToString().data());
+    }
+  }
+  return s;
+}
+
+Status DBImpl::RecordCompactionProgress(CompactionState* state) {
+  Compaction* c = state->compaction;
+  CompactionProgress progress;
+  progress.column_family = state->cfd->id;
+  progress.level = c->level();
+  progress.output_level = c->output_level();
+  for (int which = 0; which < 2; which++) {
+    for (size_t i = 0; i < c->InputFilesNum(which); i++) {
+      progress.inputs[which].push_back(c->input(which, i)->number);
+    }
+  }
+  for (const auto& output : state->outputs) {
+    FileMeta meta;
+    meta.number = output.number;
+    meta.file_size = output.file_size;
+    meta.smallest = output.smallest;
+    meta.largest = output.largest;
+    meta.num_entries = output.num_entries;
+    meta.num_deletions = output.num_deletions;
+    meta.marked_for_compaction = output.marked_for_compaction;
+    progress.outputs.push_back(meta);
+  }
+  std::string record;
+  progress.EncodeTo(&record);
+  // write a tmp file and rename it, the old progress is kept if failed.
+  std::string tmp = TmpFileName(name_, state->CurrOutput()->number);
+  Status s = WriteStringToFileSync(env_, record, tmp);
+  if (s.ok()) {
+    s = env_->RenameFile(tmp, CompactionFileName(name_));
+  }
   return s;
 }
 
@@ -877,13 +1663,18 @@ Status DBImpl::OpenCompactionSSTable(CompactionState* state) {
     files_writing_.insert(number);
     output.smallest.Clear();
     output.largest.Clear();
+    output.num_entries = 0;
+    output.num_deletions = 0;
+    output.marked_for_compaction = false;
     state->outputs.push_back(output);
     mu_.Unlock();
   }
   std::string filename = SSTableFileName(name_, number);
   Status s = env_->NewWritableFile(filename, &state->out_file);
   if (s.ok()) {
-    state->builder = new SSTableBuilder(option_, state->out_file);
+    state->builder = new SSTableBuilder(
+        state->cfd->option, state->out_file, state->compaction->output_level(),
+        state->compaction->IsBottommostLevel());
   }
   return s;
 }
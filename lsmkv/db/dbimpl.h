@@ -2,7 +2,9 @@
 #define STORAGE_XDB_DB_DBIMPL_H_
 
 #include <deque>
+#include <set>
 
+#include "db/column_family.h"
 #include "db/log/log_writer.h"
 #include "db/memtable/memtable.h"
 #include "db/sstable/table_cache.h"
@@ -12,6 +14,9 @@
 
 namespace lsmkv {
 
+// the open files reserved by a DB for non-table files
+const int KNumNonTableCache = 10;
+
 class DBImpl : public DB {
  public:
   DBImpl(const Option& option, const std::string& name);
@@ -28,34 +33,137 @@ class DBImpl : public DB {
 
   Status Write(const WriteOption& option, WriteBatch* batch) override;
 
+  Status CreateColumnFamily(const Option& option, const std::string& name,
+                            ColumnFamilyHandle** handle) override;
+
+  ColumnFamilyHandle* DefaultColumnFamily() const override {
+    return default_cf_;
+  }
+
+  Status Get(const ReadOption& option, ColumnFamilyHandle* column_family,
+             std::string_view key, std::string* value) override;
+
+  Status Put(const WriteOption& option, ColumnFamilyHandle* column_family,
+             std::string_view key, std::string_view value) override;
+
+  Status Delete(const WriteOption& option, ColumnFamilyHandle* column_family,
+                std::string_view key) override;
+
+  // the compactions done since the DB is opened.
+  struct CompactionStats {
+    int intra_l0_compactions = 0;
+    // the trivial moves of more than one file
+    int multi_file_trivial_moves = 0;
+    // the compactions of the files with too many deletion records
+    int deletion_compactions = 0;
+    // the finished outputs of the interrupted compactions, which are
+    // reused by the resumed ones.
+    int resumed_outputs = 0;
+  };
+
+  // wait until the background flushes and compactions are done,
+  // return the background error. only used by the tests.
+  Status TEST_WaitForBackgroundWork();
+
+  // the VersionSet of the default column family, only used by the tests.
+  VersionSet* TEST_VersionSet() { return vset_; }
+
+  CompactionStats TEST_CompactionStats();
+
+  // pause the next compaction to level-1 or higher after it finishes
+  // "outputs" output files until the DB is closed, so the close
+  // interrupts it there. only used by the tests.
+  void TEST_PauseCompactionAfter(int outputs);
+
  private:
   friend class DB;
   struct Writer;
   struct CompactionState;
 
-  WriteBatch* MergeBatchGroup(Writer** last_writer);
+  WriteBatch* MergeBatchGroup(Writer** last_writer,
+                              std::set<uint32_t>* column_families);
+
+  Status Recover(const std::vector<ColumnFamilyDescriptor>& families,
+                 std::vector<VersionEdit>* edits) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // the option of a column family, sharing the env, logger and table
+  // cache of the DB.
+  Option ColumnFamilyOption(const Option& option) const;
 
-  Status Recover(VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // add the data of a column family, its VersionSet is not recovered.
+  ColumnFamilyData* AddColumnFamily(uint32_t id, const std::string& name,
+                                    const Option& option)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // add a column family and log it into the meta file
+  Status NewColumnFamily(const std::string& name, const Option& option,
+                         ColumnFamilyData** cfd) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  ColumnFamilyData* FindColumnFamily(const std::string& name)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // the memtables of the column families indexed by id
+  std::vector<MemTable*> MemTables() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   Status Initialize();
 
-  Status MakeRoomForWrite() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  Status RecoverCompactionProgress() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
-  Status RecoverLogFile(uint64_t number, SequenceNum* max_sequence,
-                        VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // read the id of the DB from its IDENTITY file, which is created
+  // with a random id at the first open.
+  Status RecoverIdentity() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // "column_families" are the column families to write, whose level-0
+  // file num is checked against l0_stop_write_threshold. nullptr means
+  // all of them.
+  Status MakeRoomForWrite(const std::set<uint32_t>* column_families)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // the column family whose memtable should be switched, nullptr if all
+  // the memtables have room.
+  ColumnFamilyData* ColumnFamilyToSwitch(bool force_switch)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // report the memtables' memory to option_.write_buffer_manager
+  void ReportMemoryUsage(bool force) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // make the memtable of "cfd" immutable, the new one is logged into
+  // a new log file.
+  Status SwitchMemTable(ColumnFamilyData* cfd) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // called by option_.write_buffer_manager when the DB is asked to switch
+  // a memtable, schedules BackgroundSwitch.
+  static void RequestSwitch(const void* db);
+
+  static void BackgroundSwitchCall(void* db);
 
-  Status WriteLevel0SSTable(MemTable* mem, VersionEdit* edit)
+  // switch the memtable asked by the write buffer manager for an idle DB,
+  // the writers switch it by themselves in MakeRoomForWrite.
+  void BackgroundSwitch();
+
+  Status RecoverLogFile(uint64_t number, SequenceNum* max_sequence,
+                        std::vector<VersionEdit>* edits)
       EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  Status WriteLevel0SSTable(ColumnFamilyData* cfd, MemTable* mem,
+                            VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   void MayScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // any column family needs compaction
+  bool NeedCompaction() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   static void CompactionSchedule(void* db);
 
   void BackgroundCompactionCall();
 
   void BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
-  void CompactionMemtable() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void CompactionMemtable(ColumnFamilyData* cfd) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // flush the immutable memtables of all the column families
+  void CompactionMemtables() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // the min log number needed by the column families
+  uint64_t MinLogNumber() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   Status DoCompactionLevel(CompactionState* state)
       EXCLUSIVE_LOCKS_REQUIRED(mu_);
@@ -71,18 +179,26 @@ class DBImpl : public DB {
 
   Status OpenCompactionSSTable(CompactionState* state);
 
+  Status RecordCompactionProgress(CompactionState* state);
+
   void CleanCompaction(CompactionState* state) EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   const std::string name_;
   const InternalKeyComparator internal_comparator_;
-  const InteralKeyFilterPolicy internal_policy_;
+  const InternalFilterPolicies internal_policies_;
   const Option option_;
 
   FileLock* file_lock_;
   Env* env_;
-  // in memory cache and its write-ahead logger
-  MemTable* mem_;
-  MemTable* imm_;
+  // the opened tables of all the column families
+  Cache* table_cache_;
+  // the metadata of the partitioned tables of the column families
+  // without "Option::metadata_cache"
+  Cache* metadata_cache_;
+  // the column families indexed by id, the default one is the first
+  std::vector<ColumnFamilyData*> column_families_ GUARDED_BY(mu_);
+  ColumnFamilyData* default_cf_;
+  // the write-ahead logger shared by the column families
   log::Writer* log_;
   WritableFile* logfile_;
   uint64_t logfile_number_ GUARDED_BY(mu_);
@@ -92,19 +208,39 @@ class DBImpl : public DB {
   CondVar background_cv_;
   Status background_status_ GUARDED_BY(mu_);
   bool background_scheduled_ GUARDED_BY(mu_);
+  // a BackgroundSwitch is scheduled, set by RequestSwitch without mu_.
+  std::atomic<bool> switch_scheduled_;
+  // the switch is left to the writers, asked again when they are done.
+  bool switch_deferred_ GUARDED_BY(mu_);
   std::atomic<bool> closed_;
+  // there are immutable memtables of any column family
   std::atomic<bool> has_imm_;
+  // set by TEST_PauseCompactionAfter, 0 means no pause
+  std::atomic<int> pause_compaction_outputs_;
+  // the meta file is being written by CreateColumnFamily,
+  // no compaction is scheduled.
+  bool creating_column_family_ GUARDED_BY(mu_);
 
   std::set<uint64_t> files_writing_ GUARDED_BY(mu_);
-
-  TableCache* table_cache_;
+  // the compaction interrupted by the last close, resumed at first.
+  CompactionProgress* pending_compaction_ GUARDED_BY(mu_);
+  // the memtables' memory last reported to the write buffer manager
+  size_t reported_usage_ GUARDED_BY(mu_);
+  // the column family picked for compaction first next time
+  size_t next_compaction_cf_ GUARDED_BY(mu_);
+  CompactionStats compaction_stats_ GUARDED_BY(mu_);
+
+  // the VersionSet of the default column family, which owns the meta file
   VersionSet* vset_;
+  // the id of the DB kept in its IDENTITY file, 0 before recovered
+  uint64_t db_id_ GUARDED_BY(mu_);
   WriteBatch* tmp_batch_ GUARDED_BY(mu_);
   std::deque<Writer*> writers_ GUARDED_BY(mu_);
 };
 
 Option AdaptOption(const std::string& name, const InternalKeyComparator* icmp,
-                   const InteralKeyFilterPolicy* ipolicy, const Option& option);
+                   const InternalFilterPolicies* ipolicies,
+                   const Option& option);
 }  // namespace lsmkv
 
 #endif  // STORAGE_XDB_DB_DBIMPL_H_
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "include/filter_policy.h"
+#include "util/MurmurHash3.h"
+#include "util/coding.h"
+namespace lsmkv {
+
+// a binary fuse filter (Graf and Lemire, 2022) with 3 hash functions.
+// every key hashes to 3 slots in consecutive segments, and the xor of
+// the fingerprints in its slots is the fingerprint of the key. the slots
+// are filled by peeling the keys one by one, which is slower than a bloom
+// filter but needs about 1.125 * fingerprint_bits bits per key.
+//
+// filter:
+// packed fingerprints | fixed32 array_length | fixed32 segment_length |
+// fixed32 segment_count_length | fixed64 seed | 1 byte fingerprint_bits
+//
+// a small filter spends most of its slots on the padding of the segments,
+// so it falls back to a bloom filter of the same false positive rate
+// whenever that one is smaller:
+// bloom filter | 1 byte KBloomFallbackMarker
+static const size_t KFuseTrailerSize = 4 + 4 + 4 + 8 + 1;
+static const uint8_t KBloomFallbackMarker = 0xff;
+static const uint32_t KMaxSegmentLength = 1 << 18;
+static const int KMaxBuildAttempts = 100;
+
+static uint64_t FuseHash(std::string_view key) {
+  uint64_t h[2];
+  murmur3::MurmurHash3_x64_128(key.data(), key.size(), 0x5f3759df, h);
+  return h[0];
+}
+
+// the finalizer of murmur3, mixes the key hash with the seed.
+static inline uint64_t Mix(uint64_t h, uint64_t seed) {
+  h += seed;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+struct FuseLayout {
+  uint32_t array_length;
+  uint32_t segment_length;
+  uint32_t segment_count_length;
+
+  void Slots(uint64_t h, uint32_t slots[3]) const {
+    const uint32_t mask = segment_length - 1;
+    slots[0] = static_cast<uint32_t>(
+        (static_cast<__uint128_t>(h) * segment_count_length) >> 64);
+    slots[1] = slots[0] + segment_length;
+    slots[2] = slots[1] + segment_length;
+    slots[1] ^= static_cast<uint32_t>(h >> 18) & mask;
+    slots[2] ^= static_cast<uint32_t>(h) & mask;
+  }
+};
+
+static FuseLayout CalculateLayout(size_t n) {
+  FuseLayout layout;
+  layout.segment_length =
+      (n <= 1 ? 4
+              : 1u << static_cast<int>(std::floor(std::log(n) / std::log(3.33) +
+                                                  2.25)));
+  layout.segment_length = std::min(layout.segment_length, KMaxSegmentLength);
+  const double size_factor =
+      (n <= 1 ? 0
+              : std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) /
+                                            std::log(static_cast<double>(n))));
+  const size_t capacity = static_cast<size_t>(std::round(n * size_factor));
+  int64_t segment_count =
+      static_cast<int64_t>((capacity + layout.segment_length - 1) /
+                           layout.segment_length) - 2;
+  segment_count = std::max<int64_t>(segment_count, 1);
+  layout.array_length = (segment_count + 2) * layout.segment_length;
+  layout.segment_count_length = segment_count * layout.segment_length;
+  return layout;
+}
+
+static inline uint32_t Fingerprint(uint64_t h, int bits) {
+  return static_cast<uint32_t>(h ^ (h >> 32)) & ((1u << bits) - 1);
+}
+
+// the fingerprints are packed little endian, and padded with 3 bytes so
+// that every fingerprint is read by a 4 bytes load.
+static inline uint32_t GetFingerprint(const char* array, uint32_t slot,
+                                      int bits) {
+  const uint64_t bit_offset = static_cast<uint64_t>(slot) * bits;
+  return (DecodeFixed32(array + bit_offset / 8) >> (bit_offset % 8)) &
+         ((1u << bits) - 1);
+}
+
+static inline void SetFingerprint(char* array, uint32_t slot, int bits,
+                                  uint32_t value) {
+  const uint64_t bit_offset = static_cast<uint64_t>(slot) * bits;
+  char* p = array + bit_offset / 8;
+  const uint32_t shift = bit_offset % 8;
+  uint32_t word = DecodeFixed32(p);
+  word &= ~(((1u << bits) - 1) << shift);
+  word |= value << shift;
+  EncodeFixed32(p, word);
+}
+
+// peel the keys, "order" is filled with the keys and their free slots,
+// in the reverse order of assignment. return false if the keys are not
+// peelable with this seed.
+static bool Peel(const std::vector<uint64_t>& hashes, const FuseLayout& layout,
+                 uint64_t seed,
+                 std::vector<std::pair<uint64_t, uint32_t>>* order) {
+  std::vector<uint8_t> count(layout.array_length, 0);
+  std::vector<uint64_t> xor_hash(layout.array_length, 0);
+  uint32_t slots[3];
+  for (uint64_t base : hashes) {
+    const uint64_t h = Mix(base, seed);
+    layout.Slots(h, slots);
+    for (uint32_t slot : slots) {
+      if (count[slot] == 255) {
+        return false;
+      }
+      count[slot]++;
+      xor_hash[slot] ^= h;
+    }
+  }
+  std::vector<uint32_t> queue;
+  for (uint32_t i = 0; i < layout.array_length; i++) {
+    if (count[i] == 1) {
+      queue.push_back(i);
+    }
+  }
+  order->clear();
+  while (!queue.empty()) {
+    const uint32_t slot = queue.back();
+    queue.pop_back();
+    if (count[slot] != 1) {
+      continue;
+    }
+    const uint64_t h = xor_hash[slot];
+    order->emplace_back(h, slot);
+    layout.Slots(h, slots);
+    for (uint32_t s : slots) {
+      count[s]--;
+      xor_hash[s] ^= h;
+      if (count[s] == 1) {
+        queue.push_back(s);
+      }
+    }
+  }
+  return order->size() == hashes.size();
+}
+
+class BinaryFuseFilterPolicy : public FilterPolicy {
+ public:
+  explicit BinaryFuseFilterPolicy(int bits_per_key) {
+    fingerprint_bits_ = static_cast<int>(bits_per_key / 1.125);
+    if (fingerprint_bits_ < 1) fingerprint_bits_ = 1;
+    if (fingerprint_bits_ > 16) fingerprint_bits_ = 16;
+    // a bloom filter needs about 1.44 bits per key for every halving of
+    // the false positive rate.
+    bloom_bits_per_key_ = static_cast<int>(std::ceil(fingerprint_bits_ * 1.44));
+    bloom_.reset(NewBloomFilterPolicy(bloom_bits_per_key_));
+  }
+
+  const char* Name() const override { return "lsmkv.BinaryFuseFilterPolicy"; }
+
+  void CreatFilter(std::string_view* keys, int n,
+                   std::string* dst) const override {
+    // the same keys must not be peeled twice.
+    std::vector<uint64_t> hashes(n);
+    for (int i = 0; i < n; i++) {
+      hashes[i] = FuseHash(keys[i]);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+    const FuseLayout layout = CalculateLayout(hashes.size());
+    const size_t bytes =
+        (static_cast<uint64_t>(layout.array_length) * fingerprint_bits_ + 7) / 8 +
+        3;
+    if ((bytes + KFuseTrailerSize) * 8 >
+        static_cast<uint64_t>(n) * bloom_bits_per_key_) {
+      bloom_->CreatFilter(keys, n, dst);
+      dst->push_back(static_cast<char>(KBloomFallbackMarker));
+      return;
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t>> order;
+    uint64_t seed = 0;
+    int attempt = 0;
+    for (; attempt < KMaxBuildAttempts; attempt++) {
+      seed = Mix(attempt, 0x9e3779b97f4a7c15ull);
+      if (Peel(hashes, layout, seed, &order)) {
+        break;
+      }
+    }
+    if (attempt == KMaxBuildAttempts) {
+      // unreachable in practice, the filter matches every key.
+      const size_t old_size = dst->size();
+      dst->resize(old_size + KFuseTrailerSize, 0);
+      return;
+    }
+
+    const size_t old_size = dst->size();
+    dst->resize(old_size + bytes, 0);
+    char* array = &(*dst)[old_size];
+    uint32_t slots[3];
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+      const uint64_t h = it->first;
+      layout.Slots(h, slots);
+      uint32_t value = Fingerprint(h, fingerprint_bits_);
+      for (uint32_t slot : slots) {
+        if (slot != it->second) {
+          value ^= GetFingerprint(array, slot, fingerprint_bits_);
+        }
+      }
+      SetFingerprint(array, it->second, fingerprint_bits_, value);
+    }
+    PutFixed32(dst, layout.array_length);
+    PutFixed32(dst, layout.segment_length);
+    PutFixed32(dst, layout.segment_count_length);
+    PutFixed64(dst, seed);
+    dst->push_back(static_cast<char>(fingerprint_bits_));
+  }
+
+  bool KeyMayMatch(std::string_view key,
+                   std::string_view filter) const override {
+    if (!filter.empty() &&
+        static_cast<uint8_t>(filter.back()) == KBloomFallbackMarker) {
+      filter.remove_suffix(1);
+      return bloom_->KeyMayMatch(key, filter);
+    }
+    if (filter.size() < KFuseTrailerSize) {
+      return true;
+    }
+    const char* trailer = filter.data() + filter.size() - KFuseTrailerSize;
+    FuseLayout layout;
+    layout.array_length = DecodeFixed32(trailer);
+    layout.segment_length = DecodeFixed32(trailer + 4);
+    layout.segment_count_length = DecodeFixed32(trailer + 8);
+    const uint64_t seed = DecodeFixed64(trailer + 12);
+    const int bits = static_cast<uint8_t>(trailer[20]);
+    if (bits < 1 || bits > 16 || layout.segment_length == 0 ||
+        (layout.segment_length & (layout.segment_length - 1)) != 0 ||
+        layout.segment_count_length + 2 * layout.segment_length !=
+            layout.array_length ||
+        (static_cast<uint64_t>(layout.array_length) * bits + 7) / 8 + 3 !=
+            filter.size() - KFuseTrailerSize) {
+      return true;
+    }
+    const uint64_t h = Mix(FuseHash(key), seed);
+    uint32_t slots[3];
+    layout.Slots(h, slots);
+    return Fingerprint(h, bits) == (GetFingerprint(filter.data(), slots[0], bits) ^
+                                    GetFingerprint(filter.data(), slots[1], bits) ^
+                                    GetFingerprint(filter.data(), slots[2], bits));
+  }
+
+ private:
+  int fingerprint_bits_;
+  int bloom_bits_per_key_;
+  std::unique_ptr<const FilterPolicy> bloom_;
+};
+
+FilterPolicy* NewBinaryFuseFilterPolicy(int bits_per_key) {
+  return new BinaryFuseFilterPolicy(bits_per_key);
+}
+}  // namespace lsmkv
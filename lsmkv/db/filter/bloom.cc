@@ -1,4 +1,11 @@
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define LSMKV_HAVE_AVX2_PROBE
+#endif
 
 #include "include/filter_policy.h"
 #include "util/MurmurHash3.h"
@@ -8,9 +15,87 @@ static uint32_t BloomHash(std::string_view key) {
   return murmur3::MurmurHash3_x86_32(key.data(), key.size(), 0x789fed11);
 }
 
+// the cache local filter:
+// lines of 64 bytes | 1 byte (KCacheLocalMarker | hash_num)
+// all the probes of a key fall in one line, the line is chosen by the
+// high 32 bits of a 64 bits hash, and the i-th probe takes 9 bits of
+// the low 32 bits multiplied by KProbeMultiplier^i.
+// the legacy readers see a hash_num > 30 and match every key.
+static const uint8_t KCacheLocalMarker = 0x80;
+static const size_t KCacheLineBytes = 64;
+static const uint32_t KProbeMultiplier = 0x9e3779b9;
+
+static uint64_t CacheLocalHash(std::string_view key) {
+  uint64_t h[2];
+  murmur3::MurmurHash3_x64_128(key.data(), key.size(), 0x789fed11, h);
+  return h[0];
+}
+
+static inline uint32_t LineIndex(uint64_t h, uint32_t num_lines) {
+  return static_cast<uint32_t>(((h >> 32) * num_lines) >> 32);
+}
+
+static inline void PrefetchLine(const char* line) {
+#ifdef __GNUC__
+  __builtin_prefetch(line);
+#endif
+}
+
+static bool ProbeLine(const char* line, uint32_t h, size_t hash_num) {
+  for (size_t i = 0; i < hash_num; i++) {
+    // 4 bits for the 32 bits word and 5 bits for the bit
+    const uint32_t word = h >> 28;
+    const uint32_t bit = (h >> 23) & 31;
+    uint32_t value;
+    memcpy(&value, line + word * 4, 4);
+    if ((value & (1u << bit)) == 0) {
+      return false;
+    }
+    h *= KProbeMultiplier;
+  }
+  return true;
+}
+
+#ifdef LSMKV_HAVE_AVX2_PROBE
+// check 8 probes at a time by gathering the words of the line.
+__attribute__((target("avx2"))) static bool ProbeLineAVX2(const char* line,
+                                                          uint32_t h,
+                                                          size_t hash_num) {
+  // KProbeMultiplier^0..7
+  static const __m256i powers = _mm256_setr_epi32(
+      0x00000001, 0x9e3779b9, 0xe35e67b1, 0x734297e9, 0x35fbe861, 0xdeb7c719,
+      0x448b211, 0x3459b749);
+  // KProbeMultiplier^8
+  static const uint32_t step = 0xab25f4c1;
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  for (size_t i = 0; i < hash_num; i += 8) {
+    const __m256i hashes =
+        _mm256_mullo_epi32(_mm256_set1_epi32(h), powers);
+    const __m256i words = _mm256_srli_epi32(hashes, 28);
+    const __m256i bits = _mm256_and_si256(_mm256_srli_epi32(hashes, 23),
+                                          _mm256_set1_epi32(31));
+    __m256i masks = _mm256_sllv_epi32(_mm256_set1_epi32(1), bits);
+    // clear the lanes beyond hash_num
+    const __m256i used = _mm256_cmpgt_epi32(
+        _mm256_set1_epi32(static_cast<int>(hash_num - i)), lanes);
+    masks = _mm256_and_si256(masks, used);
+    const __m256i values = _mm256_i32gather_epi32(
+        reinterpret_cast<const int*>(line), words, 4);
+    if (!_mm256_testc_si256(values, masks)) {
+      return false;
+    }
+    h *= step;
+  }
+  return true;
+}
+
+static const bool KHasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
 class BloomFilterPolicy : public FilterPolicy {
  public:
-  explicit BloomFilterPolicy(int bits_per_key) : bits_per_key_(bits_per_key) {
+  BloomFilterPolicy(int bits_per_key, bool cache_local)
+      : bits_per_key_(bits_per_key), cache_local_(cache_local) {
     hash_num_ = static_cast<size_t>(bits_per_key * 0.69);
     if (hash_num_ < 1) hash_num_ = 1;
     if (hash_num_ > 30) hash_num_ = 30;
@@ -20,6 +105,10 @@ class BloomFilterPolicy : public FilterPolicy {
 
   void CreatFilter(std::string_view* keys, int n,
                    std::string* dst) const override {
+    if (cache_local_) {
+      CreatCacheLocalFilter(keys, n, dst);
+      return;
+    }
     int bits = n * bits_per_key_;
 
     if (bits < 64) bits = 64;
@@ -47,7 +136,11 @@ class BloomFilterPolicy : public FilterPolicy {
     if (len < 2) return false;
     const char* array = filter.data();
     const size_t bits = (len - 1) * 8;
-    const size_t hash_num = array[len - 1];
+    const uint8_t trailer = static_cast<uint8_t>(array[len - 1]);
+    if (trailer & KCacheLocalMarker) {
+      return CacheLocalMayMatch(key, filter);
+    }
+    const size_t hash_num = trailer;
     if (hash_num > 30) {
       return true;
     }
@@ -64,11 +157,67 @@ class BloomFilterPolicy : public FilterPolicy {
   }
 
  private:
+  void CreatCacheLocalFilter(std::string_view* keys, int n,
+                             std::string* dst) const {
+    size_t bits = static_cast<size_t>(n) * bits_per_key_;
+    const uint32_t num_lines =
+        std::max<size_t>((bits + KCacheLineBytes * 8 - 1) / (KCacheLineBytes * 8), 1);
+    const size_t old_size = dst->size();
+    dst->resize(old_size + num_lines * KCacheLineBytes, 0);
+    dst->push_back(static_cast<char>(KCacheLocalMarker | hash_num_));
+    char* array = &(*dst)[old_size];
+    // hash a batch of keys and prefetch their lines before setting
+    // the bits, so that the cache misses overlap.
+    const int KBatch = 8;
+    uint64_t hashes[KBatch];
+    for (int start = 0; start < n; start += KBatch) {
+      const int count = std::min(KBatch, n - start);
+      for (int i = 0; i < count; i++) {
+        hashes[i] = CacheLocalHash(keys[start + i]);
+        PrefetchLine(array + LineIndex(hashes[i], num_lines) * KCacheLineBytes);
+      }
+      for (int i = 0; i < count; i++) {
+        char* line = array + LineIndex(hashes[i], num_lines) * KCacheLineBytes;
+        uint32_t h = static_cast<uint32_t>(hashes[i]);
+        for (size_t j = 0; j < hash_num_; j++) {
+          const uint32_t word = h >> 28;
+          const uint32_t bit = (h >> 23) & 31;
+          uint32_t value;
+          memcpy(&value, line + word * 4, 4);
+          value |= (1u << bit);
+          memcpy(line + word * 4, &value, 4);
+          h *= KProbeMultiplier;
+        }
+      }
+    }
+  }
+
+  static bool CacheLocalMayMatch(std::string_view key,
+                                 std::string_view filter) {
+    const size_t len = filter.size();
+    const size_t hash_num =
+        static_cast<uint8_t>(filter[len - 1]) & ~KCacheLocalMarker;
+    if ((len - 1) % KCacheLineBytes != 0 || hash_num > 30) {
+      return true;
+    }
+    const uint32_t num_lines = (len - 1) / KCacheLineBytes;
+    const uint64_t h = CacheLocalHash(key);
+    const char* line =
+        filter.data() + LineIndex(h, num_lines) * KCacheLineBytes;
+#ifdef LSMKV_HAVE_AVX2_PROBE
+    if (KHasAVX2) {
+      return ProbeLineAVX2(line, static_cast<uint32_t>(h), hash_num);
+    }
+#endif
+    return ProbeLine(line, static_cast<uint32_t>(h), hash_num);
+  }
+
   size_t bits_per_key_;
   size_t hash_num_;
+  const bool cache_local_;
 };
 
-FilterPolicy* NewBloomFilterPolicy(int bits_per_key) {
-  return new BloomFilterPolicy(bits_per_key);
+FilterPolicy* NewBloomFilterPolicy(int bits_per_key, bool cache_local) {
+  return new BloomFilterPolicy(bits_per_key, cache_local);
 }
 }  // namespace lsmkv
\ No newline at end of file
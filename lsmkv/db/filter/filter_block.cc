@@ -1,6 +1,8 @@
 #include "db/filter/filter_block.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 
 #include "util/coding.h"
 namespace lsmkv {
@@ -10,6 +12,56 @@ static const size_t KFilterBlockSizeLg = 11;
 
 static const size_t KFilterBlockSize = (1 << KFilterBlockSizeLg);
 
+const FilterPolicy* LevelFilterPolicy(const Option& option, int level,
+                                      bool bottommost) {
+  if (bottommost && option.skip_bottommost_filter) {
+    return nullptr;
+  }
+  if (level >= 0 &&
+      static_cast<size_t>(level) < option.level_filter_policy.size() &&
+      option.level_filter_policy[level] != nullptr) {
+    return option.level_filter_policy[level];
+  }
+  return option.filter_policy;
+}
+
+std::vector<int> MonkeyBitsPerKey(double budget,
+                                  const std::vector<uint64_t>& level_sizes) {
+  // the bits b of the false positive rate p is -ln(p) / ln(2)^2, with p
+  // proportional to the size n of level, b = k - ln(n) / ln(2)^2.
+  // k is solved from sum(n * b) = budget * sum(n).
+  const double ln2_square = std::log(2) * std::log(2);
+  const int num_levels = level_sizes.size();
+  double total = 0, weighted_log = 0;
+  for (uint64_t size : level_sizes) {
+    if (size > 0) {
+      total += size;
+      weighted_log += size * std::log(static_cast<double>(size));
+    }
+  }
+  std::vector<int> bits(num_levels,
+                        std::max(static_cast<int>(std::lround(budget)), 1));
+  if (total == 0) {
+    return bits;
+  }
+  const double k = budget + weighted_log / (ln2_square * total);
+  int last = num_levels - 1;
+  while (level_sizes[last] == 0) last--;
+  for (int level = last; level >= 0; level--) {
+    if (level_sizes[level] > 0) {
+      const double b =
+          k - std::log(static_cast<double>(level_sizes[level])) / ln2_square;
+      bits[level] = std::max(static_cast<int>(std::lround(b)), 1);
+    } else {
+      bits[level] = bits[level + 1];
+    }
+  }
+  for (int level = last + 1; level < num_levels; level++) {
+    bits[level] = bits[last];
+  }
+  return bits;
+}
+
 FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy)
     : policy_(policy) {}
 void FilterBlockBuilder::StartBlock(uint64_t block_offset) {
@@ -7,9 +7,22 @@
 #include <vector>
 
 #include "include/filter_policy.h"
+#include "include/option.h"
 namespace lsmkv {
 
 class FilterPolicy;
+
+// the filter policy to write the sstables of "level" with, -1 if the
+// level is unknown. nullptr if the sstables of the bottommost level are
+// not filtered. see "Option::level_filter_policy".
+const FilterPolicy* LevelFilterPolicy(const Option& option, int level,
+                                      bool bottommost = false);
+
+// the bloom bits per key of each level that average "budget" over the
+// keys of the levels of "level_sizes". an empty level gets the bits of
+// the next non-empty level, or of the last non-empty level.
+std::vector<int> MonkeyBitsPerKey(double budget,
+                                  const std::vector<uint64_t>& level_sizes);
 /**
  * @brief 用于SSTBlockBuilder
  */
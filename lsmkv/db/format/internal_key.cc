@@ -1,6 +1,11 @@
 #include "db/format/internal_key.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+
+#include "db/filter/filter_block.h"
+#include "db/format/dbformat.h"
 namespace lsmkv {
 
 void AppendInternalKey(std::string* dst, const ParsedInternalKey& key) {
@@ -101,4 +106,95 @@ bool InteralKeyFilterPolicy::KeyMayMatch(std::string_view key,
   return user_policy_->KeyMayMatch(ExtractUserKey(key), filter);
 }
 
-}  // namespace lsmkv
\ No newline at end of file
+// the bloom filters of a level under the budget, the bits per key are
+// changed with the sizes of the levels.
+class MonkeyFilterPolicy : public FilterPolicy {
+ public:
+  MonkeyFilterPolicy(const std::vector<const FilterPolicy*>* blooms, int bits)
+      : blooms_(blooms) {
+    SetBitsPerKey(bits);
+  }
+
+  const char* Name() const override { return (*blooms_)[0]->Name(); }
+
+  void CreatFilter(std::string_view* keys, int n,
+                   std::string* dst) const override {
+    (*blooms_)[bits_.load(std::memory_order_relaxed) - 1]->CreatFilter(
+        keys, n, dst);
+  }
+
+  // the number of hashes is read from the filter by any of them.
+  bool KeyMayMatch(std::string_view key,
+                   std::string_view filter) const override {
+    return (*blooms_)[0]->KeyMayMatch(key, filter);
+  }
+
+  void SetBitsPerKey(int bits) {
+    bits = std::min<int>(bits, blooms_->size());
+    bits_.store(std::max(bits, 1), std::memory_order_relaxed);
+  }
+
+ private:
+  const std::vector<const FilterPolicy*>* const blooms_;
+  std::atomic<int> bits_;
+};
+
+// the bloom filters with more bits per key hardly help.
+static const int KMaxMonkeyBitsPerKey = 40;
+
+InternalFilterPolicies::InternalFilterPolicies(const Option& option)
+    : budget_(option.filter_bits_per_key_budget) {
+  const FilterPolicy* policy = option.filter_policy;
+  std::vector<const FilterPolicy*> level_policies = option.level_filter_policy;
+  if (budget_ > 0) {
+    level_policies.clear();
+    for (int bits = 1; bits <= KMaxMonkeyBitsPerKey; bits++) {
+      owned_.push_back(NewBloomFilterPolicy(bits));
+    }
+    // the levels are empty, every level has the budget.
+    for (int bits : MonkeyBitsPerKey(
+             budget_, std::vector<uint64_t>(config::kNumLevels, 0))) {
+      monkey_policies_.push_back(
+          std::make_unique<MonkeyFilterPolicy>(&owned_, bits));
+      level_policies.push_back(monkey_policies_.back().get());
+    }
+    // the level is unknown, as if it is the last level.
+    policy = level_policies.back();
+  }
+  if (policy != nullptr) {
+    policy_ = std::make_unique<InteralKeyFilterPolicy>(policy);
+  }
+  for (const FilterPolicy* level_policy : level_policies) {
+    level_policies_.push_back(
+        level_policy == nullptr
+            ? nullptr
+            : std::make_unique<InteralKeyFilterPolicy>(level_policy));
+  }
+}
+
+InternalFilterPolicies::~InternalFilterPolicies() {
+  for (const FilterPolicy* policy : owned_) {
+    delete policy;
+  }
+}
+
+void InternalFilterPolicies::SetLevelSizes(
+    const std::vector<uint64_t>& level_sizes) const {
+  if (budget_ <= 0) {
+    return;
+  }
+  const std::vector<int> bits = MonkeyBitsPerKey(budget_, level_sizes);
+  for (size_t level = 0; level < monkey_policies_.size(); level++) {
+    monkey_policies_[level]->SetBitsPerKey(bits[level]);
+  }
+}
+
+void InternalFilterPolicies::Apply(Option* option) const {
+  option->filter_policy = policy_.get();
+  option->level_filter_policy.clear();
+  for (const auto& level_policy : level_policies_) {
+    option->level_filter_policy.push_back(level_policy.get());
+  }
+}
+
+}  // namespace lsmkv
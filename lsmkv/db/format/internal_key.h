@@ -3,10 +3,13 @@
 
 #include <cassert>
 #include <cstddef>
+#include <memory>
 #include <string_view>
+#include <vector>
 
 #include "include/comparator.h"
 #include "include/filter_policy.h"
+#include "include/option.h"
 #include "include/status.h"
 #include "util/coding.h"
 
@@ -105,6 +108,35 @@ class InteralKeyFilterPolicy : public FilterPolicy {
   const FilterPolicy* user_policy_;
 };
 
+class MonkeyFilterPolicy;
+
+// the filter policies of an option adapted to internal keys, including
+// the bloom filters of "Option::filter_bits_per_key_budget".
+class InternalFilterPolicies {
+ public:
+  explicit InternalFilterPolicies(const Option& option);
+
+  InternalFilterPolicies(const InternalFilterPolicies&) = delete;
+  InternalFilterPolicies& operator=(const InternalFilterPolicies&) = delete;
+
+  ~InternalFilterPolicies();
+
+  // replace the filter policies of "option" with the adapted ones.
+  void Apply(Option* option) const;
+
+  // size the bloom filters of the budget for the current sizes of the
+  // levels, thread safe with the filters being built.
+  void SetLevelSizes(const std::vector<uint64_t>& level_sizes) const;
+
+ private:
+  const double budget_;
+  // the bloom filters of the budget, with 1 to max bits per key
+  std::vector<const FilterPolicy*> owned_;
+  std::vector<std::unique_ptr<MonkeyFilterPolicy>> monkey_policies_;
+  std::unique_ptr<InteralKeyFilterPolicy> policy_;
+  std::vector<std::unique_ptr<InteralKeyFilterPolicy>> level_policies_;
+};
+
 class LookupKey {
  public:
   LookupKey(std::string_view user_key, SequenceNum seq);
@@ -1,15 +1,126 @@
 #include "db/memtable/arena.h"
 
+#include <sys/mman.h>
+
 #include <cassert>
 
 namespace lsmkv {
 
-static constexpr int kBlockSize = 4096;
+// allocate a block by mmap, backed by huge pages if possible.
+static char* MmapBlock(size_t bytes) {
+  void* ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+  if (ptr == MAP_FAILED) {
+    // no reserved huge pages, try the transparent huge pages.
+    ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    ::madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+  }
+  return static_cast<char*>(ptr);
+}
+
+static void FreeBlock(char* block, size_t bytes, bool mmapped) {
+  if (mmapped) {
+    ::munmap(block, bytes);
+  } else {
+    delete[] block;
+  }
+}
+
+ArenaBlockPool::~ArenaBlockPool() {
+  for (auto& kv : free_blocks_) {
+    for (char* block : kv.second) {
+      FreeBlock(block, kv.first.first, kv.first.second);
+    }
+  }
+}
+
+ArenaBlockPool* ArenaBlockPool::Default() {
+  static ArenaBlockPool* pool = new ArenaBlockPool;
+  return pool;
+}
+
+void ArenaBlockPool::Reserve(size_t capacity) {
+  MutexLock l(&mu_);
+  capacity_ += capacity;
+}
+
+void ArenaBlockPool::Release(size_t capacity) {
+  MutexLock l(&mu_);
+  assert(capacity <= capacity_);
+  capacity_ -= capacity;
+  for (auto& kv : free_blocks_) {
+    std::vector<char*>& blocks = kv.second;
+    while (MemoryUsed() > capacity_ && !blocks.empty()) {
+      FreeBlock(blocks.back(), kv.first.first, kv.first.second);
+      blocks.pop_back();
+      memory_used_.fetch_sub(kv.first.first, std::memory_order_relaxed);
+    }
+  }
+}
+
+char* ArenaBlockPool::Take(size_t bytes, bool mmapped) {
+  MutexLock l(&mu_);
+  auto it = free_blocks_.find({bytes, mmapped});
+  if (it == free_blocks_.end() || it->second.empty()) {
+    return nullptr;
+  }
+  char* block = it->second.back();
+  it->second.pop_back();
+  memory_used_.fetch_sub(bytes, std::memory_order_relaxed);
+  return block;
+}
+
+bool ArenaBlockPool::Give(char* block, size_t bytes, bool mmapped) {
+  MutexLock l(&mu_);
+  if (MemoryUsed() + bytes > capacity_) {
+    return false;
+  }
+  free_blocks_[{bytes, mmapped}].push_back(block);
+  memory_used_.fetch_add(bytes, std::memory_order_relaxed);
+  return true;
+}
+
+Arena::~Arena() {
+  for (const Block& block : blocks_) {
+    if (block.size == block_size_ && pool_ != nullptr &&
+        pool_->Give(block.data, block.size, block.mmapped)) {
+      continue;
+    }
+    FreeBlock(block.data, block.size, block.mmapped);
+  }
+}
 
 char* Arena::AllocateNewBlock(size_t bytes) {
   char* block = new char[bytes];
-  blocks_.push_back(block);
-  memory_used_.fetch_add(bytes + sizeof(char*), std::memory_order_release);
+  blocks_.push_back(Block{block, bytes, false});
+  memory_used_.fetch_add(bytes + sizeof(Block), std::memory_order_release);
+  return block;
+}
+
+char* Arena::AllocateStandardBlock() {
+  char* block = nullptr;
+  if (pool_ != nullptr) {
+    block = pool_->Take(block_size_, huge_page_);
+  }
+  if (block == nullptr && huge_page_) {
+    block = MmapBlock(block_size_);
+  }
+  if (block == nullptr) {
+    return AllocateNewBlock(block_size_);
+  }
+  // a block from the pool is mmapped iff huge page is used.
+  blocks_.push_back(Block{block, block_size_, huge_page_});
+  memory_used_.fetch_add(block_size_ + sizeof(Block),
+                         std::memory_order_release);
   return block;
 }
 
@@ -42,15 +153,15 @@ char* Arena::AllocateAlign(size_t bytes) {
 }
 
 char* Arena::AllocateFallBack(size_t bytes) {
-  if (bytes > kBlockSize / 4) {
+  if (bytes > block_size_ / 4) {
     return AllocateNewBlock(bytes);
   }
-  alloc_ptr_ = AllocateNewBlock(kBlockSize);
-  alloc_bytes_remaining_ = kBlockSize;
+  alloc_ptr_ = AllocateStandardBlock();
+  alloc_bytes_remaining_ = block_size_;
   char* result = alloc_ptr_;
   alloc_ptr_ += bytes;
   alloc_bytes_remaining_ -= bytes;
   return result;
 }
 
-}  // namespace lsmkv
\ No newline at end of file
+}  // namespace lsmkv
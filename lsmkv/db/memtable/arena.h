@@ -5,17 +5,102 @@
  * @brief 内存分配器，管理跳表的节点的内存
  */
 #include <atomic>
+#include <cstddef>
+#include <map>
 #include <vector>
 
+#include "util/mutex.h"
+
 namespace lsmkv {
 
-class Arena {
+/**
+ * @brief 进程内共享的内存块池
+ * @details 已刷盘的内存表释放的标准大小内存块被放入池中，
+ *          新的内存表优先从池中取，避免反复向系统申请和释放
+ */
+class ArenaBlockPool {
  public:
-  Arena() : alloc_ptr_(nullptr), alloc_bytes_remaining_(0), memory_used_(0) {}
-  ~Arena() {
-    for (char* block : blocks_) delete[] block;
+  ArenaBlockPool() : capacity_(0), memory_used_(0) {}
+
+  ArenaBlockPool(const ArenaBlockPool&) = delete;
+  ArenaBlockPool& operator=(const ArenaBlockPool&) = delete;
+
+  ~ArenaBlockPool();
+
+  /**
+   * @brief 进程内默认的内存块池
+   */
+  static ArenaBlockPool* Default();
+
+  /**
+   * @brief 池的容量增加capacity字节，池最多保留容量大小的空闲内存块
+   */
+  void Reserve(size_t capacity);
+
+  /**
+   * @brief 归还Reserve增加的容量，释放超出容量的空闲内存块
+   */
+  void Release(size_t capacity);
+
+  /**
+   * @brief 取出一个大小为bytes的空闲内存块
+   * @return 没有时返回nullptr
+   */
+  char* Take(size_t bytes, bool mmapped);
+
+  /**
+   * @brief 放回一个内存块
+   * @retval false 池已满，内存块需由调用者释放
+   */
+  bool Give(char* block, size_t bytes, bool mmapped);
+
+  /**
+   * @brief 池中空闲内存块的总大小
+   */
+  size_t MemoryUsed() const {
+    return memory_used_.load(std::memory_order_relaxed);
   }
 
+ private:
+  Mutex mu_;
+  size_t capacity_ GUARDED_BY(mu_);
+  /// 按(大小, 是否由mmap分配)分类的空闲内存块
+  std::map<std::pair<size_t, bool>, std::vector<char*>> free_blocks_
+      GUARDED_BY(mu_);
+  std::atomic<size_t> memory_used_;
+};
+
+class Arena {
+ public:
+  Arena()
+      : Arena(KDefaultBlockSize, false, nullptr) {}
+
+  /**
+   * @param[in] block_size 内存块的大小
+   * @param[in] huge_page 内存块是否使用大页(MAP_HUGETLB或透明大页)
+   * @param[in] pool 不为nullptr时，从池中复用内存块，析构时放回
+   */
+  Arena(size_t block_size, bool huge_page, ArenaBlockPool* pool)
+      : block_size_(huge_page ? (block_size + KHugePageSize - 1) /
+                                    KHugePageSize * KHugePageSize
+                              : block_size),
+        huge_page_(huge_page),
+        pool_(pool),
+        alloc_ptr_(nullptr),
+        alloc_bytes_remaining_(0),
+        memory_used_(0) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  ~Arena();
+
+  static constexpr size_t KDefaultBlockSize = 4096;
+
+  /// 使用大页时，标准内存块的大小向上取整为大页大小的整数倍，
+  /// 否则每个内存块占用一整个大页，而只记录了内存块的大小
+  static constexpr size_t KHugePageSize = 2 * 1024 * 1024;
+
   /**
    * @brief 分配bytes个字节的连续内存块
    * @note 内存未对齐
@@ -50,13 +135,31 @@ class Arena {
    */
   char* AllocateNewBlock(size_t bytes);
 
+  /**
+   * @brief 申请一个标准大小的内存块，优先从池中取
+   */
+  char* AllocateStandardBlock();
+
+  struct Block {
+    char* data;
+    size_t size;
+    /// 由mmap分配，需用munmap释放
+    bool mmapped;
+  };
+
  private:
+  /// 标准内存块的大小
+  const size_t block_size_;
+  /// 标准内存块是否使用大页
+  const bool huge_page_;
+  /// 内存块池，为nullptr时不复用
+  ArenaBlockPool* const pool_;
   /// 记录内存分配器当前使用的内存块
   char* alloc_ptr_;
   /// 记录当前内存块中剩余可用字节数
   size_t alloc_bytes_remaining_;
-  /// 记录所有指向内存块的指针
-  std::vector<char*> blocks_;
+  /// 记录所有内存块
+  std::vector<Block> blocks_;
   /// 记录内存分配器使用的内存大小
   std::atomic<size_t> memory_used_;
 };
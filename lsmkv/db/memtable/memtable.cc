@@ -3,15 +3,10 @@
 #include <cstring>
 
 #include "include/iterator.h"
+#include "include/prefix_extractor.h"
 #include "util/coding.h"
 namespace lsmkv {
 
-static std::string_view DecodeLengthPrefixedSlice(const char* p) {
-  uint32_t len;
-  const char* q = DecodeVarint32(p, p + 5, &len);
-  return std::string_view(q, len);
-}
-
 static const char* MakeKey(std::string* buf, std::string_view s) {
   buf->clear();
   PutVarint32(buf, s.size());
@@ -19,14 +14,29 @@ static const char* MakeKey(std::string* buf, std::string_view s) {
   return buf->data();
 }
 
-int MemTable::KeyComparator::operator()(const char* a, const char* b) const {
-  std::string_view as = DecodeLengthPrefixedSlice(a);
-  std::string_view bs = DecodeLengthPrefixedSlice(b);
-  return comparator.Compare(as, bs);
+MemTable::MemTable(const InternalKeyComparator& cmp, const Option& option)
+    : comparator_(cmp),
+      arena_(option.arena_block_size, option.arena_huge_page,
+             option.arena_block_pool_size > 0 ? ArenaBlockPool::Default()
+                                              : nullptr),
+      table_(NewMemTableRep(option, comparator_, &arena_)),
+      bloom_(nullptr),
+      bloom_prefix_extractor_(
+          option.memtable_prefix_bloom ? option.prefix_extractor : nullptr),
+      num_entries_(0),
+      refs_(0) {
+  if (option.memtable_bloom_size_ratio > 0) {
+    bloom_ = new MemTableBloom(
+        &arena_, static_cast<size_t>(option.write_mem_size *
+                                     option.memtable_bloom_size_ratio));
+  }
 }
 
-MemTable::MemTable(const InternalKeyComparator& cmp)
-    : comparator_(cmp), table_(comparator_, &arena_), refs_(0) {}
+std::string_view MemTable::BloomKey(std::string_view user_key) const {
+  return bloom_prefix_extractor_ == nullptr
+             ? user_key
+             : bloom_prefix_extractor_->Transform(user_key);
+}
 
 // Format :
 // Varint32 : key size + 8.
@@ -35,7 +45,7 @@ MemTable::MemTable(const InternalKeyComparator& cmp)
 // Varint32 : value size.
 // char[value size] : value
 void MemTable::Put(SequenceNum seq, RecordType type, std::string_view key,
-                   std::string_view value) {
+                   std::string_view value, void** hint) {
   uint64_t seq_and_type = PackSequenceAndType(seq, type);
   size_t key_size = key.size();
   size_t val_size = value.size();
@@ -50,16 +60,26 @@ void MemTable::Put(SequenceNum seq, RecordType type, std::string_view key,
   p += 8;
   p = EncodeVarint32(p, val_size);
   std::memcpy(p, value.data(), val_size);
-  table_.Insert(buf);
+  // add to the filter first, the record is seen by readers once inserted.
+  if (bloom_ != nullptr) {
+    bloom_->Add(BloomKey(key));
+  }
+  if (hint != nullptr) {
+    table_->Insert(buf, hint);
+  } else {
+    table_->Insert(buf);
+  }
+  num_entries_.fetch_add(1, std::memory_order_relaxed);
 }
 
 bool MemTable::Get(const LookupKey& key, std::string* result, Status* status) {
-  Table::Iterator iter(&table_);
+  if (bloom_ != nullptr && !bloom_->MayContain(BloomKey(key.UserKey()))) {
+    return false;
+  }
   std::string_view full_key = key.FullKey();
-  iter.Seek(full_key.data());
+  const char* record = table_->Lookup(full_key.data());
 
-  if (iter.Valid()) {
-    const char* record = iter.key();
+  if (record != nullptr) {
     uint32_t key_size;
     const char* key_ptr = DecodeVarint32(record, record + 5, &key_size);
     if (comparator_.comparator.UserComparator()->Compare(
@@ -82,40 +102,40 @@ bool MemTable::Get(const LookupKey& key, std::string* result, Status* status) {
 
 class MemTableIterator : public Iterator {
  public:
-  explicit MemTableIterator(MemTable::Table* table) : iter_(table) {}
+  explicit MemTableIterator(MemTableRep* table) : iter_(table->NewIterator()) {}
 
   MemTableIterator(const MemTableIterator&) = delete;
   MemTableIterator& operator=(const MemTableIterator&) = delete;
 
-  ~MemTableIterator() = default;
+  ~MemTableIterator() { delete iter_; }
 
-  bool Valid() const { return iter_.Valid(); }
+  bool Valid() const { return iter_->Valid(); }
 
   std::string_view Key() const {
-    return DecodeLengthPrefixedSlice(iter_.key());
+    return DecodeLengthPrefixedSlice(iter_->key());
   }
 
   std::string_view Value() const {
-    std::string_view key = DecodeLengthPrefixedSlice(iter_.key());
+    std::string_view key = DecodeLengthPrefixedSlice(iter_->key());
     return DecodeLengthPrefixedSlice(key.data() + key.size());
   }
 
-  void Next() { iter_.Next(); }
+  void Next() { iter_->Next(); }
 
-  void Prev() { iter_.Prev(); }
+  void Prev() { iter_->Prev(); }
 
-  void Seek(std::string_view key) { iter_.Seek(MakeKey(&alloc_ptr_, key)); }
+  void Seek(std::string_view key) { iter_->Seek(MakeKey(&alloc_ptr_, key)); }
 
-  void SeekToFirst() { iter_.SeekToFirst(); }
+  void SeekToFirst() { iter_->SeekToFirst(); }
 
-  void SeekToLast() { iter_.SeekToLast(); }
+  void SeekToLast() { iter_->SeekToLast(); }
 
   Status status() { return Status::OK(); }
 
  private:
-  MemTable::Table::Iterator iter_;
+  MemTableRep::Iterator* iter_;
   std::string alloc_ptr_;
 };
 
-Iterator* MemTable::NewIterator() { return new MemTableIterator(&table_); }
+Iterator* MemTable::NewIterator() { return new MemTableIterator(table_); }
 }  // namespace lsmkv
\ No newline at end of file
@@ -1,17 +1,26 @@
 #ifndef MEMTABLE_H
 #define MEMTABLE_H
 
+#include <atomic>
+
 #include "db/format/internal_key.h"
 #include "db/memtable/arena.h"
-#include "db/memtable/skiplist.h"
+#include "db/memtable/memtable_bloom.h"
+#include "db/memtable/memtable_rep.h"
 #include "include/iterator.h"
+#include "include/option.h"
 #include "include/status.h"
 
 namespace lsmkv {
 
 class MemTable {
  public:
-  explicit MemTable(const InternalKeyComparator& cmp);
+  /**
+   * @param[in] cmp internal key的比较器
+   * @param[in] option 决定内存表的底层结构
+   */
+  explicit MemTable(const InternalKeyComparator& cmp,
+                    const Option& option = Option());
 
   MemTable(const MemTable&) = delete;
   MemTable& operator=(const MemTable&) = delete;
@@ -38,9 +47,11 @@ class MemTable {
    * @param[in] type record的类型
    * @param[in] key record的key
    * @param[in] value record的value
+   * @param[in,out] hint 插入位置的缓存，同一批record的插入共用，
+   *                     为nullptr时不使用
    */
   void Put(SequenceNum seq, RecordType type, std::string_view key,
-           std::string_view value);
+           std::string_view value, void** hint = nullptr);
 
   /**
    * @brief Get接口实现
@@ -60,29 +71,47 @@ class MemTable {
   /**
    * @brief 返回内存表使用的近似内存大小
    */
-  size_t ApproximateSize() { return arena_.MemoryUsed(); }
+  size_t ApproximateSize() {
+    return arena_.MemoryUsed() + table_->ApproximateMemoryUsage();
+  }
 
- private:
-  struct KeyComparator {
-    const InternalKeyComparator comparator;
-    explicit KeyComparator(const InternalKeyComparator& cmp)
-        : comparator(cmp) {}
-    int operator()(const char* a, const char* b) const;
-  };
+  /**
+   * @brief 返回已插入的record数量
+   */
+  uint64_t NumEntries() const {
+    return num_entries_.load(std::memory_order_relaxed);
+  }
 
-  using Table = SkipList<const char*, KeyComparator>;
+ private:
+  using KeyComparator = MemTableKeyComparator;
 
   friend class MemTableIterator;
 
-  ~MemTable() { assert(refs_ == 0); };
+  ~MemTable() {
+    assert(refs_ == 0);
+    delete table_;
+    delete bloom_;
+  };
+
+  /**
+   * @brief 返回user key在布隆过滤器中的key
+   */
+  std::string_view BloomKey(std::string_view user_key) const;
+
 
  private:
   /// 比较器，用于key之间的比较
   KeyComparator comparator_;
   /// 内存分配器，为跳表分配内存
   Arena arena_;
-  /// 存放数据的底层结构，跳表
-  Table table_;
+  /// 存放数据的底层结构，默认为跳表
+  MemTableRep* table_;
+  /// 布隆过滤器，未启用时为nullptr
+  MemTableBloom* bloom_;
+  /// 不为nullptr时，布隆过滤器按user key的前缀过滤
+  const PrefixExtractor* bloom_prefix_extractor_;
+  /// 已插入的record数量
+  std::atomic<uint64_t> num_entries_;
   /// 引用计数
   int refs_;
 };
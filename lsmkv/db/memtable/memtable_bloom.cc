@@ -0,0 +1,68 @@
+#include "db/memtable/memtable_bloom.h"
+
+#include <algorithm>
+
+#include "util/MurmurHash3.h"
+
+namespace lsmkv {
+
+// the block is chosen by the high 32 bits of a 64 bits hash, and the
+// i-th probe takes 9 bits of the low 32 bits multiplied by
+// KProbeMultiplier^i, so the probes are independent of the block even
+// if the number of blocks is a power of 2.
+static const uint32_t KProbeMultiplier = 0x9e3779b9;
+
+static uint64_t BloomHash(std::string_view key) {
+  uint64_t h[2];
+  murmur3::MurmurHash3_x64_128(key.data(), key.size(), 0xbc9f1d34, h);
+  return h[0];
+}
+
+MemTableBloom::MemTableBloom(Arena* arena, size_t bytes, int num_probes)
+    : num_probes_(num_probes) {
+  const size_t block_bytes = KWordsPerBlock * sizeof(uint64_t);
+  num_blocks_ = static_cast<uint32_t>(
+      std::max<size_t>((bytes + block_bytes - 1) / block_bytes, 1));
+  char* mem = arena->AllocateAlign(num_blocks_ * block_bytes);
+  data_ = reinterpret_cast<std::atomic<uint64_t>*>(mem);
+  for (uint32_t i = 0; i < num_blocks_ * KWordsPerBlock; i++) {
+    new (&data_[i]) std::atomic<uint64_t>(0);
+  }
+}
+
+std::atomic<uint64_t>* MemTableBloom::Block(uint64_t h) const {
+  const uint32_t index =
+      static_cast<uint32_t>(((h >> 32) * num_blocks_) >> 32);
+  return data_ + static_cast<size_t>(index) * KWordsPerBlock;
+}
+
+void MemTableBloom::Add(std::string_view key) {
+  const uint64_t hash = BloomHash(key);
+  std::atomic<uint64_t>* block = Block(hash);
+  uint32_t h = static_cast<uint32_t>(hash);
+  for (int i = 0; i < num_probes_; i++) {
+    const uint32_t bit = h >> 23;
+    std::atomic<uint64_t>& word = block[bit / 64];
+    // only one writer, no need of atomic read-modify-write.
+    word.store(word.load(std::memory_order_relaxed) | (1ull << (bit % 64)),
+               std::memory_order_relaxed);
+    h *= KProbeMultiplier;
+  }
+}
+
+bool MemTableBloom::MayContain(std::string_view key) const {
+  const uint64_t hash = BloomHash(key);
+  const std::atomic<uint64_t>* block = Block(hash);
+  uint32_t h = static_cast<uint32_t>(hash);
+  for (int i = 0; i < num_probes_; i++) {
+    const uint32_t bit = h >> 23;
+    if ((block[bit / 64].load(std::memory_order_relaxed) &
+         (1ull << (bit % 64))) == 0) {
+      return false;
+    }
+    h *= KProbeMultiplier;
+  }
+  return true;
+}
+
+}  // namespace lsmkv
@@ -0,0 +1,53 @@
+#ifndef MEMTABLE_BLOOM_H
+#define MEMTABLE_BLOOM_H
+/**
+ * @file memtable_bloom.h
+ * @brief 内存表的布隆过滤器，用于快速排除不在内存表中的key
+ */
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+#include "db/memtable/arena.h"
+
+namespace lsmkv {
+
+class MemTableBloom {
+ public:
+  /**
+   * @param[in] arena 为过滤器的位数组分配内存
+   * @param[in] bytes 位数组的近似大小
+   * @param[in] num_probes 每个key设置的位数
+   */
+  MemTableBloom(Arena* arena, size_t bytes, int num_probes = 6);
+
+  MemTableBloom(const MemTableBloom&) = delete;
+  MemTableBloom& operator=(const MemTableBloom&) = delete;
+
+  /**
+   * @brief 加入一个key
+   * @note 写者之间需要外部同步，可以与读者并发
+   */
+  void Add(std::string_view key);
+
+  /**
+   * @brief 判断key是否可能被加入过
+   * @retval false key一定没有被加入过
+   */
+  bool MayContain(std::string_view key) const;
+
+ private:
+  /// 每个key的所有位都在一个缓存行内，一次查询只访问一个缓存行
+  static constexpr uint32_t KWordsPerBlock = 8;
+
+  /// 由64位hash的高32位选择缓存行
+  std::atomic<uint64_t>* Block(uint64_t h) const;
+
+  uint32_t num_blocks_;
+  const int num_probes_;
+  std::atomic<uint64_t>* data_;
+};
+
+}  // namespace lsmkv
+
+#endif  // MEMTABLE_BLOOM_H
@@ -0,0 +1,280 @@
+#include "db/memtable/memtable_rep.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "db/memtable/skiplist.h"
+#include "include/prefix_extractor.h"
+#include "util/MurmurHash3.h"
+#include "util/mutex.h"
+
+namespace lsmkv {
+
+int MemTableKeyComparator::operator()(const char* a, const char* b) const {
+  std::string_view as = DecodeLengthPrefixedSlice(a);
+  std::string_view bs = DecodeLengthPrefixedSlice(b);
+  return comparator.Compare(as, bs);
+}
+
+uint64_t MemTableKeyComparator::Prefix(const char* record) const {
+  if (!bytewise) {
+    return 0;
+  }
+  std::string_view user_key =
+      ExtractUserKey(DecodeLengthPrefixedSlice(record));
+  const size_t n = std::min<size_t>(user_key.size(), 8);
+  uint64_t prefix = 0;
+  for (size_t i = 0; i < n; i++) {
+    prefix |= static_cast<uint64_t>(static_cast<uint8_t>(user_key[i]))
+              << (56 - 8 * i);
+  }
+  return prefix;
+}
+
+namespace {
+
+using Table = SkipList<const char*, MemTableKeyComparator>;
+
+class SkipListRep : public MemTableRep {
+ public:
+  SkipListRep(const MemTableKeyComparator& cmp, Arena* arena)
+      : arena_(arena), table_(cmp, arena) {}
+
+  void Insert(const char* record) override { table_.Insert(record); }
+
+  void Insert(const char* record, void** hint) override {
+    Table::Splice* splice = reinterpret_cast<Table::Splice*>(*hint);
+    if (splice == nullptr) {
+      splice = new (arena_->AllocateAlign(sizeof(Table::Splice))) Table::Splice;
+      *hint = splice;
+    }
+    table_.Insert(record, splice);
+  }
+
+  const char* Lookup(const char* key) const override {
+    Table::Iterator iter(&table_);
+    iter.Seek(key);
+    return iter.Valid() ? iter.key() : nullptr;
+  }
+
+  class SkipListIterator : public MemTableRep::Iterator {
+   public:
+    explicit SkipListIterator(const Table* table) : iter_(table) {}
+
+    bool Valid() const override { return iter_.Valid(); }
+
+    const char* key() const override { return iter_.key(); }
+
+    void Next() override { iter_.Next(); }
+
+    void Prev() override { iter_.Prev(); }
+
+    void Seek(const char* key) override { iter_.Seek(key); }
+
+    void SeekToFirst() override { iter_.SeekToFirst(); }
+
+    void SeekToLast() override { iter_.SeekToLast(); }
+
+   private:
+    Table::Iterator iter_;
+  };
+
+  Iterator* NewIterator() override { return new SkipListIterator(&table_); }
+
+ private:
+  Arena* const arena_;
+  Table table_;
+};
+
+// iterate the records sorted in a vector owned by the iterator.
+class SortedVectorIterator : public MemTableRep::Iterator {
+ public:
+  SortedVectorIterator(const MemTableKeyComparator& cmp,
+                       std::vector<const char*>* records)
+      : cmp_(cmp), index_(0) {
+    records_.swap(*records);
+    std::sort(records_.begin(), records_.end(),
+              [this](const char* a, const char* b) { return cmp_(a, b) < 0; });
+    index_ = records_.size();
+  }
+
+  bool Valid() const override { return index_ < records_.size(); }
+
+  const char* key() const override {
+    assert(Valid());
+    return records_[index_];
+  }
+
+  void Next() override {
+    assert(Valid());
+    index_++;
+  }
+
+  void Prev() override {
+    assert(Valid());
+    index_ = (index_ == 0 ? records_.size() : index_ - 1);
+  }
+
+  void Seek(const char* key) override {
+    index_ = std::lower_bound(records_.begin(), records_.end(), key,
+                              [this](const char* a, const char* b) {
+                                return cmp_(a, b) < 0;
+                              }) -
+             records_.begin();
+  }
+
+  void SeekToFirst() override { index_ = 0; }
+
+  void SeekToLast() override {
+    index_ = (records_.empty() ? 0 : records_.size() - 1);
+  }
+
+ private:
+  const MemTableKeyComparator cmp_;
+  std::vector<const char*> records_;
+  size_t index_;
+};
+
+class HashSkipListRep : public MemTableRep {
+ public:
+  HashSkipListRep(const MemTableKeyComparator& cmp, Arena* arena,
+                  const PrefixExtractor* prefix_extractor, size_t bucket_num)
+      : cmp_(cmp),
+        arena_(arena),
+        prefix_extractor_(prefix_extractor),
+        bucket_num_(std::max<size_t>(bucket_num, 1)),
+        buckets_(new std::atomic<Table*>[bucket_num_]) {
+    for (size_t i = 0; i < bucket_num_; i++) {
+      buckets_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  void Insert(const char* record) override {
+    std::atomic<Table*>& bucket = buckets_[BucketIndex(record)];
+    Table* table = bucket.load(std::memory_order_relaxed);
+    if (table == nullptr) {
+      char* mem = arena_->AllocateAlign(sizeof(Table));
+      table = new (mem) Table(cmp_, arena_);
+      bucket.store(table, std::memory_order_release);
+    }
+    table->Insert(record);
+  }
+
+  const char* Lookup(const char* key) const override {
+    Table* table = buckets_[BucketIndex(key)].load(std::memory_order_acquire);
+    if (table == nullptr) {
+      return nullptr;
+    }
+    Table::Iterator iter(table);
+    iter.Seek(key);
+    return iter.Valid() ? iter.key() : nullptr;
+  }
+
+  Iterator* NewIterator() override {
+    std::vector<const char*> records;
+    for (size_t i = 0; i < bucket_num_; i++) {
+      Table* table = buckets_[i].load(std::memory_order_acquire);
+      if (table == nullptr) {
+        continue;
+      }
+      Table::Iterator iter(table);
+      for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+        records.push_back(iter.key());
+      }
+    }
+    return new SortedVectorIterator(cmp_, &records);
+  }
+
+ private:
+  size_t BucketIndex(const char* record) const {
+    std::string_view user_key =
+        ExtractUserKey(DecodeLengthPrefixedSlice(record));
+    std::string_view prefix =
+        (prefix_extractor_ == nullptr ? user_key
+                                      : prefix_extractor_->Transform(user_key));
+    return murmur3::MurmurHash3_x86_32(prefix.data(), prefix.size(), 0) %
+           bucket_num_;
+  }
+
+  const MemTableKeyComparator cmp_;
+  Arena* const arena_;
+  const PrefixExtractor* const prefix_extractor_;
+  const size_t bucket_num_;
+  // not in the arena, the fixed bucket array is not charged to the
+  // memtable, which may be smaller than it.
+  const std::unique_ptr<std::atomic<Table*>[]> buckets_;
+};
+
+class VectorRep : public MemTableRep {
+ public:
+  explicit VectorRep(const MemTableKeyComparator& cmp)
+      : cmp_(cmp), sorted_num_(0) {}
+
+  void Insert(const char* record) override {
+    MutexLock l(&mu_);
+    records_.push_back(record);
+  }
+
+  const char* Lookup(const char* key) const override {
+    MutexLock l(&mu_);
+    Sort();
+    auto it = std::lower_bound(
+        records_.begin(), records_.end(), key,
+        [this](const char* a, const char* b) { return cmp_(a, b) < 0; });
+    return it == records_.end() ? nullptr : *it;
+  }
+
+  Iterator* NewIterator() override {
+    std::vector<const char*> records;
+    {
+      MutexLock l(&mu_);
+      Sort();
+      records = records_;
+    }
+    return new SortedVectorIterator(cmp_, &records);
+  }
+
+  size_t ApproximateMemoryUsage() const override {
+    MutexLock l(&mu_);
+    return records_.capacity() * sizeof(const char*);
+  }
+
+ private:
+  // sort the records inserted since the last sort, and merge them into
+  // the sorted ones.
+  void Sort() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (sorted_num_ == records_.size()) {
+      return;
+    }
+    auto less = [this](const char* a, const char* b) {
+      return cmp_(a, b) < 0;
+    };
+    std::sort(records_.begin() + sorted_num_, records_.end(), less);
+    std::inplace_merge(records_.begin(), records_.begin() + sorted_num_,
+                       records_.end(), less);
+    sorted_num_ = records_.size();
+  }
+
+  const MemTableKeyComparator cmp_;
+  mutable Mutex mu_;
+  mutable std::vector<const char*> records_ GUARDED_BY(mu_);
+  // records_[0, sorted_num_) are sorted
+  mutable size_t sorted_num_ GUARDED_BY(mu_);
+};
+
+}  // namespace
+
+MemTableRep* NewMemTableRep(const Option& option,
+                            const MemTableKeyComparator& cmp, Arena* arena) {
+  switch (option.memtable_rep) {
+    case KHashSkipListRep:
+      return new HashSkipListRep(cmp, arena, option.prefix_extractor,
+                                 option.memtable_hash_bucket_num);
+    case KVectorRep:
+      return new VectorRep(cmp);
+    case KSkipListRep:
+    default:
+      return new SkipListRep(cmp, arena);
+  }
+}
+}  // namespace lsmkv
@@ -0,0 +1,104 @@
+#ifndef MEMTABLE_REP_H
+#define MEMTABLE_REP_H
+/**
+ * @file memtable_rep.h
+ * @brief 内存表的底层结构，保存由Arena分配的record
+ */
+#include "db/format/internal_key.h"
+#include "db/memtable/arena.h"
+#include "include/option.h"
+
+namespace lsmkv {
+
+/**
+ * @brief 解码一个长度前缀编码的字符串
+ */
+inline std::string_view DecodeLengthPrefixedSlice(const char* p) {
+  uint32_t len;
+  const char* q = DecodeVarint32(p, p + 5, &len);
+  return std::string_view(q, len);
+}
+
+/**
+ * @brief record之间的比较器，按record中的internal key比较
+ */
+struct MemTableKeyComparator {
+  const InternalKeyComparator comparator;
+  /// user key按字节序比较时，record的前缀才与比较结果一致
+  const bool bytewise;
+  explicit MemTableKeyComparator(const InternalKeyComparator& cmp)
+      : comparator(cmp),
+        bytewise(cmp.UserComparator() == DefaultComparator()) {}
+  int operator()(const char* a, const char* b) const;
+
+  /**
+   * @brief record中user key的前8个字节，按大端序组成的整数
+   * @details 前缀不同的两个record，前缀的大小关系即record的大小关系，
+   *          跳表节点保存该前缀，多数比较不用访问record
+   */
+  uint64_t Prefix(const char* record) const;
+};
+
+class MemTableRep {
+ public:
+  class Iterator {
+   public:
+    virtual ~Iterator() = default;
+
+    virtual bool Valid() const = 0;
+
+    virtual const char* key() const = 0;
+
+    virtual void Next() = 0;
+
+    virtual void Prev() = 0;
+
+    virtual void Seek(const char* key) = 0;
+
+    virtual void SeekToFirst() = 0;
+
+    virtual void SeekToLast() = 0;
+  };
+
+  virtual ~MemTableRep() = default;
+
+  /**
+   * @brief 插入一个record
+   * @note 写者之间需要外部同步，可以与读者并发
+   */
+  virtual void Insert(const char* record) = 0;
+
+  /**
+   * @brief 利用插入位置的缓存插入一个record
+   * @param[in,out] hint 同一写者连续插入时共用，初始为nullptr，
+   *                     其内存由MemTableRep管理
+   */
+  virtual void Insert(const char* record, void** hint) { Insert(record); }
+
+  /**
+   * @brief 点查询，找到一个大于等于key的record
+   * @return 若存在与key的user key相同且大于等于key的record，
+   *         返回其中最小的，否则返回其他record或nullptr
+   */
+  virtual const char* Lookup(const char* key) const = 0;
+
+  /**
+   * @brief 生成一个有序遍历所有record的迭代器
+   */
+  virtual Iterator* NewIterator() = 0;
+
+  /**
+   * @brief 返回Arena之外使用的近似内存大小
+   */
+  virtual size_t ApproximateMemoryUsage() const { return 0; }
+};
+
+/**
+ * @brief 按option.memtable_rep创建内存表的底层结构
+ */
+MemTableRep* NewMemTableRep(const Option& option,
+                            const MemTableKeyComparator& cmp, Arena* arena);
+
+}  // namespace lsmkv
+
+#endif  // MEMTABLE_REP_H
@@ -5,15 +5,51 @@
 #include <cassert>
 #include <iostream>
 #include <random>
+#include <type_traits>
+#include <utility>
 
 #include "db/memtable/arena.h"
 namespace lsmkv {
 
+/**
+ * @brief 取key的定长前缀，Comparator提供Prefix(key)时使用它
+ * @details 前缀的大小关系必须与key的大小关系一致，即前缀不同时，
+ *          前缀小的key也更小。不提供时前缀均为0，总是比较完整的key
+ */
+template <class Comparator, typename Key, typename = void>
+struct SkipListKeyPrefix {
+  static uint64_t Get(const Comparator&, const Key&) { return 0; }
+};
+
+template <class Comparator, typename Key>
+struct SkipListKeyPrefix<
+    Comparator, Key,
+    std::void_t<decltype(std::declval<const Comparator&>().Prefix(
+        std::declval<const Key&>()))>> {
+  static uint64_t Get(const Comparator& cmp, const Key& key) {
+    return cmp.Prefix(key);
+  }
+};
+
+/**
+ * @brief 预取addr处的内存到缓存
+ */
+inline void SkipListPrefetch(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(addr, 0, 1);
+#else
+  (void)addr;
+#endif
+}
+
 template <typename Key, class Comparator>
 class SkipList {
  private:
   struct Node;
 
+  /// 跳表中节点的最大高度
+  static constexpr int KMaxHeight = 12;
+
  public:
   explicit SkipList(Comparator cmp_, Arena* arena);
 
@@ -26,6 +62,26 @@ class SkipList {
    */
   void Insert(const Key& key);
 
+  /**
+   * @brief 插入位置的缓存，记录上次插入时每一层的前驱和后继节点
+   */
+  struct Splice {
+    Splice() : height(0) {}
+    /// 记录的层数，0表示无效
+    int height;
+    Node* prev[KMaxHeight];
+    Node* next[KMaxHeight];
+  };
+
+  /**
+   * @brief 利用上次插入的位置插入一个跳表节点
+   * @details 新key紧跟在上次插入的key之后时(如按时间递增的key)，
+   *          只需在最低的几层查找，接近O(1)
+   * @param[in] key 插入节点的key
+   * @param[in,out] splice 插入位置的缓存，由同一写者的连续插入共用
+   */
+  void Insert(const Key& key, Splice* splice);
+
   /**
    * @brief 判断一个key在不在跳表中
    * @param[in] key 节点的key
@@ -37,7 +93,9 @@ class SkipList {
 
   class Iterator {
    public:
-    explicit Iterator(const SkipList* list) : list_(list), node_(nullptr) {}
+    explicit Iterator(const SkipList* list) : list_(list), node_(nullptr) {
+      for (int i = 0; i < KMaxHeight; i++) finger_[i] = list_->head_;
+    }
 
     bool Valid() const { return node_ != nullptr; }
 
@@ -62,19 +120,35 @@ class SkipList {
    private:
     const SkipList* list_;
     Node* node_;
+    /// 上次Seek时每一层小于目标key的最后一个节点，向后Seek时从这里开始
+    Node* finger_[KMaxHeight];
   };
 
  private:
-  /// 跳表中节点的最大高度
-  static constexpr int KMaxHeight = 12;
-
   /**
    * @brief 生成一个新的跳表节点
    * @param[in] key 节点的key
    * @param[in] height 节点的高度
    * @return Node* 指向新节点的指针
    */
-  Node* NewNode(const Key& key, int height);
+  Node* NewNode(const Key& key, int height, uint64_t prefix);
+
+  /**
+   * @brief 返回key的前缀
+   */
+  uint64_t KeyPrefix(const Key& key) const {
+    return SkipListKeyPrefix<Comparator, Key>::Get(cmp_, key);
+  }
+
+  /**
+   * @brief 判断key是否比节点node的key大
+   * @details 先比较节点内保存的前缀，前缀相同时才比较完整的key
+   */
+  bool KeyIsAfterNode(const Key& key, uint64_t prefix, Node* node) const {
+    if (node == nullptr) return false;
+    if (prefix != node->prefix_) return prefix > node->prefix_;
+    return cmp_(key, node->key_) > 0;
+  }
 
   /**
    * @brief 通过随机概率算法得到新跳表节点的高度
@@ -93,6 +167,13 @@ class SkipList {
    */
   Node* FindGreaterOrEqual(const Key& key, Node** prev) const;
 
+  /**
+   * @brief 从第level层的节点start开始，找到比key大或相等的第一个节点
+   * @note start必须比key小，或者是头节点
+   */
+  Node* FindGreaterOrEqualFrom(const Key& key, Node* start, int level,
+                               Node** prev) const;
+
   /**
    * @brief 找到比key小或相等，但最接近key的节点
    */
@@ -112,13 +193,13 @@ class SkipList {
   Node* head_;
   /// 跳表当前的最大高度
   std::atomic<int> max_height_;
-  /// 用于随机概率算法
-  std::mt19937 rng_;
+  /// 用于随机概率算法，状态很小，使每个哈希桶的跳表开销可以忽略
+  std::minstd_rand rng_;
 };
 
 template <typename Key, typename Comparator>
 struct SkipList<Key, Comparator>::Node {
-  explicit Node(const Key& key) : key_(key) {}
+  Node(const Key& key, uint64_t prefix) : key_(key), prefix_(prefix) {}
   Node* Next(int level) {
     assert(level >= 0);
     return next_[level].load(std::memory_order_acquire);
@@ -136,6 +217,8 @@ struct SkipList<Key, Comparator>::Node {
     next_[level].store(x, std::memory_order_relaxed);
   }
   Key const key_;
+  /// key的前缀，与next_在同一缓存行，多数比较不用访问key
+  uint64_t const prefix_;
   std::atomic<Node*> next_[1];
 };
 
@@ -143,18 +226,18 @@ template <typename Key, class Comparator>
 SkipList<Key, Comparator>::SkipList(Comparator cmp, Arena* arena)
     : cmp_(cmp),
       arena_(arena),
-      head_(NewNode(0, KMaxHeight)),
+      head_(NewNode(0, KMaxHeight, 0)),
       max_height_(1),
-      rng_(std::random_device{}()) {
+      rng_(0xdeadbeef) {
   for (int i = 0; i < KMaxHeight; i++) head_->SetNext(i, nullptr);
 }
 
 template <typename Key, class Comparator>
 typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::NewNode(
-    const Key& key, int height) {
+    const Key& key, int height, uint64_t prefix) {
   char* const node_memory = arena_->AllocateAlign(
       sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1));
-  return new (node_memory) Node(key);
+  return new (node_memory) Node(key, prefix);
 }
 
 template <typename Key, class Comparator>
@@ -171,11 +254,25 @@ template <typename Key, class Comparator>
 typename SkipList<Key, Comparator>::Node*
 SkipList<Key, Comparator>::FindGreaterOrEqual(const Key& key,
                                               Node** prev) const {
-  Node* ret = head_;
-  int height = GetMaxHeight() - 1;
+  return FindGreaterOrEqualFrom(key, head_, GetMaxHeight() - 1, prev);
+}
+
+template <typename Key, class Comparator>
+typename SkipList<Key, Comparator>::Node*
+SkipList<Key, Comparator>::FindGreaterOrEqualFrom(const Key& key, Node* start,
+                                                  int level,
+                                                  Node** prev) const {
+  Node* ret = start;
+  int height = level;
+  const uint64_t prefix = KeyPrefix(key);
   while (true) {
-    Node* next = ret->next_[height];
-    if (next != nullptr && cmp_(key, next->key_) > 0) {
+    Node* next = ret->Next(height);
+    if (next != nullptr) {
+      // the next node of this level is the next to compare if key is
+      // after "next", or "next" is compared again in the lower level.
+      SkipListPrefetch(next->RelaxedNext(height));
+    }
+    if (KeyIsAfterNode(key, prefix, next)) {
       ret = next;
     } else {
       if (prev != nullptr) prev[height] = ret;
@@ -190,9 +287,10 @@ typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::FindLess(
     const Key& key) const {
   Node* ret = head_;
   int height = GetMaxHeight() - 1;
+  const uint64_t prefix = KeyPrefix(key);
   while (true) {
-    Node* next = ret->next_[height];
-    if (next != nullptr && cmp_(key, next->key_) > 0) {
+    Node* next = ret->Next(height);
+    if (KeyIsAfterNode(key, prefix, next)) {
       ret = next;
     } else {
       if (height == 0) return ret;
@@ -223,7 +321,7 @@ void SkipList<Key, Comparator>::Insert(const Key& key) {
   Node* next = FindGreaterOrEqual(key, prev);
 
   int height = RandomHeight();
-  Node* node = NewNode(key, height);
+  Node* node = NewNode(key, height, KeyPrefix(key));
 
   if (height > GetMaxHeight()) {
     for (int i = GetMaxHeight(); i < height; i++) {
@@ -241,6 +339,57 @@ void SkipList<Key, Comparator>::Insert(const Key& key) {
   }
 }
 
+template <typename Key, class Comparator>
+void SkipList<Key, Comparator>::Insert(const Key& key, Splice* splice) {
+  const int max_height = GetMaxHeight();
+  const uint64_t prefix = KeyPrefix(key);
+  // find the lowest level whose cached prev and next still surround key,
+  // the levels below it are searched again between them.
+  int recompute_level = 0;
+  if (splice->height < max_height) {
+    recompute_level = max_height;
+  } else {
+    while (recompute_level < max_height) {
+      Node* prev = splice->prev[recompute_level];
+      Node* next = splice->next[recompute_level];
+      if (prev->Next(recompute_level) == next &&
+          (prev == head_ || KeyIsAfterNode(key, prefix, prev)) &&
+          (next == nullptr || !KeyIsAfterNode(key, prefix, next))) {
+        break;
+      }
+      recompute_level++;
+    }
+  }
+  for (int i = recompute_level - 1; i >= 0; i--) {
+    Node* prev = (i + 1 < max_height ? splice->prev[i + 1] : head_);
+    Node* next = prev->Next(i);
+    while (KeyIsAfterNode(key, prefix, next)) {
+      prev = next;
+      next = next->Next(i);
+    }
+    splice->prev[i] = prev;
+    splice->next[i] = next;
+  }
+  splice->height = max_height;
+
+  int height = RandomHeight();
+  Node* node = NewNode(key, height, prefix);
+  if (height > max_height) {
+    for (int i = max_height; i < height; i++) {
+      splice->prev[i] = head_;
+      splice->next[i] = nullptr;
+    }
+    max_height_.store(height, std::memory_order_relaxed);
+    splice->height = height;
+  }
+  for (int i = 0; i < height; i++) {
+    node->RelaxedSetNext(i, splice->next[i]);
+    splice->prev[i]->SetNext(i, node);
+    // the next key is likely to be inserted after this one.
+    splice->prev[i] = node;
+  }
+}
+
 template <typename Key, class Comparator>
 bool SkipList<Key, Comparator>::Contain(const Key& key) {
   Node* node = FindGreaterOrEqual(key, nullptr);
@@ -263,7 +412,26 @@ void SkipList<Key, Comparator>::Iterator::SeekToFirst() {
 
 template <typename Key, class Comparator>
 void SkipList<Key, Comparator>::Iterator::Seek(const Key& key) {
-  node_ = list_->FindGreaterOrEqual(key, nullptr);
+  // start from the lowest level of the finger surrounding key, so a
+  // forward seek near the last one only searches the low levels.
+  const int max_height = list_->GetMaxHeight();
+  const uint64_t prefix = list_->KeyPrefix(key);
+  Node* start = list_->head_;
+  int level = max_height - 1;
+  for (int i = 0; i < max_height; i++) {
+    Node* finger = finger_[i];
+    if (finger != list_->head_ &&
+        !list_->KeyIsAfterNode(key, prefix, finger)) {
+      continue;
+    }
+    Node* next = finger->Next(i);
+    if (!list_->KeyIsAfterNode(key, prefix, next)) {
+      start = finger;
+      level = i;
+      break;
+    }
+  }
+  node_ = list_->FindGreaterOrEqualFrom(key, start, level, finger_);
 }
 
 template <typename Key, class Comparator>
@@ -0,0 +1,199 @@
+#include "include/sharded_db.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#include "db/dbimpl.h"
+#include "db/writebatch/writebatch_helper.h"
+#include "include/cache.h"
+#include "include/comparator.h"
+#include "include/env.h"
+#include "util/MurmurHash3.h"
+
+namespace lsmkv {
+
+static const int KMinTableCacheSize = 64;
+
+static std::string ShardName(const std::string& name, size_t index) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "/shard-%03zu", index);
+  return name + buf;
+}
+
+static size_t ShardNum(const ShardingOption& sharding) {
+  if (sharding.type == KRangeSharding) {
+    return sharding.boundaries.size() + 1;
+  }
+  return std::max(sharding.shard_num, 1);
+}
+
+// split a WriteBatch into the batches of the shards
+class ShardSplitter : public WriteBatch::Handle {
+ public:
+  ShardSplitter(const ShardedDB* db, std::vector<WriteBatch>* batches)
+      : db_(db), batches_(batches) {}
+
+  void Put(std::string_view key, std::string_view value) override {
+    (*batches_)[db_->ShardOf(key)].Put(key, value);
+  }
+
+  void Delete(std::string_view key) override {
+    (*batches_)[db_->ShardOf(key)].Delete(key);
+  }
+
+ private:
+  const ShardedDB* const db_;
+  std::vector<WriteBatch>* const batches_;
+};
+
+ShardedDB::ShardedDB(const Option& option, const ShardingOption& sharding)
+    : option_(option), sharding_(sharding), table_cache_(nullptr) {}
+
+ShardedDB::~ShardedDB() {
+  for (DB* shard : shards_) {
+    delete shard;
+  }
+  delete table_cache_;
+}
+
+Status ShardedDB::Open(const Option& option, const ShardingOption& sharding,
+                       const std::string& name, DB** ptr) {
+  *ptr = nullptr;
+  if (sharding.type == KRangeSharding) {
+    const Comparator* cmp = option.comparator;
+    for (size_t i = 1; i < sharding.boundaries.size(); i++) {
+      if (cmp->Compare(sharding.boundaries[i - 1], sharding.boundaries[i]) >=
+          0) {
+        return Status::InvalidArgument("sharding boundaries are not sorted");
+      }
+    }
+  }
+  const size_t shard_num = ShardNum(sharding);
+  ShardedDB* db = new ShardedDB(option, sharding);
+  if (option.table_cache == nullptr) {
+    const int capacity =
+        option.max_open_file - KNumNonTableCache * static_cast<int>(shard_num);
+    db->table_cache_ = NewLRUCache(std::max(capacity, KMinTableCacheSize));
+  }
+  Option shard_option = option;
+  if (db->table_cache_ != nullptr) {
+    shard_option.table_cache = db->table_cache_;
+  }
+  option.env->CreatDir(name);
+  Status s;
+  for (size_t i = 0; i < shard_num && s.ok(); i++) {
+    DB* shard = nullptr;
+    s = DB::Open(shard_option, ShardName(name, i), &shard);
+    if (s.ok()) {
+      db->shards_.push_back(shard);
+    }
+  }
+  if (s.ok()) {
+    *ptr = db;
+  } else {
+    delete db;
+  }
+  return s;
+}
+
+size_t ShardedDB::ShardOf(std::string_view key) const {
+  if (sharding_.type == KRangeSharding) {
+    const Comparator* cmp = option_.comparator;
+    return std::upper_bound(sharding_.boundaries.begin(),
+                            sharding_.boundaries.end(), key,
+                            [cmp](std::string_view a, const std::string& b) {
+                              return cmp->Compare(a, b) < 0;
+                            }) -
+           sharding_.boundaries.begin();
+  }
+  return murmur3::MurmurHash3_x86_32(key.data(), key.size(), 0) %
+         shards_.size();
+}
+
+Status ShardedDB::Get(const ReadOption& option, std::string_view key,
+                      std::string* value) {
+  return shards_[ShardOf(key)]->Get(option, key, value);
+}
+
+Status ShardedDB::Put(const WriteOption& option, std::string_view key,
+                      std::string_view value) {
+  return shards_[ShardOf(key)]->Put(option, key, value);
+}
+
+Status ShardedDB::Delete(const WriteOption& option, std::string_view key) {
+  return shards_[ShardOf(key)]->Delete(option, key);
+}
+
+Status ShardedDB::Write(const WriteOption& option, WriteBatch* batch) {
+  std::vector<WriteBatch> batches(shards_.size());
+  ShardSplitter splitter(this, &batches);
+  Status s = batch->Iterate(&splitter);
+  for (size_t i = 0; i < shards_.size() && s.ok(); i++) {
+    if (WriteBatchHelper::GetCount(&batches[i]) == 0) {
+      continue;
+    }
+    s = shards_[i]->Write(option, &batches[i]);
+  }
+  return s;
+}
+
+std::vector<Status> ShardedDB::MultiGet(
+    const ReadOption& option, const std::vector<std::string_view>& keys,
+    std::vector<std::string>* values) {
+  std::vector<Status> ret(keys.size());
+  values->resize(keys.size());
+  // group the keys by shards, each shard is looked up once.
+  std::vector<std::vector<size_t>> indexes(shards_.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    indexes[ShardOf(keys[i])].push_back(i);
+  }
+  // the shards are looked up in parallel, the calling thread looks up the
+  // last one itself.
+  auto lookup = [&](size_t k) {
+    std::vector<std::string_view> shard_keys;
+    for (size_t i : indexes[k]) {
+      shard_keys.push_back(keys[i]);
+    }
+    std::vector<std::string> shard_values;
+    std::vector<Status> shard_ret =
+        shards_[k]->MultiGet(option, shard_keys, &shard_values);
+    for (size_t j = 0; j < indexes[k].size(); j++) {
+      ret[indexes[k][j]] = shard_ret[j];
+      (*values)[indexes[k][j]].swap(shard_values[j]);
+    }
+  };
+  std::vector<size_t> lookup_shards;
+  for (size_t k = 0; k < shards_.size(); k++) {
+    if (!indexes[k].empty()) {
+      lookup_shards.push_back(k);
+    }
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i + 1 < lookup_shards.size(); i++) {
+    threads.emplace_back(lookup, lookup_shards[i]);
+  }
+  if (!lookup_shards.empty()) {
+    lookup(lookup_shards.back());
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return ret;
+}
+
+Status DestoryShardedDB(const Option& option, const ShardingOption& sharding,
+                        const std::string& name) {
+  Status s;
+  const size_t shard_num = ShardNum(sharding);
+  for (size_t i = 0; i < shard_num; i++) {
+    Status del_s = DestoryDB(option, ShardName(name, i));
+    if (!del_s.ok() && s.ok()) {
+      s = del_s;
+    }
+  }
+  option.env->RemoveDir(name);
+  return s;
+}
+
+}  // namespace lsmkv
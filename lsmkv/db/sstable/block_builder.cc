@@ -2,11 +2,14 @@
 #include <algorithm>
 
 #include "db/sstable/block_builder.h"
+#include "db/format/internal_key.h"
+#include "db/sstable/block_format.h"
 #include "util/coding.h"
 namespace lsmkv {
 
-BlockBuilder::BlockBuilder(const Option* option)
-    : option_(option), restarts_(), counter_(0), finished_(false) {
+BlockBuilder::BlockBuilder(const Option* option, bool hash_index)
+    : option_(option), restarts_(), counter_(0), finished_(false),
+      hash_index_(hash_index) {
         restarts_.push_back(0);
     }
 void BlockBuilder::Add(std::string_view key, std::string_view value) {
@@ -22,6 +25,16 @@ void BlockBuilder::Add(std::string_view key, std::string_view value) {
         restarts_.push_back(buffer_.size());
         counter_ = 0;
     }
+    if (hash_index_) {
+        std::string_view user_key = ExtractUserKey(key);
+        // the versions of one user key in the same restart share an entry.
+        if (shared < user_key.size() || key.size() != last_key.size() ||
+                hash_entries_.empty() ||
+                hash_entries_.back().second != restarts_.size() - 1) {
+            hash_entries_.emplace_back(BlockHashIndexHash(user_key),
+                                       restarts_.size() - 1);
+        }
+    }
     size_t non_shard = key.size() - shared;
     PutVarint32(&buffer_, shared);
     PutVarint32(&buffer_, non_shard);
@@ -38,7 +51,26 @@ std::string_view BlockBuilder::Finish() {
     for (uint32_t restart : restarts_) {
         PutFixed32(&buffer_, restart);
     }
-    PutFixed32(&buffer_, restarts_.size());
+    if (hash_index_ && restarts_.size() <= KHashIndexMaxRestarts) {
+        uint32_t num_buckets = static_cast<uint32_t>(
+            hash_entries_.size() / option_->data_block_hash_util_ratio) + 1;
+        std::string buckets(num_buckets, static_cast<char>(KHashIndexNoEntry));
+        for (const auto& entry : hash_entries_) {
+            uint8_t& bucket =
+                reinterpret_cast<uint8_t&>(buckets[entry.first % num_buckets]);
+            if (bucket == KHashIndexNoEntry) {
+                bucket = static_cast<uint8_t>(entry.second);
+            } else if (bucket != entry.second) {
+                bucket = KHashIndexCollision;
+            }
+        }
+        buffer_.append(buckets);
+        PutFixed32(&buffer_, num_buckets);
+        PutFixed32(&buffer_, restarts_.size() | KBlockHashIndexFlag);
+    } else {
+        // too many restarts for a byte, fall back to binary search.
+        PutFixed32(&buffer_, restarts_.size());
+    }
     finished_ = true;
     return std::string_view(buffer_);
 }
@@ -47,8 +79,14 @@ size_t BlockBuilder::ByteSize() const {
     if (finished_) {
         return buffer_.size();
     } else {
+        size_t hash_index_size = 0;
+        if (hash_index_) {
+            hash_index_size = hash_entries_.size() /
+                    option_->data_block_hash_util_ratio + 1 + sizeof(uint32_t);
+        }
         return (buffer_.size() +                        // actual key - value
                 restarts_.size() * sizeof(uint32_t) +   // restarts_
+                hash_index_size +                       // hash index
                 sizeof(uint32_t));                      // restart num
     }
 }
@@ -58,6 +96,7 @@ void BlockBuilder::Reset() {
     restarts_.clear();
     counter_ = 0;
     last_key_.clear();
+    hash_entries_.clear();
     finished_ = false;
     restarts_.push_back(0);
 }
@@ -9,7 +9,9 @@ namespace lsmkv {
 
 class BlockBuilder {
  public:
-    explicit BlockBuilder(const Option* option);
+    // if "hash_index" is true, a hash index from the user keys to the
+    // restarts is appended, the keys added must be internal keys.
+    explicit BlockBuilder(const Option* option, bool hash_index = false);
 
     BlockBuilder(const BlockBuilder &) = delete;
     BlockBuilder &operator=(const BlockBuilder &) = delete;
@@ -34,6 +36,9 @@ private:
     // last key has been addd.
     std::string last_key_;
     bool finished_;
+    const bool hash_index_;
+    // the hash of user key and its restart index
+    std::vector<std::pair<uint32_t, uint32_t>> hash_entries_;
 };
 }
 
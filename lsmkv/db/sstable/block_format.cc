@@ -1,8 +1,10 @@
+#include <cstring>
+
 #include "crc32c/crc32c.h"
 #include "db/sstable/block_format.h" 
 #include "util/coding.h"
+#include "util/compression.h"
 #include "include/option.h"
-#include "snappy.h"
 
 namespace lsmkv {
 
@@ -25,9 +27,10 @@ void BlockHandle::EncodeTo(std::string* dst) {
 Status Footer::DecodeFrom(std::string_view* input) {
     const char* magic_ptr = input->data() + KEncodeLength - 8;
     uint64_t magic = DecodeFixed64(magic_ptr);
-    if (magic != KFooterMagicNum) {
+    if (magic != KFooterMagicNum && magic != KPartitionedFooterMagicNum) {
         return Status::Corruption("not a sstable");
     }
+    partitioned_ = (magic == KPartitionedFooterMagicNum);
     Status s = index_block_handle_.DecodeFrom(input);
     if (s.ok()) {
         s = filter_index_handle_.DecodeFrom(input);
@@ -43,11 +46,33 @@ void Footer::EncodeTo(std::string* dst) {
     index_block_handle_.EncodeTo(dst);
     filter_index_handle_.EncodeTo(dst);
     dst->resize(2 * BlockHandle::KMaxEncodeLength);
-    PutFixed64(dst, KFooterMagicNum);
+    PutFixed64(dst, partitioned_ ? KPartitionedFooterMagicNum : KFooterMagicNum);
+}
+
+Status UncompressBlockContents(const char* data, size_t n,
+        BlockContents* result, const UncompressionDict* dict) {
+    char* uncompress_buf = nullptr;
+    size_t uncompress_len = 0;
+    if (data[n] == KUnCompress) {
+        uncompress_buf = new char[n];
+        memcpy(uncompress_buf, data, n);
+        uncompress_len = n;
+    } else {
+        Status s = UncompressBlock(static_cast<CompressType>(data[n]), data, n,
+                                   &uncompress_buf, &uncompress_len, dict);
+        if (!s.ok()) {
+            return s;
+        }
+    }
+    result->data = std::string_view(uncompress_buf, uncompress_len);
+    result->heap_allocated_ = true;
+    result->table_cache_ = true;
+    return Status::OK();
 }
 
 Status ReadBlock(const ReadOption& option, RandomReadFile* file, 
-        const BlockHandle& handle, BlockContents* result) {
+        const BlockHandle& handle, BlockContents* result,
+        const UncompressionDict* dict, std::string* stored) {
     result->data = std::string_view();
     result->table_cache_ = false;
     result->heap_allocated_ = false;
@@ -72,6 +97,9 @@ Status ReadBlock(const ReadOption& option, RandomReadFile* file,
         }
     }
     
+    if (stored != nullptr) {
+        stored->assign(data, n + 1);
+    }
     switch(data[n]) {
         case KUnCompress:
             if (data != buf) {
@@ -87,27 +115,11 @@ Status ReadBlock(const ReadOption& option, RandomReadFile* file,
                 result->table_cache_ = true;
             }
             break;
-        case KSnappyCompress: {
-            size_t uncompress_len = 0;
-            if (!snappy::GetUncompressedLength(data, n, &uncompress_len)) {
-                delete[] buf;
-                return Status::Corruption("ReadBlock: snappy GetUncompressedLength error");
-            }
-            char* uncompress_buf = new char[uncompress_len];
-            if(!snappy::RawUncompress(data, n, uncompress_buf)) {
-                delete[] buf;
-                delete[] uncompress_buf;
-                return Status::Corruption("ReadBlock: snappy RawUncompress error");
-            }
+        default: {
+            Status status = UncompressBlockContents(data, n, result, dict);
             delete[] buf;
-            result->data = std::string_view(uncompress_buf,uncompress_len);
-            result->heap_allocated_ = true;
-            result->table_cache_ = true;
-            break;
+            return status;
         }
-        default:
-            delete[] buf;
-            return Status::Corruption("ReadBlock: bad block record");
     }
     return Status::OK();
 }
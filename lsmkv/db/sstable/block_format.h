@@ -1,11 +1,15 @@
 #ifndef STORAGE_XDB_DB_SSTABLE_BLOCK_FORMAT_H_
 #define STORAGE_XDB_DB_SSTABLE_BLOCK_FORMAT_H_
 
+#include <string>
 #include <string_view>
 #include "include/status.h"
 #include "include/option.h"
+#include "util/MurmurHash3.h"
 namespace lsmkv {
 
+class UncompressionDict;
+
 struct BlockContents {
     std::string_view data;
     bool heap_allocated_;
@@ -16,6 +20,35 @@ static const size_t KBlockTailSize = 5;
 
 static const uint64_t KFooterMagicNum = 0xaf41de78ull;
 
+// the magic number of the sstables with partitioned index and filter
+static const uint64_t KPartitionedFooterMagicNum = 0xaf41de79ull;
+
+// the key of the zstd dictionary of data blocks in the meta index block,
+// value: the handle of the dictionary block.
+static const char KCompressionDictMetaKey[] = "zstddict";
+
+// the key prefix of the partitioned filter in the meta index block,
+// followed by the name of filter policy.
+static const char KPartitionedFilterMetaPrefix[] = "partitionedfilter";
+
+// the key prefix of the full filter in the meta index block,
+// followed by the name of filter policy.
+static const char KFullFilterMetaPrefix[] = "fullfilter";
+
+// the optional hash index of data block, appended after the restarts:
+// buckets (1 byte each) | 4 bytes num_buckets | 4 bytes num_restarts
+// the highest bit of num_restarts marks a block with hash index,
+// which is never set by the blocks without it.
+static const uint32_t KBlockHashIndexFlag = 1u << 31;
+// a bucket holds the restart index of the user keys hashed to it
+static const uint8_t KHashIndexNoEntry = 255;
+static const uint8_t KHashIndexCollision = 254;
+static const uint32_t KHashIndexMaxRestarts = 253;
+
+inline uint32_t BlockHashIndexHash(std::string_view user_key) {
+    return murmur3::MurmurHash3_x86_32(user_key.data(), user_key.size(), 0);
+}
+
 struct BlockHandle {
  public:
     enum {KMaxEncodeLength = 20};
@@ -40,7 +73,7 @@ struct BlockHandle {
 
 struct Footer {
  public:
-    Footer() = default;
+    Footer() : partitioned_(false) {}
     
     enum {KEncodeLength = 2 * BlockHandle::KMaxEncodeLength + 8};
     void SetIndexHandle(const BlockHandle& index_block_handle) {
@@ -55,16 +88,33 @@ struct Footer {
 
     BlockHandle GetFilterHandle() const { return filter_index_handle_; }
 
+    // if true, the index handle points to the top level index of the
+    // partitions. the filter handle points to the meta index block.
+    void SetPartitioned(bool partitioned) { partitioned_ = partitioned; }
+
+    bool Partitioned() const { return partitioned_; }
+
     void EncodeTo(std::string* dst);
 
     Status DecodeFrom(std::string_view* input);
  private:
     BlockHandle index_block_handle_;
     BlockHandle filter_index_handle_;
+    bool partitioned_;
 };
 
+// "dict" is the zstd dictionary of the data blocks, if any.
+// if "stored" is not nullptr, it is set to the block contents as stored
+// in the file followed by the compress type.
 Status ReadBlock(const ReadOption& opt, RandomReadFile* file, 
-    const BlockHandle& handle, BlockContents* result);
+    const BlockHandle& handle, BlockContents* result,
+    const UncompressionDict* dict = nullptr, std::string* stored = nullptr);
+
+// uncompress the "n" bytes of block contents followed by the compress
+// type at "data[n]", as stored by ReadBlock. the result is always in a
+// new heap buffer.
+Status UncompressBlockContents(const char* data, size_t n,
+    BlockContents* result, const UncompressionDict* dict = nullptr);
 }
 
 #endif // STORAGE_XDB_DB_SSTABLE_BLOCK_FORMAT_H_
\ No newline at end of file
@@ -1,28 +1,43 @@
 #include "db/sstable/block_reader.h"
 
+#include "db/format/internal_key.h"
 #include "db/sstable/block_format.h"
 #include "util/coding.h"
 
 namespace lsmkv {
 
-inline size_t BlockReader::NumRestarts() const {
-  assert(size_ > sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
-}
-
 BlockReader::BlockReader(const BlockContents& contents)
     : data_(contents.data.data()),
       size_(contents.data.size()),
+      num_restarts_(0),
+      hash_buckets_(nullptr),
+      num_buckets_(0),
       owned_(contents.heap_allocated_) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;
-  } else {
-    size_t restarts_max = (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
-    if (restarts_max < NumRestarts()) {
+    return;
+  }
+  size_t limit = size_ - sizeof(uint32_t);
+  num_restarts_ = DecodeFixed32(data_ + limit);
+  if (num_restarts_ & KBlockHashIndexFlag) {
+    num_restarts_ &= ~KBlockHashIndexFlag;
+    if (limit < sizeof(uint32_t)) {
+      size_ = 0;
+      return;
+    }
+    limit -= sizeof(uint32_t);
+    num_buckets_ = DecodeFixed32(data_ + limit);
+    if (limit < num_buckets_ || num_buckets_ == 0) {
       size_ = 0;
-    } else {
-      restarts_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+      return;
     }
+    limit -= num_buckets_;
+    hash_buckets_ = reinterpret_cast<const uint8_t*>(data_ + limit);
+  }
+  if (limit / sizeof(uint32_t) < num_restarts_) {
+    size_ = 0;
+  } else {
+    restarts_offset_ = limit - num_restarts_ * sizeof(uint32_t);
   }
 }
 BlockReader::~BlockReader() {
@@ -147,6 +162,13 @@ class BlockReader::Iter : public Iterator {
   }
   Status status() override { return status_; }
 
+  // seek to the first key >= "key" from the restart "restart_index".
+  void SeekFromRestart(uint32_t restart_index, std::string_view key) {
+    SeekToRestart(restart_index);
+    while (SeekNextKey() && cmp_->Compare(key_, key) < 0) {
+    }
+  }
+
  private:
   uint32_t NextEntryOffset() const {
     return value_.data() + value_.size() - data_;
@@ -220,11 +242,30 @@ Iterator* BlockReader::NewIterator(const Comparator* cmp) {
   if (size_ < sizeof(uint32_t)) {
     return NewErrorIterator(Status::Corruption("bad block record"));
   }
-  int num_restarts = NumRestarts();
-  if (num_restarts == 0) {
+  if (num_restarts_ == 0) {
     return NewEmptyIterator();
   }
-  return new Iter(cmp, data_, restarts_offset_, num_restarts);
+  return new Iter(cmp, data_, restarts_offset_, num_restarts_);
+}
+
+bool BlockReader::SeekForGet(Iterator* iter, std::string_view key) const {
+  if (hash_buckets_ == nullptr || size_ == 0 || num_restarts_ == 0) {
+    iter->Seek(key);
+    return true;
+  }
+  uint32_t hash = BlockHashIndexHash(ExtractUserKey(key));
+  uint8_t restart_index = hash_buckets_[hash % num_buckets_];
+  if (restart_index == KHashIndexNoEntry) {
+    return false;
+  }
+  if (restart_index == KHashIndexCollision || restart_index >= num_restarts_) {
+    iter->Seek(key);
+    return true;
+  }
+  // all the versions of the user key are in this restart,
+  // and all keys before it are less than "key".
+  static_cast<Iter*>(iter)->SeekFromRestart(restart_index, key);
+  return true;
 }
 
 }  // namespace lsmkv
\ No newline at end of file
@@ -18,13 +18,21 @@ class BlockReader {
     BlockReader& operator=(const BlockReader&) = delete;
 
     Iterator* NewIterator(const Comparator* cmp);
+
+    // seek "iter" returned by NewIterator to the first entry >= "key" for a
+    // Get, using the hash index of the block if it has one.
+    // return false if the user key of "key" is surely not in the block.
+    bool SeekForGet(Iterator* iter, std::string_view key) const;
  private:
     class Iter;
 
-    size_t NumRestarts() const;
     const char* data_;
     size_t size_;
     uint32_t restarts_offset_;
+    uint32_t num_restarts_;
+    // the buckets of hash index, nullptr if the block has no hash index
+    const uint8_t* hash_buckets_;
+    uint32_t num_buckets_;
     bool owned_;
 };
 
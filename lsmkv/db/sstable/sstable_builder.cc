@@ -1,7 +1,10 @@
 #include "include/sstable_builder.h"
 
 #include <cassert>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <thread>
 
 #include "crc32c/crc32c.h"
 #include "db/filter/filter_block.h"
@@ -9,11 +12,13 @@
 #include "db/sstable/block_format.h"
 #include "db/version/version_edit.h"
 #include "include/comparator.h"
+#include "include/filter_policy.h"
 #include "include/iterator.h"
 #include "include/option.h"
-#include "snappy.h"
 #include "util/coding.h"
+#include "util/compression.h"
 #include "util/filename.h"
+#include "util/mutex.h"
 
 namespace lsmkv {
 
@@ -30,7 +35,8 @@ Status BuildSSTable(const std::string name, const Option& option,
     if (!s.ok()) {
       return s;
     }
-    SSTableBuilder* builder = new SSTableBuilder(option, file);
+    // the memtable is always flushed to level 0.
+    SSTableBuilder* builder = new SSTableBuilder(option, file, 0);
     meta->smallest.DecodeFrom(iter->Key());
     std::string_view key;
     for (; iter->Valid(); iter->Next()) {
@@ -42,6 +48,9 @@ Status BuildSSTable(const std::string name, const Option& option,
     s = builder->Finish();
     if (s.ok()) {
       meta->file_size = builder->FileSize();
+      meta->num_entries = builder->NumEntries();
+      meta->num_deletions = builder->NumDeletions();
+      meta->marked_for_compaction = builder->NeedCompaction();
     }
     delete builder;
 
@@ -62,21 +71,109 @@ Status BuildSSTable(const std::string name, const Option& option,
   }
   return s;
 }
+// the option with the filter policy, compress type and block size of
+// "level".
+static Option LevelOption(const Option& option, int level, bool bottommost) {
+  Option ret = option;
+  ret.filter_policy = LevelFilterPolicy(option, level, bottommost);
+  const size_t n = static_cast<size_t>(level);
+  if (level >= 0 && n < option.level_compress_type.size()) {
+    ret.compress_type = option.level_compress_type[n];
+  }
+  if (level >= 0 && n < option.level_block_size.size()) {
+    ret.block_size = option.level_block_size[n];
+  }
+  return ret;
+}
+
+// compress "raw" by the compress type of "option", "*contents" is set to
+// the data to write and the type it is stored with is returned. the
+// block is stored uncompressed if the type is not supported by this
+// build or the compression saves less than 12.5%.
+static CompressType CompressBlockContents(const Option& option,
+                                          const CompressionDict* dict,
+                                          std::string_view raw,
+                                          std::string* compress,
+                                          std::string_view* contents) {
+  CompressType type = option.compress_type;
+  if (type != KUnCompress &&
+      CompressBlock(type, option.zstd_compression_level, raw, compress,
+                    dict) &&
+      compress->size() < raw.size() - raw.size() / 8) {
+    *contents = *compress;
+    return type;
+  }
+  *contents = raw;
+  return KUnCompress;
+}
+
+// 1 byte compress type | 4 bytes masked crc
+static void EncodeBlockTail(std::string_view contents, CompressType type,
+                            char* tail) {
+  tail[0] = static_cast<char>(type);
+  uint32_t crc = crc32c::Crc32c(contents.data(), contents.size());
+  EncodeFixed32(tail + 1, CrcMask(crc));
+}
+
+// a data block in the parallel pipeline, see "Option::parallel_threads".
+struct SSTableBuilder::ParallelBlock {
+  std::string raw;
+  std::string compress;
+  // set by the compress thread
+  std::string_view contents;
+  CompressType type;
+  char tail[KBlockTailSize];
+  bool done = false;
+  // the keys of the block, added to the filter when it is written
+  std::string keys;
+  std::vector<size_t> key_starts;
+  // the index key of the block, known when the next block starts
+  std::string index_key;
+  bool has_index_key = false;
+};
+
 struct SSTableBuilder::Rep {
-  Rep(const Option& option, WritableFile* file)
+  Rep(const Option& option, WritableFile* file, int level, bool bottommost)
       : closed_(false),
-        data_block_option_(option),
+        data_block_option_(LevelOption(option, level, bottommost)),
         index_block_option_(option),
         file_(file),
-        data_block_builder_(&data_block_option_),
+        data_block_builder_(&data_block_option_,
+                            option.data_block_hash_index),
         index_block_builder_(&index_block_option_),
         filter_block_builder_(
-            option.filter_policy == nullptr
+            data_block_option_.filter_policy == nullptr ||
+                    option.index_partition_size > 0 || option.full_filter
                 ? nullptr
-                : new FilterBlockBuilder(option.filter_policy)),
+                : new FilterBlockBuilder(data_block_option_.filter_policy)),
+        partitioned_(option.index_partition_size > 0),
+        full_filter_(option.full_filter && !partitioned_),
+        top_index_builder_(&index_block_option_),
         num_entries_(0),
         offset_(0),
-        data_block_over_(false) {
+        data_block_over_(false),
+        internal_key_(dynamic_cast<const InternalKeyComparator*>(
+                          option.comparator) != nullptr),
+        num_deletions_(0),
+        deletion_window_(option.deletion_compaction_window > 0
+                             ? option.deletion_compaction_window
+                             : 0,
+                         false),
+        deletion_window_index_(0),
+        deletion_window_count_(0),
+        need_compaction_(false),
+        dict_compression_(bottommost && option.zstd_max_dict_bytes > 0 &&
+                          data_block_option_.compress_type == KZSTDCompress &&
+                          CompressionSupported(KZSTDCompress)),
+        buffering_(dict_compression_),
+        num_buffered_(0),
+        parallel_(option.parallel_threads > 1),
+        work_cv_(&mu_),
+        done_cv_(&mu_),
+        shutting_down_(false),
+        pending_raw_bytes_(0),
+        data_raw_bytes_(0),
+        data_bytes_(0) {
     // index_block is used for random access
     // using prefix compress will slow down the effiency.
     index_block_option_.block_restart_interval = 1;
@@ -89,6 +186,15 @@ struct SSTableBuilder::Rep {
   BlockBuilder data_block_builder_;
   BlockBuilder index_block_builder_;
   FilterBlockBuilder* filter_block_builder_;
+  // the index and filter are partitioned, the partitions are found
+  // by the top level index.
+  const bool partitioned_;
+  // one filter for all the keys of the sstable
+  const bool full_filter_;
+  BlockBuilder top_index_builder_;
+  // the keys of the current filter partition, or the full filter
+  std::string filter_keys_;
+  std::vector<size_t> filter_key_starts_;
   std::string last_key_;
   uint64_t num_entries_;
   uint64_t offset_;
@@ -97,16 +203,73 @@ struct SSTableBuilder::Rep {
   bool data_block_over_;
   BlockHandle data_block_handle_;
   std::string compress_output_;
+
+  // deletion records statistics.
+  // only counted when the keys are internal keys.
+  const bool internal_key_;
+  uint64_t num_deletions_;
+  // whether the last "deletion_compaction_window" records are
+  // deletion records, used as a ring buffer.
+  std::vector<bool> deletion_window_;
+  size_t deletion_window_index_;
+  int deletion_window_count_;
+  bool need_compaction_;
+
+  // the records are buffered until enough data is seen to train the
+  // zstd dictionary, see "Option::zstd_max_dict_bytes".
+  const bool dict_compression_;
+  bool buffering_;
+  // length prefixed key | length prefixed value
+  std::string buffered_records_;
+  uint64_t num_buffered_;
+  std::string compression_dict_raw_;
+  std::unique_ptr<CompressionDict> compression_dict_;
+
+  // the data blocks are compressed by "compress_threads_" and written
+  // in order by the thread building the sstable.
+  const bool parallel_;
+  Mutex mu_;
+  // signaled when a block is queued or the threads should stop
+  CondVar work_cv_;
+  // signaled when a block is compressed
+  CondVar done_cv_;
+  std::deque<ParallelBlock*> compress_queue_ GUARDED_BY(mu_);
+  bool shutting_down_ GUARDED_BY(mu_);
+  std::vector<std::thread> compress_threads_;
+  // the blocks not written yet, in order
+  std::deque<std::unique_ptr<ParallelBlock>> parallel_blocks_;
+  // the keys of the current data block
+  std::string block_keys_;
+  std::vector<size_t> block_key_starts_;
+  // estimate the size of the blocks not written yet
+  uint64_t pending_raw_bytes_;
+  uint64_t data_raw_bytes_;
+  uint64_t data_bytes_;
 };
 Status SSTableBuilder::status() const { return rep_->status_; }
-SSTableBuilder::SSTableBuilder(const Option& option, WritableFile* file)
-    : rep_(new Rep(option, file)) {
+SSTableBuilder::SSTableBuilder(const Option& option, WritableFile* file,
+                               int level, bool bottommost)
+    : rep_(new Rep(option, file, level, bottommost)) {
   if (rep_->filter_block_builder_ != nullptr) {
     rep_->filter_block_builder_->StartBlock(0);
   }
+  if (rep_->parallel_) {
+    for (int i = 0; i < option.parallel_threads; i++) {
+      rep_->compress_threads_.emplace_back(&CompressThreadMain, rep_);
+    }
+  }
 }
 
 SSTableBuilder::~SSTableBuilder() {
+  if (!rep_->compress_threads_.empty()) {
+    rep_->mu_.Lock();
+    rep_->shutting_down_ = true;
+    rep_->work_cv_.SignalAll();
+    rep_->mu_.Unlock();
+    for (std::thread& thread : rep_->compress_threads_) {
+      thread.join();
+    }
+  }
   delete rep_->filter_block_builder_;
   delete rep_;
 }
@@ -114,6 +277,19 @@ SSTableBuilder::~SSTableBuilder() {
 void SSTableBuilder::Add(std::string_view key, std::string_view value) {
   assert(!rep_->closed_);
   if (!ok()) return;
+  if (rep_->buffering_) {
+    PutLengthPrefixedSlice(&rep_->buffered_records_, key);
+    PutLengthPrefixedSlice(&rep_->buffered_records_, value);
+    rep_->num_buffered_++;
+    size_t train_bytes = rep_->data_block_option_.zstd_max_train_bytes;
+    if (train_bytes == 0) {
+      train_bytes = 100 * rep_->data_block_option_.zstd_max_dict_bytes;
+    }
+    if (rep_->buffered_records_.size() >= train_bytes) {
+      EnterUnbuffered();
+    }
+    return;
+  }
   if (rep_->num_entries_ != 0) {
     assert(rep_->data_block_option_.comparator->Compare(
                key, std::string_view(rep_->last_key_)) > 0);
@@ -128,14 +304,31 @@ void SSTableBuilder::Add(std::string_view key, std::string_view value) {
     // in order to decrease the key's length
     rep_->data_block_option_.comparator->FindShortestMiddle(&rep_->last_key_,
                                                             key);
-    std::string block_handele;
-    rep_->data_block_handle_.EncodeTo(&block_handele);
-    rep_->index_block_builder_.Add(rep_->last_key_,
-                                   std::string_view(block_handele));
     rep_->data_block_over_ = false;
+    if (rep_->parallel_) {
+      ParallelBlock* block = rep_->parallel_blocks_.back().get();
+      block->index_key = rep_->last_key_;
+      block->has_index_key = true;
+      WriteParallelBlocks(false);
+    } else {
+      std::string block_handele;
+      rep_->data_block_handle_.EncodeTo(&block_handele);
+      rep_->index_block_builder_.Add(rep_->last_key_,
+                                     std::string_view(block_handele));
+      if (rep_->partitioned_) {
+        CutPartition(false, rep_->last_key_);
+      }
+    }
   }
-  if (rep_->filter_block_builder_ != nullptr) {
-    rep_->filter_block_builder_->AddKey(key);
+  if (!rep_->parallel_) {
+    AddFilterKey(key);
+  } else if (rep_->data_block_option_.filter_policy != nullptr) {
+    // added to the filter when the block is written
+    rep_->block_key_starts_.push_back(rep_->block_keys_.size());
+    rep_->block_keys_.append(key.data(), key.size());
+  }
+  if (rep_->internal_key_) {
+    UpdateDeletionStats(key);
   }
   rep_->data_block_builder_.Add(key, value);
   rep_->last_key_ = key;
@@ -147,9 +340,144 @@ void SSTableBuilder::Add(std::string_view key, std::string_view value) {
   }
 }
 
+void SSTableBuilder::EnterUnbuffered() {
+  Rep* r = rep_;
+  r->buffering_ = false;
+  std::string records;
+  records.swap(r->buffered_records_);
+  r->num_buffered_ = 0;
+
+  // the samples are the data blocks the records will be built into.
+  std::vector<std::string> samples;
+  BlockBuilder sample_builder(&r->data_block_option_);
+  std::string_view input = records;
+  std::string_view key, value;
+  while (GetLengthPrefixedSlice(&input, &key) &&
+         GetLengthPrefixedSlice(&input, &value)) {
+    sample_builder.Add(key, value);
+    if (sample_builder.ByteSize() >= r->data_block_option_.block_size) {
+      samples.emplace_back(sample_builder.Finish());
+      sample_builder.Reset();
+    }
+  }
+  if (!sample_builder.Empty()) {
+    samples.emplace_back(sample_builder.Finish());
+  }
+  // too few samples fails the training, the blocks are compressed
+  // without dictionary then.
+  if (TrainCompressionDict(samples, r->data_block_option_.zstd_max_dict_bytes,
+                           &r->compression_dict_raw_)) {
+    r->compression_dict_.reset(new CompressionDict(
+        r->compression_dict_raw_,
+        r->data_block_option_.zstd_compression_level));
+  }
+
+  input = records;
+  while (GetLengthPrefixedSlice(&input, &key) &&
+         GetLengthPrefixedSlice(&input, &value)) {
+    Add(key, value);
+  }
+}
+
+void SSTableBuilder::UpdateDeletionStats(std::string_view key) {
+  ParsedInternalKey ikey;
+  const bool deletion =
+      ParseInternalKey(key, &ikey) && ikey.type_ == KTypeDeletion;
+  if (deletion) {
+    rep_->num_deletions_++;
+  }
+  std::vector<bool>& window = rep_->deletion_window_;
+  if (window.empty() || rep_->need_compaction_) {
+    return;
+  }
+  // replace the oldest record in window
+  if (window[rep_->deletion_window_index_]) {
+    rep_->deletion_window_count_--;
+  }
+  window[rep_->deletion_window_index_] = deletion;
+  if (deletion) {
+    rep_->deletion_window_count_++;
+  }
+  rep_->deletion_window_index_ =
+      (rep_->deletion_window_index_ + 1) % window.size();
+  if (rep_->data_block_option_.deletion_compaction_trigger > 0 &&
+      rep_->deletion_window_count_ >=
+          rep_->data_block_option_.deletion_compaction_trigger) {
+    rep_->need_compaction_ = true;
+  }
+}
+
+void SSTableBuilder::AddFilterKey(std::string_view key) {
+  if (rep_->filter_block_builder_ != nullptr) {
+    rep_->filter_block_builder_->AddKey(key);
+  } else if ((rep_->partitioned_ || rep_->full_filter_) &&
+             rep_->data_block_option_.filter_policy != nullptr) {
+    rep_->filter_key_starts_.push_back(rep_->filter_keys_.size());
+    rep_->filter_keys_.append(key.data(), key.size());
+  }
+}
+
+void SSTableBuilder::CutPartition(bool force, std::string_view last_key) {
+  Rep* r = rep_;
+  if (!ok() || r->index_block_builder_.Empty() ||
+      (!force && r->index_block_builder_.ByteSize() <
+                     r->data_block_option_.index_partition_size)) {
+    return;
+  }
+  // value : the handle of index partition | the handle of filter partition
+  std::string handles;
+  BlockHandle index_handle;
+  WriteBlock(&r->index_block_builder_, &index_handle);
+  index_handle.EncodeTo(&handles);
+
+  if (ok() && r->data_block_option_.filter_policy != nullptr) {
+    BlockHandle filter_handle;
+    WriteFilterOfKeys(&filter_handle);
+    filter_handle.EncodeTo(&handles);
+  }
+  if (ok()) {
+    // the key is not less than the keys of the partition
+    r->top_index_builder_.Add(last_key, handles);
+  }
+}
+
+void SSTableBuilder::WriteFilterOfKeys(BlockHandle* handle) {
+  Rep* r = rep_;
+  const size_t key_num = r->filter_key_starts_.size();
+  std::vector<std::string_view> keys(key_num);
+  r->filter_key_starts_.push_back(r->filter_keys_.size());
+  for (size_t i = 0; i < key_num; i++) {
+    const size_t start = r->filter_key_starts_[i];
+    keys[i] = std::string_view(r->filter_keys_.data() + start,
+                               r->filter_key_starts_[i + 1] - start);
+  }
+  std::string filter;
+  r->data_block_option_.filter_policy->CreatFilter(
+      keys.data(), static_cast<int>(key_num), &filter);
+  WriteRawBlock(filter, KUnCompress, handle);
+  r->filter_keys_.clear();
+  r->filter_key_starts_.clear();
+}
+
 void SSTableBuilder::Flush() {
   assert(!rep_->closed_);
   if (rep_->data_block_builder_.Empty()) return;
+  if (rep_->parallel_) {
+    ParallelBlock* block = new ParallelBlock;
+    block->raw.assign(rep_->data_block_builder_.Finish());
+    rep_->data_block_builder_.Reset();
+    block->keys.swap(rep_->block_keys_);
+    block->key_starts.swap(rep_->block_key_starts_);
+    rep_->pending_raw_bytes_ += block->raw.size();
+    rep_->parallel_blocks_.emplace_back(block);
+    rep_->mu_.Lock();
+    rep_->compress_queue_.push_back(block);
+    rep_->work_cv_.Signal();
+    rep_->mu_.Unlock();
+    // the index key is set by the next Add or Finish
+    rep_->data_block_over_ = true;
+    return;
+  }
   WriteBlock(&rep_->data_block_builder_, &rep_->data_block_handle_);
   if (ok()) {
     rep_->data_block_over_ = true;
@@ -160,25 +488,89 @@ void SSTableBuilder::Flush() {
   }
 }
 
-// check the snappy compress is used.
-// generate the std::string_view contents
+void SSTableBuilder::CompressThreadMain(void* arg) {
+  Rep* r = reinterpret_cast<Rep*>(arg);
+  r->mu_.Lock();
+  while (true) {
+    while (r->compress_queue_.empty() && !r->shutting_down_) {
+      r->work_cv_.Wait();
+    }
+    if (r->compress_queue_.empty()) {
+      break;
+    }
+    ParallelBlock* block = r->compress_queue_.front();
+    r->compress_queue_.pop_front();
+    r->mu_.Unlock();
+    block->type = CompressBlockContents(r->data_block_option_,
+                                       r->compression_dict_.get(), block->raw,
+                                       &block->compress, &block->contents);
+    EncodeBlockTail(block->contents, block->type, block->tail);
+    r->mu_.Lock();
+    block->done = true;
+    r->done_cv_.SignalAll();
+  }
+  r->mu_.Unlock();
+}
+
+void SSTableBuilder::WriteParallelBlocks(bool wait) {
+  Rep* r = rep_;
+  // bound the memory of the blocks not written.
+  const size_t max_pending = 2 * r->compress_threads_.size();
+  while (ok() && !r->parallel_blocks_.empty()) {
+    ParallelBlock* block = r->parallel_blocks_.front().get();
+    if (!block->has_index_key) {
+      break;
+    }
+    r->mu_.Lock();
+    while (!block->done &&
+           (wait || r->parallel_blocks_.size() > max_pending)) {
+      r->done_cv_.Wait();
+    }
+    const bool done = block->done;
+    r->mu_.Unlock();
+    if (!done) {
+      break;
+    }
+
+    BlockHandle handle;
+    AppendBlock(block->contents, block->tail, &handle);
+    if (ok()) {
+      r->status_ = r->file_->Flush();
+    }
+    r->pending_raw_bytes_ -= block->raw.size();
+    r->data_raw_bytes_ += block->raw.size();
+    r->data_bytes_ += block->contents.size();
+    const size_t key_num = block->key_starts.size();
+    block->key_starts.push_back(block->keys.size());
+    for (size_t i = 0; i < key_num; i++) {
+      const size_t start = block->key_starts[i];
+      AddFilterKey(std::string_view(block->keys.data() + start,
+                                    block->key_starts[i + 1] - start));
+    }
+    if (r->filter_block_builder_ != nullptr) {
+      r->filter_block_builder_->StartBlock(r->offset_);
+    }
+    std::string block_handele;
+    handle.EncodeTo(&block_handele);
+    r->index_block_builder_.Add(block->index_key, block_handele);
+    if (r->partitioned_) {
+      CutPartition(false, block->index_key);
+    }
+    r->parallel_blocks_.pop_front();
+  }
+}
+
 void SSTableBuilder::WriteBlock(BlockBuilder* builder, BlockHandle* handle) {
   assert(ok());
   std::string_view contents;
   std::string_view raw = builder->Finish();
-  CompressType type = rep_->data_block_option_.compress_type;
-
-  if (type == KUnCompress) {
-    contents = raw;
-  } else if (type == KSnappyCompress) {
-    std::string* compress = &rep_->compress_output_;
-    if (snappy::Compress(raw.data(), raw.size(), compress)) {
-      contents = *compress;
-    } else {
-      contents = raw;
-      type = KUnCompress;
-    }
-  }
+  // only the data blocks share the dictionary.
+  const CompressionDict* dict = (builder == &rep_->data_block_builder_
+                                     ? rep_->compression_dict_.get()
+                                     : nullptr);
+  CompressType type =
+      CompressBlockContents(rep_->data_block_option_, dict, raw,
+                            &rep_->compress_output_, &contents);
   WriteRawBlock(contents, type, handle);
   rep_->compress_output_.clear();
   builder->Reset();
@@ -186,15 +578,17 @@ void SSTableBuilder::WriteBlock(BlockBuilder* builder, BlockHandle* handle) {
 
 void SSTableBuilder::WriteRawBlock(std::string_view contents, CompressType type,
                                    BlockHandle* handle) {
+  char tail[KBlockTailSize];
+  EncodeBlockTail(contents, type, tail);
+  AppendBlock(contents, tail, handle);
+}
+
+void SSTableBuilder::AppendBlock(std::string_view contents, const char* tail,
+                                 BlockHandle* handle) {
   handle->SetOffset(rep_->offset_);
   handle->SetSize(contents.size());
   rep_->status_ = rep_->file_->Append(contents);
   if (ok()) {
-    char tail[KBlockTailSize];
-    tail[0] = static_cast<char>(type);
-    uint32_t crc = crc32c::Crc32c(contents.data(), contents.size());
-    EncodeFixed32(tail + 1, CrcMask(crc));
-    crc = crc32c::Extend(crc, reinterpret_cast<const uint8_t*>(tail), 1);
     rep_->status_ = rep_->file_->Append(std::string_view(tail, KBlockTailSize));
     if (ok()) {
       rep_->offset_ += contents.size() + KBlockTailSize;
@@ -204,21 +598,55 @@ void SSTableBuilder::WriteRawBlock(std::string_view contents, CompressType type,
 
 Status SSTableBuilder::Finish() {
   assert(!rep_->closed_);
+  if (rep_->buffering_) {
+    EnterUnbuffered();
+  }
   Flush();
+  if (rep_->parallel_) {
+    if (rep_->data_block_over_) {
+      rep_->data_block_option_.comparator->FindShortestBigger(&rep_->last_key_);
+      ParallelBlock* block = rep_->parallel_blocks_.back().get();
+      block->index_key = rep_->last_key_;
+      block->has_index_key = true;
+      rep_->data_block_over_ = false;
+    }
+    WriteParallelBlocks(true);
+  }
   rep_->closed_ = true;
   BlockHandle filter_block_handle, index_block_handle, filter_index_handle;
+  BlockHandle dict_handle;
+  if (ok() && !rep_->compression_dict_raw_.empty()) {
+    WriteRawBlock(rep_->compression_dict_raw_, KUnCompress, &dict_handle);
+  }
   if (ok() && rep_->filter_block_builder_ != nullptr) {
     WriteRawBlock(rep_->filter_block_builder_->Finish(), KUnCompress,
                   &filter_block_handle);
+  } else if (ok() && rep_->full_filter_ &&
+             rep_->data_block_option_.filter_policy != nullptr) {
+    WriteFilterOfKeys(&filter_block_handle);
   }
   if (ok()) {
     BlockBuilder filter_index_builder(&rep_->data_block_option_);
-    if (rep_->filter_block_builder_ != nullptr) {
-      std::string key = "filter";
+    if (rep_->filter_block_builder_ != nullptr ||
+        (rep_->full_filter_ &&
+         rep_->data_block_option_.filter_policy != nullptr)) {
+      std::string key = (rep_->full_filter_ ? KFullFilterMetaPrefix : "filter");
       key.append(rep_->data_block_option_.filter_policy->Name());
       std::string val;
       filter_block_handle.EncodeTo(&val);
       filter_index_builder.Add(key, val);
+    } else if (rep_->partitioned_ &&
+               rep_->data_block_option_.filter_policy != nullptr) {
+      // the filter partitions are found by the top level index
+      std::string key = KPartitionedFilterMetaPrefix;
+      key.append(rep_->data_block_option_.filter_policy->Name());
+      filter_index_builder.Add(key, std::string_view());
+    }
+    if (!rep_->compression_dict_raw_.empty()) {
+      // keys of the meta index block are sorted, "zstddict" > "filter..."
+      std::string val;
+      dict_handle.EncodeTo(&val);
+      filter_index_builder.Add(KCompressionDictMetaKey, val);
     }
     WriteBlock(&filter_index_builder, &filter_index_handle);
   }
@@ -233,12 +661,20 @@ Status SSTableBuilder::Finish() {
                                      std::string_view(block_handele));
       rep_->data_block_over_ = false;
     }
-    WriteBlock(&rep_->index_block_builder_, &index_block_handle);
+    if (rep_->partitioned_) {
+      CutPartition(true, rep_->last_key_);
+      if (ok()) {
+        WriteBlock(&rep_->top_index_builder_, &index_block_handle);
+      }
+    } else {
+      WriteBlock(&rep_->index_block_builder_, &index_block_handle);
+    }
   }
   if (ok()) {
     Footer footer;
     footer.SetIndexHandle(index_block_handle);
-    footer.SetFilterHandle(filter_block_handle);
+    footer.SetFilterHandle(filter_index_handle);
+    footer.SetPartitioned(rep_->partitioned_);
     std::string footer_encode;
     footer.EncodeTo(&footer_encode);
     rep_->status_ = rep_->file_->Append(footer_encode);
@@ -250,8 +686,22 @@ Status SSTableBuilder::Finish() {
   return rep_->status_;
 }
 
-uint64_t SSTableBuilder::FileSize() const { return rep_->offset_; }
+uint64_t SSTableBuilder::FileSize() const {
+  // the buffered records and the blocks being compressed are about to
+  // be written, estimated by the compression ratio so far.
+  uint64_t pending = rep_->pending_raw_bytes_;
+  if (rep_->data_raw_bytes_ > 0) {
+    pending = pending * rep_->data_bytes_ / rep_->data_raw_bytes_;
+  }
+  return rep_->offset_ + rep_->buffered_records_.size() + pending;
+}
+
+uint64_t SSTableBuilder::NumEntries() const {
+  return rep_->num_entries_ + rep_->num_buffered_;
+}
+
+uint64_t SSTableBuilder::NumDeletions() const { return rep_->num_deletions_; }
 
-uint64_t SSTableBuilder::NumEntries() const { return rep_->num_entries_; }
+bool SSTableBuilder::NeedCompaction() const { return rep_->need_compaction_; }
 
 }  // namespace lsmkv
\ No newline at end of file
@@ -1,8 +1,16 @@
 #include "include/sstable_reader.h"
+
+#include <atomic>
+#include <cstring>
+#include <set>
+
 #include "db/filter/filter_block.h"
 #include "db/sstable/block_reader.h"
 #include "db/sstable/block_format.h"
+#include "util/coding.h"
+#include "util/compression.h"
 #include "util/file.h"
+#include "util/mutex.h"
 
 namespace lsmkv {
 
@@ -12,17 +20,88 @@ struct SSTableReader::Rep {
         delete filter;
         delete[] filter_data;
         delete index_block;
+        delete compression_dict;
     }
     Option option;
     Status status;
     RandomReadFile* file;
-    BlockReader* index_block;
+    BlockHandle index_handle;
+    // the size is 0 if the table has no filter
+    BlockHandle filter_handle;
+    // the policy the filter was written with
+    const FilterPolicy* filter_policy;
+    // the index block is the top level index of the index partitions,
+    // see "Option::index_partition_size".
+    bool partitioned;
+    // the top level index also points to the filter partitions
+    bool partitioned_filter;
+    // the filter of "filter_handle" is for all the keys of the table,
+    // see "Option::full_filter".
+    bool full_filter;
 
+    // kept by the table if "option.metadata_cache" is not set
+    BlockReader* index_block;
     const char* filter_data;
     FilterBlockReader* filter;
+    // the contents of the full filter
+    std::string_view filter_contents;
+    // the digested zstd dictionary of the data blocks, if any
+    UncompressionDict* compression_dict;
+
+    // distinguish the metadata of different tables in cache
+    uint64_t cache_id;
+    // the offsets of the partitions inserted into "option.metadata_cache",
+    // which are erased with the table.
+    Mutex partitions_mu;
+    std::set<uint64_t> partition_offsets GUARDED_BY(partitions_mu);
+    // "option.compressed_block_cache" if the table is opened with its
+    // db id and file number, which are the prefix of the block keys.
+    Cache* block_cache;
+    char block_key_prefix[16];
+    std::atomic<int> level;
 };
 
+// the filter and its data cached in "option.metadata_cache"
+struct CachedFilter {
+    // nullptr for a filter partition or the full filter
+    FilterBlockReader* filter;
+    std::string_view contents;
+    const char* data;
+};
+
+static uint64_t NewMetadataCacheId() {
+    static std::atomic<uint64_t> next_id(0);
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void DeleteCachedIndex(std::string_view key, void* value) {
+    delete reinterpret_cast<BlockReader*>(value);
+}
+
+static void DeleteCachedFilter(std::string_view key, void* value) {
+    CachedFilter* cached = reinterpret_cast<CachedFilter*>(value);
+    delete cached->filter;
+    delete[] cached->data;
+    delete cached;
+}
+
 SSTableReader::~SSTableReader() {
+    Cache* cache = rep_->option.metadata_cache;
+    if (cache != nullptr) {
+        // the metadata of a closed table is never used again.
+        char buf[16];
+        EncodeMetadataKey(rep_->index_handle, buf);
+        cache->Erase(std::string_view(buf, sizeof(buf)));
+        if (rep_->filter_handle.GetSize() > 0) {
+            EncodeMetadataKey(rep_->filter_handle, buf);
+            cache->Erase(std::string_view(buf, sizeof(buf)));
+        }
+        MutexLock l(&rep_->partitions_mu);
+        for (uint64_t offset : rep_->partition_offsets) {
+            EncodeFixed64(buf + 8, offset);
+            cache->Erase(std::string_view(buf, sizeof(buf)));
+        }
+    }
     delete rep_;
 }
 
@@ -42,31 +121,56 @@ Status SSTableReader::Open(const Option& option, RandomReadFile* file,
     Footer footer;
     s = footer.DecodeFrom(&footer_result);
     if(!s.ok()) return s;
-    // read index block from file
-    ReadOption read_option;
-    if (option.check_crc) {
-        read_option.check_crc = true;
-    }
-    BlockContents index_block_contents;
-    s = ReadBlock(read_option, file, footer.GetIndexHandle(), &index_block_contents);
-    if(!s.ok()) return s;
 
-    BlockReader* index_block = new BlockReader(index_block_contents);
     Rep* rep = new SSTableReader::Rep;
     rep->option = option;
     rep->file = file;
-    rep->index_block = index_block;
+    rep->index_handle = footer.GetIndexHandle();
+    rep->filter_handle.SetSize(0);
+    rep->filter_policy = nullptr;
+    rep->partitioned = footer.Partitioned();
+    rep->partitioned_filter = false;
+    rep->full_filter = false;
+    rep->index_block = nullptr;
     rep->filter_data = nullptr;
     rep->filter = nullptr;
+    rep->compression_dict = nullptr;
+    rep->cache_id = NewMetadataCacheId();
+    rep->block_cache = nullptr;
+    rep->level.store(-1, std::memory_order_relaxed);
+    if (option.metadata_cache == nullptr) {
+        // read index block from file
+        ReadOption read_option;
+        if (option.check_crc) {
+            read_option.check_crc = true;
+        }
+        BlockContents index_block_contents;
+        s = ReadBlock(read_option, file, rep->index_handle, &index_block_contents);
+        if(!s.ok()) {
+            delete rep;
+            return s;
+        }
+        rep->index_block = new BlockReader(index_block_contents);
+    }
     *table = new SSTableReader(rep);
-    (*table)->ReadFilterIndex(footer);
+    (*table)->ReadMetaIndex(footer);
     return s;
 }
 
-void SSTableReader::ReadFilterIndex(const Footer& footer) {
-    if (rep_->option.filter_policy == nullptr) {
-        return;
+Status SSTableReader::Open(const Option& option, RandomReadFile* file,
+        uint64_t file_size, uint64_t db_id, uint64_t file_number,
+        SSTableReader** table) {
+    Status s = Open(option, file, file_size, table);
+    if (s.ok()) {
+        Rep* rep = (*table)->rep_;
+        rep->block_cache = option.compressed_block_cache;
+        EncodeFixed64(rep->block_key_prefix, db_id);
+        EncodeFixed64(rep->block_key_prefix + 8, file_number);
     }
+    return s;
+}
+
+void SSTableReader::ReadMetaIndex(const Footer& footer) {
     ReadOption read_option;
     if (rep_->option.check_crc) {
         read_option.check_crc = true;
@@ -79,37 +183,333 @@ void SSTableReader::ReadFilterIndex(const Footer& footer) {
 
     BlockReader* filter_index_block = new BlockReader(filter_index_contents);
     Iterator* iter = filter_index_block->NewIterator(DefaultComparator());
-    std::string key = "filter";
-    key.append(rep_->option.filter_policy->Name());
-    iter->Seek(key);
+    ReadCompressionDict(iter);
 
-    if (iter->Valid() && iter->Key() == std::string_view(key)) {
-        ReadFilter(iter->Value());
+    // the sstable may be written with any of the policies of levels.
+    std::vector<const FilterPolicy*> policies;
+    for (const FilterPolicy* policy : rep_->option.level_filter_policy) {
+        if (policy != nullptr) {
+            policies.push_back(policy);
+        }
+    }
+    if (rep_->option.filter_policy != nullptr) {
+        policies.push_back(rep_->option.filter_policy);
+    }
+    if (policies.empty()) {
+        delete iter;
+        delete filter_index_block;
+        return;
+    }
+    std::vector<const char*> prefixes;
+    if (rep_->partitioned) {
+        prefixes = {KPartitionedFilterMetaPrefix};
+    } else {
+        prefixes = {"filter", KFullFilterMetaPrefix};
+    }
+    std::string key;
+    for (const FilterPolicy* policy : policies) {
+        for (const char* prefix : prefixes) {
+            key = prefix;
+            key.append(policy->Name());
+            iter->Seek(key);
+            if (iter->Valid() && iter->Key() == std::string_view(key)) {
+                rep_->filter_policy = policy;
+                rep_->full_filter = (prefix == KFullFilterMetaPrefix);
+                break;
+            }
+        }
+        if (rep_->filter_policy != nullptr) {
+            break;
+        }
+    }
+
+    if (iter->Valid() && iter->Key() == std::string_view(key) &&
+            rep_->partitioned) {
+        // the handles of filter partitions are in the top level index
+        rep_->partitioned_filter = true;
+    } else if (iter->Valid() && iter->Key() == std::string_view(key)) {
+        std::string_view handle_contents = iter->Value();
+        BlockHandle filter_handle;
+        if (filter_handle.DecodeFrom(&handle_contents).ok()) {
+            rep_->filter_handle = filter_handle;
+        }
     }
 
     delete filter_index_block;
     delete iter;
+
+    if (rep_->filter_handle.GetSize() > 0 &&
+            rep_->option.metadata_cache == nullptr) {
+        if (!ReadFilter(&rep_->filter, &rep_->filter_contents,
+                        &rep_->filter_data).ok()) {
+            rep_->filter = nullptr;
+            rep_->filter_contents = std::string_view();
+        }
+    }
 }
 
-void SSTableReader::ReadFilter(std::string_view handle_contents) {
-    std::string_view s = handle_contents;
-    BlockHandle filter_handle;
-    if(!filter_handle.DecodeFrom(&s).ok()) {
+void SSTableReader::ReadCompressionDict(Iterator* meta_iter) {
+    meta_iter->Seek(KCompressionDictMetaKey);
+    if (!meta_iter->Valid() ||
+            meta_iter->Key() != std::string_view(KCompressionDictMetaKey)) {
+        return;
+    }
+    std::string_view handle_contents = meta_iter->Value();
+    BlockHandle dict_handle;
+    if (!dict_handle.DecodeFrom(&handle_contents).ok()) {
+        return;
+    }
+    ReadOption read_option;
+    read_option.check_crc = rep_->option.check_crc;
+    BlockContents dict_contents;
+    if (!ReadBlock(read_option, rep_->file, dict_handle, &dict_contents).ok()) {
         return;
     }
+    // digested once, the raw dictionary is not needed after.
+    rep_->compression_dict = new UncompressionDict(dict_contents.data);
+    if (dict_contents.heap_allocated_) {
+        delete[] dict_contents.data.data();
+    }
+}
+
+Status SSTableReader::ReadFilter(FilterBlockReader** filter,
+        std::string_view* contents, const char** data) const {
     ReadOption read_option;
     if (rep_->option.check_crc) {
         read_option.check_crc = true;
     }
     BlockContents filter_contents;
-    if (!ReadBlock(read_option,rep_->file, filter_handle,
-            &filter_contents).ok()) {
+    Status s = ReadBlock(read_option, rep_->file, rep_->filter_handle,
+            &filter_contents);
+    if (!s.ok()) {
+        return s;
+    }
+    *data = (filter_contents.heap_allocated_ ? filter_contents.data.data()
+                                             : nullptr);
+    *contents = filter_contents.data;
+    *filter = (rep_->full_filter ? nullptr
+               : new FilterBlockReader(rep_->filter_policy, filter_contents.data));
+    return s;
+}
+
+void SSTableReader::EncodeMetadataKey(const BlockHandle& handle, char* buf) const {
+    EncodeFixed64(buf, rep_->cache_id);
+    EncodeFixed64(buf + 8, handle.GetOffset());
+}
+
+void SSTableReader::SetLevel(int level) {
+    rep_->level.store(level, std::memory_order_relaxed);
+}
+
+// the metadata of the upper levels is read by most of the Gets
+static Cache::Priority MetadataPriority(const Option& option, int level) {
+    return (level >= 0 && level <= option.metadata_high_priority_level)
+               ? Cache::KHighPriority
+               : Cache::KLowPriority;
+}
+
+Status SSTableReader::GetIndexBlock(BlockReader** block,
+        Cache::Handle** handle) const {
+    if (rep_->option.metadata_cache == nullptr) {
+        *handle = nullptr;
+        *block = rep_->index_block;
+        return Status::OK();
+    }
+    return ReadIndexBlock(rep_->index_handle, block, handle);
+}
+
+void SSTableReader::AddPartition(const BlockHandle& handle) const {
+    if (handle.GetOffset() == rep_->index_handle.GetOffset() ||
+            handle.GetOffset() == rep_->filter_handle.GetOffset()) {
+        // erased by the destructor anyway
         return;
     }
-    if (!filter_contents.heap_allocated_) {
-        rep_->filter_data = filter_contents.data.data();
+    MutexLock l(&rep_->partitions_mu);
+    rep_->partition_offsets.insert(handle.GetOffset());
+}
+
+Status SSTableReader::ReadIndexBlock(const BlockHandle& block_handle,
+        BlockReader** block, Cache::Handle** handle) const {
+    *handle = nullptr;
+    Cache* cache = rep_->option.metadata_cache;
+    char buf[16];
+    EncodeMetadataKey(block_handle, buf);
+    std::string_view key(buf, sizeof(buf));
+    if (cache != nullptr) {
+        *handle = cache->Lookup(key);
+        if (*handle != nullptr) {
+            *block = reinterpret_cast<BlockReader*>(cache->Value(*handle));
+            return Status::OK();
+        }
+    }
+    ReadOption read_option;
+    read_option.check_crc = rep_->option.check_crc;
+    BlockContents contents;
+    Status s = ReadBlock(read_option, rep_->file, block_handle, &contents);
+    if (!s.ok()) {
+        return s;
+    }
+    *block = new BlockReader(contents);
+    if (cache != nullptr) {
+        *handle = cache->Insert(key, *block, contents.data.size(),
+                &DeleteCachedIndex,
+                MetadataPriority(rep_->option,
+                        rep_->level.load(std::memory_order_relaxed)));
+        AddPartition(block_handle);
+    }
+    return Status::OK();
+}
+
+FilterBlockReader* SSTableReader::GetFilter(Cache::Handle** handle) const {
+    *handle = nullptr;
+    Cache* cache = rep_->option.metadata_cache;
+    if (cache == nullptr) {
+        return rep_->filter;
+    }
+    if (rep_->filter_handle.GetSize() == 0 || rep_->full_filter) {
+        return nullptr;
+    }
+    char buf[16];
+    EncodeMetadataKey(rep_->filter_handle, buf);
+    std::string_view key(buf, sizeof(buf));
+    *handle = cache->Lookup(key);
+    if (*handle == nullptr) {
+        CachedFilter* cached = new CachedFilter;
+        if (!ReadFilter(&cached->filter, &cached->contents, &cached->data).ok()) {
+            // the Get goes on without filter.
+            delete cached;
+            return nullptr;
+        }
+        *handle = cache->Insert(key, cached, rep_->filter_handle.GetSize(),
+                &DeleteCachedFilter,
+                MetadataPriority(rep_->option,
+                        rep_->level.load(std::memory_order_relaxed)));
     }
-    rep_->filter = new FilterBlockReader(rep_->option.filter_policy, filter_contents.data);
+    return reinterpret_cast<CachedFilter*>(cache->Value(*handle))->filter;
+}
+
+bool SSTableReader::RawFilterMayMatch(const BlockHandle& filter_handle,
+        std::string_view key) const {
+    Cache* cache = rep_->option.metadata_cache;
+    char buf[16];
+    EncodeMetadataKey(filter_handle, buf);
+    std::string_view cache_key(buf, sizeof(buf));
+    Cache::Handle* handle = nullptr;
+    CachedFilter* cached = nullptr;
+    if (cache != nullptr) {
+        handle = cache->Lookup(cache_key);
+    }
+    if (handle != nullptr) {
+        cached = reinterpret_cast<CachedFilter*>(cache->Value(handle));
+    } else {
+        ReadOption read_option;
+        read_option.check_crc = rep_->option.check_crc;
+        BlockContents contents;
+        if (!ReadBlock(read_option, rep_->file, filter_handle, &contents).ok()) {
+            // the Get goes on without filter.
+            return true;
+        }
+        cached = new CachedFilter;
+        cached->filter = nullptr;
+        cached->contents = contents.data;
+        cached->data = (contents.heap_allocated_ ? contents.data.data() : nullptr);
+        if (cache != nullptr) {
+            handle = cache->Insert(cache_key, cached, contents.data.size(),
+                    &DeleteCachedFilter,
+                    MetadataPriority(rep_->option,
+                            rep_->level.load(std::memory_order_relaxed)));
+            AddPartition(filter_handle);
+        }
+    }
+    const bool match = rep_->filter_policy->KeyMayMatch(key,
+            cached->contents);
+    if (handle != nullptr) {
+        cache->Release(handle);
+    } else {
+        DeleteCachedFilter(cache_key, cached);
+    }
+    return match;
+}
+
+bool SSTableReader::KeyMayMatch(std::string_view key) const {
+    if (!rep_->full_filter) {
+        return true;
+    }
+    if (rep_->option.metadata_cache != nullptr) {
+        return RawFilterMayMatch(rep_->filter_handle, key);
+    }
+    return rep_->filter_contents.empty() ||
+           rep_->filter_policy->KeyMayMatch(key, rep_->filter_contents);
+}
+
+void SSTableReader::ReleaseMetadata(Cache::Handle* handle) const {
+    if (handle != nullptr) {
+        rep_->option.metadata_cache->Release(handle);
+    }
+}
+
+static void DeleteCompressedBlock(std::string_view key, void* value) {
+    delete reinterpret_cast<std::string*>(value);
+}
+
+void SSTableReader::EncodeBlockKey(const BlockHandle& handle, char* buf) const {
+    std::memcpy(buf, rep_->block_key_prefix, sizeof(rep_->block_key_prefix));
+    EncodeFixed64(buf + sizeof(rep_->block_key_prefix), handle.GetOffset());
+}
+
+Status SSTableReader::ReadDataBlock(const ReadOption& option,
+        const BlockHandle& handle, BlockContents* contents) const {
+    Cache* cache = rep_->block_cache;
+    if (cache == nullptr) {
+        return ReadBlock(option, rep_->file, handle, contents,
+                rep_->compression_dict);
+    }
+    char buf[24];
+    EncodeBlockKey(handle, buf);
+    std::string_view key(buf, sizeof(buf));
+    Cache::Handle* cache_handle = cache->Lookup(key);
+    if (cache_handle != nullptr) {
+        const std::string* stored =
+                reinterpret_cast<std::string*>(cache->Value(cache_handle));
+        Status s = UncompressBlockContents(stored->data(), stored->size() - 1,
+                contents, rep_->compression_dict);
+        cache->Release(cache_handle);
+        return s;
+    }
+    if (!option.fill_cache) {
+        return ReadBlock(option, rep_->file, handle, contents,
+                rep_->compression_dict);
+    }
+    std::string* stored = new std::string;
+    Status s = ReadBlock(option, rep_->file, handle, contents,
+            rep_->compression_dict, stored);
+    if (s.ok()) {
+        cache->Release(cache->Insert(key, stored, stored->size(),
+                &DeleteCompressedBlock));
+    } else {
+        delete stored;
+    }
+    return s;
+}
+
+void SSTableReader::EraseCompressedBlocks() const {
+    Cache* cache = rep_->block_cache;
+    if (cache == nullptr) {
+        return;
+    }
+    ReadOption option;
+    option.check_crc = rep_->option.check_crc;
+    Iterator* index_iter = NewIndexIterator(option);
+    char buf[24];
+    for (index_iter->SeekToFirst(); index_iter->Valid(); index_iter->Next()) {
+        std::string_view handle_contents = index_iter->Value();
+        BlockHandle handle;
+        if (handle.DecodeFrom(&handle_contents).ok()) {
+            EncodeBlockKey(handle, buf);
+            cache->Erase(std::string_view(buf, sizeof(buf)));
+        }
+    }
+    delete index_iter;
 }
 
 static void DeleteBlock(void* arg, void* none) {
@@ -124,7 +524,7 @@ Iterator* SSTableReader::ReadBlockHandle(void* arg, const ReadOption& option, st
     Status s = handle.DecodeFrom(&tmp);
 
     if (s.ok()) {
-        s = ReadBlock(option, table->rep_->file, handle, &block_contents);
+        s = table->ReadDataBlock(option, handle, &block_contents);
         if (s.ok()) {
             block = new BlockReader(block_contents);
         }
@@ -141,39 +541,154 @@ Iterator* SSTableReader::ReadBlockHandle(void* arg, const ReadOption& option, st
     return iter;
 }
 
+static void ReleaseMetadataEntry(void* arg1, void* arg2) {
+    Cache* cache = reinterpret_cast<Cache*>(arg1);
+    cache->Release(reinterpret_cast<Cache::Handle*>(arg2));
+}
+
+Iterator* SSTableReader::ReadIndexPartition(void* arg, const ReadOption& option,
+        std::string_view handle_contents) {
+    SSTableReader* table = reinterpret_cast<SSTableReader*>(arg);
+    // the handle of filter partition follows, which is not used here.
+    BlockHandle handle;
+    Status s = handle.DecodeFrom(&handle_contents);
+    BlockReader* block = nullptr;
+    Cache::Handle* cache_handle = nullptr;
+    if (s.ok()) {
+        s = table->ReadIndexBlock(handle, &block, &cache_handle);
+    }
+    if (!s.ok()) {
+        return NewErrorIterator(s);
+    }
+    Iterator* iter = block->NewIterator(table->rep_->option.comparator);
+    if (cache_handle != nullptr) {
+        iter->AppendCleanup(&ReleaseMetadataEntry,
+                table->rep_->option.metadata_cache, cache_handle);
+    } else {
+        iter->AppendCleanup(&DeleteBlock, block, nullptr);
+    }
+    return iter;
+}
+
+Iterator* SSTableReader::NewIndexIterator(const ReadOption& option) const {
+    BlockReader* index_block;
+    Cache::Handle* handle;
+    Status s = GetIndexBlock(&index_block, &handle);
+    if (!s.ok()) {
+        return NewErrorIterator(s);
+    }
+    Iterator* index_iter = index_block->NewIterator(rep_->option.comparator);
+    if (handle != nullptr) {
+        // the index block is pinned until the iterator is deleted.
+        index_iter->AppendCleanup(&ReleaseMetadataEntry,
+                rep_->option.metadata_cache, handle);
+    }
+    if (rep_->partitioned) {
+        // the top level index -> the index partitions -> the data blocks
+        index_iter = NewTwoLevelIterator(index_iter, &ReadIndexPartition,
+                const_cast<SSTableReader*>(this), option);
+    }
+    return index_iter;
+}
+
 Iterator* SSTableReader::NewIterator(const ReadOption& option) const {
-    return NewTwoLevelIterator(
-        rep_->index_block->NewIterator(rep_->option.comparator),
-        &ReadBlockHandle, const_cast<SSTableReader*>(this), option
-    );
+    return NewTwoLevelIterator(NewIndexIterator(option), &ReadBlockHandle,
+            const_cast<SSTableReader*>(this), option);
+}
+
+Status SSTableReader::BlockGet(const ReadOption& option,
+        std::string_view handle_contents, std::string_view key, void* arg,
+        void (*handle_result)(void*, std::string_view, std::string_view)) {
+    BlockHandle handle;
+    Status s = handle.DecodeFrom(&handle_contents);
+    if (!s.ok()) {
+        return s;
+    }
+    BlockContents block_contents;
+    s = ReadDataBlock(option, handle, &block_contents);
+    if (!s.ok()) {
+        return s;
+    }
+    BlockReader block(block_contents);
+    Iterator* block_iter = block.NewIterator(rep_->option.comparator);
+    if (block.SeekForGet(block_iter, key) && block_iter->Valid()) {
+        (*handle_result)(arg, block_iter->Key(), block_iter->Value());
+    }
+    s = block_iter->status();
+    delete block_iter;
+    return s;
+}
+
+Status SSTableReader::PartitionedGet(const ReadOption& option, std::string_view key,
+        void* arg, void (*handle_result)(void*, std::string_view, std::string_view)) {
+    BlockReader* top_block;
+    Cache::Handle* top_handle;
+    Status s = GetIndexBlock(&top_block, &top_handle);
+    if (!s.ok()) {
+        return s;
+    }
+    Iterator* top_iter = top_block->NewIterator(rep_->option.comparator);
+    top_iter->Seek(key);
+    if (top_iter->Valid()) {
+        std::string_view handles = top_iter->Value();
+        BlockHandle index_handle, filter_handle;
+        s = index_handle.DecodeFrom(&handles);
+        if (s.ok() && rep_->partitioned_filter &&
+                filter_handle.DecodeFrom(&handles).ok() &&
+                !RawFilterMayMatch(filter_handle, key)) {
+            // key is not found.
+        } else if (s.ok()) {
+            Iterator* index_iter = ReadIndexPartition(this, option, top_iter->Value());
+            index_iter->Seek(key);
+            if (index_iter->Valid()) {
+                s = BlockGet(option, index_iter->Value(), key, arg, handle_result);
+            }
+            if (s.ok()) {
+                s = index_iter->status();
+            }
+            delete index_iter;
+        }
+    }
+    if (s.ok()) {
+        s = top_iter->status();
+    }
+    delete top_iter;
+    ReleaseMetadata(top_handle);
+    return s;
 }
 
 Status SSTableReader::InternalGet(const ReadOption& option, std::string_view key, void* arg,
              void (*handle_result)(void*, std::string_view, std::string_view)) {
-    Status s;
-    Iterator* index_iter = rep_->index_block->NewIterator(rep_->option.comparator);
+    if (rep_->partitioned) {
+        return PartitionedGet(option, key, arg, handle_result);
+    }
+    BlockReader* index_block;
+    Cache::Handle* index_handle;
+    Status s = GetIndexBlock(&index_block, &index_handle);
+    if (!s.ok()) {
+        return s;
+    }
+    Cache::Handle* filter_handle = nullptr;
+    Iterator* index_iter = index_block->NewIterator(rep_->option.comparator);
     index_iter->Seek(key);
     if (index_iter->Valid()) {
         std::string_view handle_content = index_iter->Value();
+        std::string_view handle_input = handle_content;
         BlockHandle handle;
-        FilterBlockReader* filter = rep_->filter;
-        if (filter != nullptr && handle.DecodeFrom(&handle_content).ok() 
-                && filter->KeyMayMatch(handle.GetOffset(), key)) {
+        FilterBlockReader* filter = GetFilter(&filter_handle);
+        if (filter != nullptr && handle.DecodeFrom(&handle_input).ok()
+                && !filter->KeyMayMatch(handle.GetOffset(), key)) {
             // key is not found.
         } else {
-            Iterator* block_iter = ReadBlockHandle(this, option, handle_content);
-            block_iter->Seek(key);
-            if (block_iter->Valid()) {
-                (*handle_result)(arg, block_iter->Key(), block_iter->Value());
-            }
-            s = block_iter->status();
-            delete block_iter;
+            s = BlockGet(option, handle_content, key, arg, handle_result);
         }
     }
     if (s.ok()) {
         s = index_iter->status();
     }
     delete index_iter;
+    ReleaseMetadata(filter_handle);
+    ReleaseMetadata(index_handle);
     return s;
 }
 
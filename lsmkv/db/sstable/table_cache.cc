@@ -1,5 +1,6 @@
 #include "db/sstable/table_cache.h"
 
+#include <atomic>
 #include <string_view>
 
 #include "include/cache.h"
@@ -26,12 +27,40 @@ static void UnrefEntry(void* arg1, void* arg2) {
   Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(arg2);
   cache->Release(handle);
 }
+static uint64_t NewCacheId() {
+  static std::atomic<uint64_t> next_id(0);
+  return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+TableCache::TableCache(const std::string name, const Option& option,
+                       size_t capacity)
+    : name_(name),
+      option_(option),
+      env_(option.env),
+      cache_(option.table_cache != nullptr ? option.table_cache
+                                           : NewLRUCache(capacity)),
+      owns_cache_(option.table_cache == nullptr),
+      cache_id_(NewCacheId()),
+      db_id_(0) {}
+
+TableCache::~TableCache() {
+  if (owns_cache_) {
+    delete cache_;
+  }
+}
+
+void TableCache::EncodeKey(uint64_t file_number, char* buf) const {
+  EncodeFixed64(buf, cache_id_);
+  EncodeFixed64(buf + 8, file_number);
+}
+
 Status TableCache::Get(const ReadOption& option, uint64_t file_number,
-                       uint64_t file_size, std::string_view key, void* arg,
+                       uint64_t file_size, int level, std::string_view key,
+                       void* arg,
                        void (*handle_result)(void*, std::string_view,
                                              std::string_view)) {
   Cache::Handle* handle = nullptr;
-  Status s = FindTable(file_number, file_size, &handle);
+  Status s = FindTable(file_number, file_size, level, &handle);
   if (s.ok()) {
     SSTableReader* table =
         reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
@@ -41,17 +70,44 @@ Status TableCache::Get(const ReadOption& option, uint64_t file_number,
   return s;
 }
 
+bool TableCache::KeyMayMatch(uint64_t file_number, uint64_t file_size,
+                             int level, std::string_view key) {
+  Cache::Handle* handle = nullptr;
+  if (!FindTable(file_number, file_size, level, &handle).ok()) {
+    return true;
+  }
+  SSTableReader* table =
+      reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+  const bool match = table->KeyMayMatch(key);
+  cache_->Release(handle);
+  return match;
+}
+
 void TableCache::Evict(uint64_t file_number) {
-  char buf[sizeof(file_number)];
-  EncodeFixed64(buf, file_number);
+  char buf[16];
+  EncodeKey(file_number, buf);
   cache_->Erase(std::string_view(buf, sizeof(buf)));
 }
 
+void TableCache::EraseCompressedBlocks(uint64_t file_number) {
+  uint64_t file_size;
+  if (option_.compressed_block_cache == nullptr ||
+      !env_->FileSize(SSTableFileName(name_, file_number), &file_size).ok()) {
+    return;
+  }
+  Cache::Handle* handle = nullptr;
+  if (FindTable(file_number, file_size, -1, &handle).ok()) {
+    reinterpret_cast<TableAndFile*>(cache_->Value(handle))
+        ->table->EraseCompressedBlocks();
+    cache_->Release(handle);
+  }
+}
+
 Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
-                             Cache::Handle** handle) {
+                             int level, Cache::Handle** handle) {
   Status s;
-  char buf[sizeof(file_number)];
-  EncodeFixed64(buf, file_number);
+  char buf[16];
+  EncodeKey(file_number, buf);
   std::string_view key(buf, sizeof(buf));
   *handle = cache_->Lookup(key);
   if (*handle == nullptr) {
@@ -60,7 +116,10 @@ Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
     s = env_->NewRamdomReadFile(filename, &file);
     SSTableReader* table = nullptr;
     if (s.ok()) {
-      s = SSTableReader::Open(option_, file, file_size, &table);
+      s = (db_id_ != 0
+               ? SSTableReader::Open(option_, file, file_size, db_id_,
+                                     file_number, &table)
+               : SSTableReader::Open(option_, file, file_size, &table));
     }
     if (!s.ok()) {
       delete file;
@@ -71,13 +130,18 @@ Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
       *handle = cache_->Insert(key, tf, 1, &DeleteEntry);
     }
   }
+  if (s.ok() && level >= 0) {
+    reinterpret_cast<TableAndFile*>(cache_->Value(*handle))
+        ->table->SetLevel(level);
+  }
   return s;
 }
 
 Iterator* TableCache::NewIterator(const ReadOption& option,
-                                  uint64_t file_number, uint64_t file_size) {
+                                  uint64_t file_number, uint64_t file_size,
+                                  int level) {
   Cache::Handle* handle = nullptr;
-  Status s = FindTable(file_number, file_size, &handle);
+  Status s = FindTable(file_number, file_size, level, &handle);
   if (!s.ok()) {
     return NewErrorIterator(s);
   }
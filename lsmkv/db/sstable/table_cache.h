@@ -12,26 +12,51 @@ class Iterator;
 
 class TableCache {
  public:
-    TableCache(const std::string name, const Option& option, size_t capacity)
-            : name_(name), option_(option),
-              env_(option.env), cache_(NewLRUCache(capacity)) {}
+    // if "option.table_cache" is set, the tables are cached in it,
+    // otherwise in a cache of "capacity" owned by this.
+    TableCache(const std::string name, const Option& option, size_t capacity);
 
-    ~TableCache() { delete cache_; }
+    ~TableCache();
     
+    // "level" is the level of the table, -1 if unknown. the full filter
+    // is not checked, see KeyMayMatch.
     Status Get(const ReadOption& option, uint64_t file_number, uint64_t file_size,
-            std::string_view key, void* arg, void (*handle_result)(void*, std::string_view, std::string_view));
+            int level, std::string_view key, void* arg,
+            void (*handle_result)(void*, std::string_view, std::string_view));
+
+    // return false if the key is surely not in the table by its full
+    // filter, see "Option::full_filter". errors are left to Get.
+    bool KeyMayMatch(uint64_t file_number, uint64_t file_size, int level,
+            std::string_view key);
 
     void Evict(uint64_t file_number);
 
-    Iterator* NewIterator(const ReadOption& option, uint64_t file_number, uint64_t file_size);
+    // erase the data blocks of a table from
+    // "Option::compressed_block_cache" before its file is deleted.
+    void EraseCompressedBlocks(uint64_t file_number);
+
+    // the id of the DB, see IdentityFileName. set before any table
+    // is opened, or the tables do not use the compressed block cache.
+    void SetDBId(uint64_t db_id) { db_id_ = db_id; }
+
+    Iterator* NewIterator(const ReadOption& option, uint64_t file_number,
+            uint64_t file_size, int level = -1);
 
  private:
-    Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle** handle);
+    Status FindTable(uint64_t file_number, uint64_t file_size, int level,
+            Cache::Handle** handle);
+
+    // the key of a table in cache_
+    void EncodeKey(uint64_t file_number, char* buf) const;
     
     const std::string name_;
     const Option& option_;
     Env* env_;
     Cache* cache_;
+    const bool owns_cache_;
+    // distinguish the tables of different DBs sharing a cache
+    const uint64_t cache_id_;
+    uint64_t db_id_;
 };
 
 }
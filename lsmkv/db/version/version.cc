@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <limits>
 
 #include "db/log/log_reader.h"
 #include "db/version/merge.h"
@@ -11,11 +12,15 @@
 
 namespace lsmkv {
 VersionSet::VersionSet(const std::string name, const Option* option,
-                       TableCache* cache, const InternalKeyComparator* cmp)
+                       TableCache* cache, const InternalKeyComparator* cmp,
+                       const InternalFilterPolicies* policies,
+                       VersionSet* root, uint32_t column_family,
+                       const std::string& column_family_name)
     : name_(name),
       option_(option),
       env_(option->env),
       icmp_(*cmp),
+      policies_(policies),
       table_cache_(cache),
       dummy_head_(this),
       current_(nullptr),
@@ -24,12 +29,19 @@ VersionSet::VersionSet(const std::string name, const Option* option,
       next_file_number_(2),
       meta_file_number_(0),
       meta_log_file_(nullptr),
-      meta_log_writer_(nullptr) {
+      meta_log_writer_(nullptr),
+      root_(root == nullptr ? this : root),
+      column_family_(column_family),
+      column_family_name_(column_family_name) {
   AppendVersion(new Version(this));
+  root_->families_[column_family_] = this;
 }
 VersionSet::~VersionSet() {
   current_->Unref();
   assert(dummy_head_.next_ == &dummy_head_);
+  if (root_ != this) {
+    root_->families_.erase(column_family_);
+  }
   delete meta_log_file_;
   delete meta_log_writer_;
 }
@@ -167,6 +179,11 @@ Status Version::Get(const ReadOption& option, const LookupKey& key,
      */
     static bool SSTableMatch(void* arg, int level, FileMeta* meta) {
       State* state = reinterpret_cast<State*>(arg);
+      // the file ruled out by its full filter costs no seek.
+      if (!state->vset->table_cache_->KeyMayMatch(
+              meta->number, meta->file_size, level, state->internal_key)) {
+        return true;
+      }
       if (state->last_seek_file != nullptr &&
           state->stats->seek_file == nullptr) {
         state->stats->seek_file = state->last_seek_file;
@@ -176,8 +193,8 @@ Status Version::Get(const ReadOption& option, const LookupKey& key,
       state->last_seek_file_level = level;
 
       state->s = state->vset->table_cache_->Get(
-          *state->option, meta->number, meta->file_size, state->internal_key,
-          &state->saver, &SaveResult);
+          *state->option, meta->number, meta->file_size, level,
+          state->internal_key, &state->saver, &SaveResult);
       if (!state->s.ok()) {
         state->found = true;
         return false;
@@ -201,6 +218,7 @@ Status Version::Get(const ReadOption& option, const LookupKey& key,
   };
 
   State state;
+  state.stats = stats;
   state.saver.user_key = key.UserKey();
   state.saver.state = KNotFound;
   state.saver.result = result;
@@ -304,6 +322,35 @@ class VersionSet::Builder {
         AddFile(v, i, *base_iter);
       }
     }
+    SaveOverlappingBytes(v);
+  }
+  // files in level > 0 are sorted and have no overlap, so the
+  // overlapping files of files_[level][i] in the next level
+  // can be found by one pass.
+  void SaveOverlappingBytes(Version* v) {
+    const Comparator* ucmp = vset_->icmp_.UserComparator();
+    for (int level = 1; level + 1 < config::kNumLevels; level++) {
+      const std::vector<FileMeta*>& files = v->files_[level];
+      const std::vector<FileMeta*>& next_files = v->files_[level + 1];
+      std::vector<uint64_t>* overlapping_bytes = &v->overlapping_bytes_[level];
+      overlapping_bytes->assign(files.size(), 0);
+      size_t start = 0;
+      for (size_t i = 0; i < files.size(); i++) {
+        const FileMeta* meta = files[i];
+        while (start < next_files.size() &&
+               ucmp->Compare(next_files[start]->largest.user_key(),
+                             meta->smallest.user_key()) < 0) {
+          start++;
+        }
+        for (size_t j = start;
+             j < next_files.size() &&
+             ucmp->Compare(next_files[j]->smallest.user_key(),
+                           meta->largest.user_key()) <= 0;
+             j++) {
+          (*overlapping_bytes)[i] += next_files[j]->file_size;
+        }
+      }
+    }
   }
   void AddFile(Version* v, int level, FileMeta* meta) {
     if (level_[level].deleted_files.count(meta->number)) {
@@ -345,7 +392,8 @@ class VersionSet::Builder {
   LevelState level_[config::kNumLevels];
 };
 
-Status VersionSet::Recover() {
+Status VersionSet::ReadMetaFile(void* arg,
+                                Status (*handle)(void*, VersionEdit*)) {
   std::string current;
   Status s = ReadStringFromFile(env_, &current, CurrentFileName(name_));
   if (!s.ok()) {
@@ -360,16 +408,6 @@ Status VersionSet::Recover() {
     }
     return s;
   }
-  uint64_t log_number = 0;
-  SequenceNum last_sequence = 0;
-  uint64_t next_file_number = 0;
-  std::string comparator_name;
-  bool has_log_number = false;
-  bool has_last_sequence = false;
-  bool has_next_file_number = false;
-  bool has_comparator_name = false;
-  Builder builder(this, current_);
-
   {
     log::Reader reader(file, true, 0);
     std::string_view sv;
@@ -378,53 +416,107 @@ Status VersionSet::Recover() {
       VersionEdit edit;
       s = edit.DecodeFrom(sv);
       if (s.ok()) {
-        if (edit.has_comparator_name_ &&
-            edit.comparator_name_ != icmp_.UserComparator()->Name()) {
-          s = Status::Corruption(edit.comparator_name_ + "don't match " +
-                                 icmp_.UserComparator()->Name());
-        }
-      }
-      if (s.ok()) {
-        builder.Apply(&edit);
-      }
-      if (edit.has_log_number_) {
-        has_log_number = true;
-        log_number = edit.log_number_;
-      }
-      if (edit.has_last_sequence_) {
-        has_last_sequence = true;
-        last_sequence = edit.last_sequence_;
-      }
-      if (edit.has_next_file_number_) {
-        has_next_file_number = true;
-        next_file_number = edit.next_file_number_;
+        s = handle(arg, &edit);
       }
     }
   }
   delete file;
+  return s;
+}
+
+Status VersionSet::ListColumnFamilies(
+    std::map<uint32_t, std::string>* families) {
+  return ReadMetaFile(families, [](void* arg, VersionEdit* edit) {
+    auto* result = reinterpret_cast<std::map<uint32_t, std::string>*>(arg);
+    if (edit->has_column_family_name_) {
+      (*result)[edit->column_family_] = edit->column_family_name_;
+    }
+    return Status::OK();
+  });
+}
+
+struct VersionSet::RecoverState {
+  struct Family {
+    Builder* builder;
+    bool has_log_number;
+    uint64_t log_number;
+  };
+  VersionSet* root;
+  std::map<uint32_t, Family> families;
+  SequenceNum last_sequence = 0;
+  uint64_t next_file_number = 0;
+  bool has_last_sequence = false;
+  bool has_next_file_number = false;
+};
+
+Status VersionSet::ApplyRecoveredEdit(void* arg, VersionEdit* edit) {
+  RecoverState* state = reinterpret_cast<RecoverState*>(arg);
+  auto it = state->families.find(edit->column_family_);
+  if (it == state->families.end()) {
+    return Status::Corruption("unknown column family in meta file");
+  }
+  VersionSet* vset = state->root->families_[edit->column_family_];
+  if (edit->has_comparator_name_ &&
+      edit->comparator_name_ != vset->icmp_.UserComparator()->Name()) {
+    return Status::Corruption(edit->comparator_name_ + "don't match " +
+                              vset->icmp_.UserComparator()->Name());
+  }
+  it->second.builder->Apply(edit);
+  if (edit->has_log_number_) {
+    it->second.has_log_number = true;
+    it->second.log_number = edit->log_number_;
+  }
+  if (edit->has_last_sequence_) {
+    state->has_last_sequence = true;
+    state->last_sequence = edit->last_sequence_;
+  }
+  if (edit->has_next_file_number_) {
+    state->has_next_file_number = true;
+    state->next_file_number = edit->next_file_number_;
+  }
+  return Status::OK();
+}
+
+Status VersionSet::Recover() {
+  assert(root_ == this);
+  RecoverState state;
+  state.root = this;
+  for (const auto& family : families_) {
+    VersionSet* vset = family.second;
+    state.families[family.first] =
+        RecoverState::Family{new Builder(vset, vset->current_), false, 0};
+  }
+  Status s = ReadMetaFile(&state, &VersionSet::ApplyRecoveredEdit);
 
   if (s.ok()) {
-    if (!has_log_number) {
+    if (!state.families[0].has_log_number) {
       s = Status::Corruption("no log_number in meta file");
     }
-    if (!has_last_sequence) {
+    if (!state.has_last_sequence) {
       s = Status::Corruption("no last_sequence in meta file");
     }
-    if (!has_next_file_number) {
+    if (!state.has_next_file_number) {
       s = Status::Corruption("no next_file_number in meta file");
     }
-    MarkFileNumberUsed(log_number);
   }
 
+  for (auto& family : state.families) {
+    VersionSet* vset = families_[family.first];
+    if (s.ok()) {
+      Version* v = new Version(vset);
+      family.second.builder->SaveTo(v);
+      vset->AppendVersion(v);
+      vset->EvalCompactionScore(v);
+      vset->UpdateFilterBits(v);
+      vset->log_number_ = family.second.log_number;
+      MarkFileNumberUsed(family.second.log_number);
+    }
+    delete family.second.builder;
+  }
   if (s.ok()) {
-    Version* v = new Version(this);
-    builder.SaveTo(v);
-    AppendVersion(v);
-    EvalCompactionScore(v);
-    log_number_ = log_number;
-    meta_file_number_ = next_file_number;
-    last_sequence_ = last_sequence;
-    next_file_number_ = next_file_number + 1;
+    meta_file_number_ = state.next_file_number;
+    last_sequence_ = state.last_sequence;
+    next_file_number_ = state.next_file_number + 1;
   }
   return s;
 }
@@ -432,12 +524,13 @@ Status VersionSet::Recover() {
 Status VersionSet::LogAndApply(VersionEdit* edit, Mutex* mu) {
   if (edit->has_log_number_) {
     assert(edit->log_number_ >= log_number_);
-    assert(edit->log_number_ < next_file_number_);
+    assert(edit->log_number_ < root_->next_file_number_);
   } else {
     edit->SetLogNumber(log_number_);
   }
-  edit->SetLastSequence(last_sequence_);
-  edit->SetNextFileNumber(next_file_number_);
+  edit->SetColumnFamily(column_family_);
+  edit->SetLastSequence(root_->last_sequence_);
+  edit->SetNextFileNumber(root_->next_file_number_);
 
   Version* v = new Version(this);
 
@@ -445,6 +538,20 @@ Status VersionSet::LogAndApply(VersionEdit* edit, Mutex* mu) {
   builder.Apply(edit);
   builder.SaveTo(v);
 
+  Status s = root_->WriteMetaRecord(edit, mu);
+  if (s.ok()) {
+    AppendVersion(v);
+    EvalCompactionScore(v);
+    UpdateFilterBits(v);
+    log_number_ = edit->log_number_;
+  } else {
+    delete v;
+  }
+  return s;
+}
+
+Status VersionSet::WriteMetaRecord(VersionEdit* edit, Mutex* mu) {
+  assert(root_ == this);
   Status s;
   std::string meta_file_name;
 
@@ -478,47 +585,53 @@ Status VersionSet::LogAndApply(VersionEdit* edit, Mutex* mu) {
     mu->Lock();
   }
 
-  if (s.ok()) {
-    AppendVersion(v);
-    EvalCompactionScore(v);
-    log_number_ = edit->log_number_;
-  } else {
-    delete v;
-    if (initialize) {
-      delete meta_log_file_;
-      delete meta_log_writer_;
-      meta_log_file_ = nullptr;
-      meta_log_writer_ = nullptr;
-      env_->RemoveFile(meta_file_name);
-    }
+  if (!s.ok() && initialize) {
+    delete meta_log_file_;
+    delete meta_log_writer_;
+    meta_log_file_ = nullptr;
+    meta_log_writer_ = nullptr;
+    env_->RemoveFile(meta_file_name);
   }
   return s;
 }
 
-Status VersionSet::WriteSnapShot(log::Writer* writer) {
-  VersionEdit edit;
-
-  edit.SetComparatorName(icmp_.UserComparator()->Name());
+void VersionSet::SnapShotEdit(VersionEdit* edit) {
+  edit->SetColumnFamily(column_family_);
+  if (column_family_ != 0) {
+    edit->AddColumnFamily(column_family_name_);
+    edit->SetLogNumber(log_number_);
+  }
+  edit->SetComparatorName(icmp_.UserComparator()->Name());
 
   for (int level = 0; level < config::kNumLevels; level++) {
     if (!compactor_pointer_[level].empty()) {
       InternalKey key;
       key.DecodeFrom(compactor_pointer_[level]);
-      edit.SetCompactionPointer(level, key);
+      edit->SetCompactionPointer(level, key);
     }
   }
 
   for (int level = 0; level < config::kNumLevels; level++) {
     const std::vector<FileMeta*>& files = current_->files_[level];
     for (const FileMeta* meta : files) {
-      edit.AddFile(level, meta->number, meta->file_size, meta->smallest,
-                   meta->largest);
+      edit->AddFile(level, *meta);
     }
   }
+}
 
-  std::string record;
-  edit.EncodeTo(&record);
-  return writer->AddRecord(record);
+Status VersionSet::WriteSnapShot(log::Writer* writer) {
+  Status s;
+  for (const auto& family : families_) {
+    VersionEdit edit;
+    family.second->SnapShotEdit(&edit);
+    std::string record;
+    edit.EncodeTo(&record);
+    s = writer->AddRecord(record);
+    if (!s.ok()) {
+      break;
+    }
+  }
+  return s;
 }
 
 void VersionSet::AppendVersion(Version* v) {
@@ -556,17 +669,6 @@ static uint64_t TotalFileSize(std::vector<FileMeta*> files) {
   return sum;
 }
 
-static double LevelMaxSize(int level) {
-  // the constants is from Leveldb.
-  // may be a experience value.
-  double result = 10. * 1048576.0;
-  while (level > 1) {
-    result *= 10;
-    level--;
-  }
-  return result;
-}
-
 static uint64_t ExpandCompactionLimit(const Option* option) {
   return 25 * option->max_file_size;
 }
@@ -579,17 +681,81 @@ static uint64_t SSTableFileLimit(const Option* option) {
   return option->max_file_size;
 }
 
+void VersionSet::CalculateLevelMaxSize(Version* v) {
+  const double base_size = static_cast<double>(option_->level_base_size);
+  const double multiplier = option_->level_size_multiplier;
+  // level-0 is scored by file num, its max size is unused.
+  v->level_max_size_[0] = 0;
+  if (!option_->dynamic_level_size) {
+    v->base_level_ = 1;
+    double level_size = base_size;
+    for (int level = 1; level < config::kNumLevels; level++) {
+      v->level_max_size_[level] = level_size;
+      level_size *= multiplier;
+    }
+    return;
+  }
+
+  int first_non_empty_level = -1;
+  uint64_t max_level_size = 0;
+  for (int level = 1; level < config::kNumLevels; level++) {
+    const uint64_t level_size = TotalFileSize(v->files_[level]);
+    if (level_size > 0 && first_non_empty_level == -1) {
+      first_non_empty_level = level;
+    }
+    max_level_size = std::max(max_level_size, level_size);
+  }
+  // the levels above the base level are never compacted into.
+  for (int level = 1; level < config::kNumLevels; level++) {
+    v->level_max_size_[level] = std::numeric_limits<double>::max();
+  }
+  if (max_level_size == 0) {
+    // empty db, level-0 is compacted into the last level directly.
+    v->base_level_ = config::kNumLevels - 1;
+    return;
+  }
+
+  // take the biggest level as the last level, and estimate the size
+  // of the first non empty level from it.
+  double level_size = static_cast<double>(max_level_size);
+  for (int level = config::kNumLevels - 2; level >= first_non_empty_level;
+       level--) {
+    level_size /= multiplier;
+  }
+  int base_level = first_non_empty_level;
+  if (level_size > base_size) {
+    // the first non empty level is too big, move the base level up
+    // until its size is not greater than "level_base_size".
+    while (base_level > 1 && level_size > base_size) {
+      base_level--;
+      level_size /= multiplier;
+    }
+  }
+  level_size = std::min(level_size, base_size);
+  for (int level = base_level; level < config::kNumLevels; level++) {
+    if (level > base_level) {
+      level_size *= multiplier;
+    }
+    // too small level size causes too many compactions.
+    v->level_max_size_[level] = std::max(level_size, base_size);
+  }
+  v->base_level_ = base_level;
+}
+
 void VersionSet::EvalCompactionScore(Version* v) {
   int best_level = -1;
   double best_score = -1;
 
-  for (int level = 0; level < config::kNumLevels; ++level) {
+  CalculateLevelMaxSize(v);
+  // the last level is never compacted by size
+  for (int level = 0; level < config::kNumLevels - 1; ++level) {
     double score;
     if (level == 0) {
-      score = v->files_[level].size() / config::kL0CompactionThreshold;
+      score = static_cast<double>(v->files_[level].size()) /
+              static_cast<double>(option_->l0_compaction_threshold);
     } else {
       const uint64_t file_size = TotalFileSize(v->files_[level]);
-      score = static_cast<double>(file_size) / LevelMaxSize(level);
+      score = static_cast<double>(file_size) / v->level_max_size_[level];
     }
     if (score > best_score) {
       best_level = level;
@@ -598,6 +764,41 @@ void VersionSet::EvalCompactionScore(Version* v) {
   }
   v->compaction_level = best_level;
   v->compaction_score = best_score;
+  FindDeletionFileToCompact(v);
+}
+
+void VersionSet::UpdateFilterBits(Version* v) {
+  if (policies_ == nullptr) {
+    return;
+  }
+  std::vector<uint64_t> level_sizes(config::kNumLevels);
+  for (int level = 0; level < config::kNumLevels; level++) {
+    level_sizes[level] = TotalFileSize(v->files_[level]);
+  }
+  policies_->SetLevelSizes(level_sizes);
+}
+
+void VersionSet::FindDeletionFileToCompact(Version* v) {
+  const double ratio_limit = option_->deletion_compaction_ratio;
+  double best_ratio = 0;
+  // the deletions in the last level have been dropped by compaction
+  // except for the newer records in upper levels
+  for (int level = 0; level < config::kNumLevels - 1; level++) {
+    for (FileMeta* meta : v->files_[level]) {
+      if (meta->num_entries == 0) {
+        continue;
+      }
+      const double ratio = static_cast<double>(meta->num_deletions) /
+                           static_cast<double>(meta->num_entries);
+      const bool over_ratio = (ratio_limit > 0 && ratio >= ratio_limit);
+      if ((over_ratio || meta->marked_for_compaction) &&
+          (v->deletion_file_to_compact_ == nullptr || ratio > best_ratio)) {
+        v->deletion_file_to_compact_ = meta;
+        v->deletion_file_to_compact_level_ = level;
+        best_ratio = ratio;
+      }
+    }
+  }
 }
 
 bool Version::UpdateStats(const GetStats& stats) {
@@ -624,10 +825,10 @@ void VersionSet::GetRange(const std::vector<FileMeta*>& input,
       *smallest = meta->smallest;
       *largest = meta->largest;
     } else {
-      if (icmp_.Compare(*smallest, meta->smallest) < 0) {
+      if (icmp_.Compare(meta->smallest, *smallest) < 0) {
         *smallest = meta->smallest;
       }
-      if (icmp_.Compare(*largest, meta->largest) > 0) {
+      if (icmp_.Compare(meta->largest, *largest) > 0) {
         *largest = meta->largest;
       }
     }
@@ -714,32 +915,151 @@ void AddBoundaryInputs(const InternalKeyComparator* icmp,
     largest_key = meta->largest;
   }
 }
+FileMeta* VersionSet::PickFileToCompact(int level) {
+  const std::vector<FileMeta*>& files = current_->files_[level];
+  assert(!files.empty());
+  // all the overlapping files in level-0 will be picked,
+  // so the priority is useless for level-0.
+  const CompactionPriority priority =
+      (level == 0 ? KByCompactionPointer : option_->compaction_priority);
+  FileMeta* ret = nullptr;
+  switch (priority) {
+    case KMinOverlappingRatio: {
+      const std::vector<uint64_t>& overlapping_bytes =
+          current_->overlapping_bytes_[level];
+      assert(overlapping_bytes.size() == files.size());
+      double min_ratio = 0;
+      for (size_t i = 0; i < files.size(); i++) {
+        // avoid dividing by zero for empty files.
+        const double ratio = static_cast<double>(overlapping_bytes[i]) /
+                             static_cast<double>(files[i]->file_size + 1);
+        if (ret == nullptr || ratio < min_ratio) {
+          ret = files[i];
+          min_ratio = ratio;
+        }
+      }
+      break;
+    }
+    case KOldestFileFirst:
+      for (FileMeta* meta : files) {
+        if (ret == nullptr || meta->number < ret->number) {
+          ret = meta;
+        }
+      }
+      break;
+    case KByCompactionPointer:
+      for (FileMeta* meta : files) {
+        if (compactor_pointer_[level].empty() ||
+            icmp_.Compare(meta->largest.Encode(), compactor_pointer_[level]) >
+                0) {
+          ret = meta;
+          break;
+        }
+      }
+      if (ret == nullptr) {
+        ret = files[0];
+      }
+      break;
+  }
+  return ret;
+}
+
+// at least this number of level-0 files are merged by a
+// intra level-0 compaction.
+static constexpr size_t KMinFilesForIntraL0Compaction = 2;
+
+Compaction* VersionSet::PickIntraL0Compaction() {
+  // only the newest files can be merged, or the output (has the
+  // biggest file number) will hide the newer records in other files.
+  std::vector<FileMeta*> files = current_->files_[0];
+  std::sort(files.begin(), files.end(), NewFirst);
+  std::vector<FileMeta*> input;
+  uint64_t total_size = 0;
+  for (FileMeta* meta : files) {
+    if (meta->file_size > SSTableFileLimit(option_) ||
+        total_size + meta->file_size > ExpandCompactionLimit(option_)) {
+      break;
+    }
+    total_size += meta->file_size;
+    input.push_back(meta);
+  }
+  if (input.size() < KMinFilesForIntraL0Compaction) {
+    return nullptr;
+  }
+  Compaction* c = new Compaction(option_, 0, 0);
+  c->input_[0] = input;
+  // the output of level-0 is written to only one file
+  c->max_output_file_bytes_ = std::numeric_limits<uint64_t>::max();
+  c->input_version_ = current_;
+  c->input_version_->Ref();
+  return c;
+}
+
+void VersionSet::AddDisjointLevel0Inputs(Compaction* c) {
+  const std::vector<FileMeta*>& files = current_->files_[0];
+  if (c->input_[0].size() != 1 || !c->input_[1].empty()) {
+    return;
+  }
+  const Comparator* ucmp = icmp_.UserComparator();
+  auto overlap = [ucmp](const FileMeta* a, const FileMeta* b) {
+    return ucmp->Compare(a->largest.user_key(), b->smallest.user_key()) >= 0 &&
+           ucmp->Compare(b->largest.user_key(), a->smallest.user_key()) >= 0;
+  };
+  std::vector<FileMeta*> inputs = c->input_[0];
+  for (FileMeta* meta : files) {
+    if (meta == c->input_[0][0]) {
+      continue;
+    }
+    bool disjoint = true;
+    for (size_t i = 0; disjoint && i < files.size(); i++) {
+      disjoint = (files[i] == meta || !overlap(files[i], meta));
+    }
+    std::vector<FileMeta*> output_files;
+    current_->GetOverlappingFiles(c->output_level(), meta->smallest,
+                                  meta->largest, &output_files);
+    if (disjoint && output_files.empty()) {
+      inputs.push_back(meta);
+    }
+  }
+  if (inputs.size() == 1) {
+    return;
+  }
+  // the output level files between the inputs are not compacted, the
+  // inputs must be moved rather than merged.
+  InternalKey smallest, largest;
+  GetRange(inputs, &smallest, &largest);
+  std::vector<FileMeta*> grandparents;
+  if (c->output_level() + 1 < config::kNumLevels) {
+    current_->GetOverlappingFiles(c->output_level() + 1, smallest, largest,
+                                  &grandparents);
+  }
+  if (TotalFileSize(grandparents) < GrandparantsOverLapLimit(option_)) {
+    c->input_[0] = inputs;
+  }
+}
+
 Compaction* VersionSet::PickCompaction() {
   Compaction* c;
   int level;
 
   bool size_compaction = (current_->compaction_score >= 1);
   bool seek_compaction = (current_->file_to_compact_ != nullptr);
+  bool deletion_compaction = (current_->deletion_file_to_compact_ != nullptr);
   if (size_compaction) {
     level = current_->compaction_level;
     assert(level >= 0);
-    assert(level <= config::kL0CompactionThreshold);
-    c = new Compaction(option_, level);
-    for (FileMeta* meta : current_->files_[level]) {
-      if (compactor_pointer_[level].empty() ||
-          icmp_.Compare(meta->largest.Encode(), compactor_pointer_[level]) >
-              0) {
-        c->input_[0].push_back(meta);
-        break;
-      }
-    }
-    if (c->input_[0].empty()) {
-      c->input_[0].push_back(current_->files_[level][0]);
-    }
+    assert(level + 1 < config::kNumLevels);
+    c = new Compaction(option_, level, current_->OutputLevel(level));
+    c->input_[0].push_back(PickFileToCompact(level));
   } else if (seek_compaction) {
     level = current_->file_to_compact_level_;
-    c = new Compaction(option_, level);
+    c = new Compaction(option_, level, current_->OutputLevel(level));
     c->input_[0].push_back(current_->file_to_compact_);
+  } else if (deletion_compaction) {
+    level = current_->deletion_file_to_compact_level_;
+    c = new Compaction(option_, level, current_->OutputLevel(level));
+    c->input_[0].push_back(current_->deletion_file_to_compact_);
+    c->deletion_compaction_ = true;
   } else {
     return nullptr;
   }
@@ -747,6 +1067,18 @@ Compaction* VersionSet::PickCompaction() {
   c->input_version_ = current_;
   c->input_version_->Ref();
 
+  if (level == 0 && size_compaction && option_->intra_l0_compaction) {
+    const int base_level = current_->base_level_;
+    if (static_cast<double>(TotalFileSize(current_->files_[base_level])) >=
+        current_->level_max_size_[base_level]) {
+      Compaction* intra_c = PickIntraL0Compaction();
+      if (intra_c != nullptr) {
+        delete c;
+        return intra_c;
+      }
+    }
+  }
+
   // files in level-0 is possible over range.
   // collect all file ovp er range with the original file
   if (level == 0) {
@@ -755,11 +1087,16 @@ Compaction* VersionSet::PickCompaction() {
     current_->GetOverlappingFiles(0, smallest, largest, &c->input_[0]);
   }
 
+  const int output_level = c->output_level();
   InternalKey smallest, largest;
   AddBoundaryInputs(&icmp_, current_->files_[level], &c->input_[0]);
   GetRange(c->input_[0], &smallest, &largest);
-  current_->GetOverlappingFiles(level + 1, smallest, largest, &c->input_[1]);
-  AddBoundaryInputs(&icmp_, current_->files_[level + 1], &c->input_[1]);
+  current_->GetOverlappingFiles(output_level, smallest, largest,
+                                &c->input_[1]);
+  AddBoundaryInputs(&icmp_, current_->files_[output_level], &c->input_[1]);
+  if (level == 0 && !c->deletion_compaction_) {
+    AddDisjointLevel0Inputs(c);
+  }
 
   InternalKey all_smallest, all_largest;
   GetTwoRange(c->input_[0], c->input_[1], &all_smallest, &all_largest);
@@ -778,9 +1115,9 @@ Compaction* VersionSet::PickCompaction() {
       InternalKey new_smallest, new_largest;
       std::vector<FileMeta*> expand1;
       GetRange(expand0, &new_smallest, &new_largest);
-      current_->GetOverlappingFiles(level + 1, new_smallest, new_largest,
+      current_->GetOverlappingFiles(output_level, new_smallest, new_largest,
                                     &expand1);
-      AddBoundaryInputs(&icmp_, current_->files_[level + 1], &expand1);
+      AddBoundaryInputs(&icmp_, current_->files_[output_level], &expand1);
       if (expand1.size() == c->input_[1].size()) {
         smallest = new_smallest;
         largest = new_largest;
@@ -790,24 +1127,83 @@ Compaction* VersionSet::PickCompaction() {
       }
     }
   }
-  if (level + 2 < config::kNumLevels) {
-    current_->GetOverlappingFiles(level + 2, all_smallest, all_largest,
+  if (output_level + 1 < config::kNumLevels) {
+    current_->GetOverlappingFiles(output_level + 1, all_smallest, all_largest,
                                   &c->grandparents_);
   }
   c->edit_.SetCompactionPointer(level, largest);
   return c;
 }
 
-bool Compaction::SingalMove() const {
-  return (input_[0].size() == 1 && input_[1].size() == 0 &&
-          TotalFileSize(grandparents_) <
-              GrandparantsOverLapLimit(input_version_->vset_->option_));
+Compaction* VersionSet::ResumeCompaction(const CompactionProgress& progress) {
+  const int level = progress.level;
+  const int output_level = progress.output_level;
+  if (progress.inputs[0].empty() || level == output_level ||
+      output_level >= config::kNumLevels) {
+    return nullptr;
+  }
+  Compaction* c = new Compaction(option_, level, output_level);
+  const int levels[2] = {level, output_level};
+  for (int which = 0; which < 2; which++) {
+    for (uint64_t number : progress.inputs[which]) {
+      FileMeta* input = nullptr;
+      for (FileMeta* meta : current_->files_[levels[which]]) {
+        if (meta->number == number) {
+          input = meta;
+          break;
+        }
+      }
+      if (input == nullptr) {
+        delete c;
+        return nullptr;
+      }
+      c->input_[which].push_back(input);
+    }
+  }
+  c->input_version_ = current_;
+  c->input_version_->Ref();
+
+  InternalKey smallest, largest;
+  GetRange(c->input_[0], &smallest, &largest);
+  InternalKey all_smallest, all_largest;
+  GetTwoRange(c->input_[0], c->input_[1], &all_smallest, &all_largest);
+  if (output_level + 1 < config::kNumLevels) {
+    current_->GetOverlappingFiles(output_level + 1, all_smallest, all_largest,
+                                  &c->grandparents_);
+  }
+  c->edit_.SetCompactionPointer(level, largest);
+  return c;
+}
+
+bool Compaction::IsTrivialMove() const {
+  if (deletion_compaction_ || level_ == output_level_ || input_[0].empty() ||
+      !input_[1].empty() ||
+      TotalFileSize(grandparents_) >=
+          GrandparantsOverLapLimit(input_version_->vset_->option_)) {
+    return false;
+  }
+  if (level_ == 0) {
+    // files in level-0 may overlap with each other, they can be
+    // moved only if they are disjoint.
+    const Comparator* ucmp = input_version_->vset_->icmp_.UserComparator();
+    std::vector<FileMeta*> files = input_[0];
+    std::sort(files.begin(), files.end(), [ucmp](FileMeta* a, FileMeta* b) {
+      return ucmp->Compare(a->smallest.user_key(), b->smallest.user_key()) < 0;
+    });
+    for (size_t i = 1; i < files.size(); i++) {
+      if (ucmp->Compare(files[i - 1]->largest.user_key(),
+                        files[i]->smallest.user_key()) >= 0) {
+        return false;
+      }
+    }
+  }
+  return true;
 }
 
 void Compaction::AddInputDeletions(VersionEdit* edit) {
   for (int which = 0; which < 2; which++) {
     for (FileMeta* meta : input_[which]) {
-      edit->DeleteFile(level_ + which, meta->number);
+      edit->DeleteFile(which == 0 ? level_ : output_level_, meta->number);
     }
   }
 }
@@ -877,12 +1273,14 @@ Iterator* GetFileIterator(void* arg, const ReadOption& option,
 Iterator* VersionSet::MakeMergedIterator(Compaction* c) {
   ReadOption option;
   option.check_crc = option_->check_crc;
+  // the compaction reads every block once.
+  option.fill_cache = false;
   const size_t space = (c->level() == 0 ? 1 + c->input_[0].size() : 2);
   Iterator** list = new Iterator*[space];
   size_t idx = 0;
   for (int which = 0; which < 2; which++) {
     if (!c->input_[which].empty()) {
-      if (which + c->level_ == 0) {
+      if ((which == 0 ? c->level_ : c->output_level_) == 0) {
         const std::vector<FileMeta*>& input = c->input_[which];
         for (const FileMeta* meta : input) {
           list[idx++] =
@@ -901,21 +1299,27 @@ Iterator* VersionSet::MakeMergedIterator(Compaction* c) {
   delete[] list;
   return ret;
 }
-Compaction::Compaction(const Option* option, int level)
+Compaction::Compaction(const Option* option, int level, int output_level)
     : level_(level),
+      output_level_(output_level),
       max_output_file_bytes_(SSTableFileLimit(option)),
       input_version_(nullptr),
       grandparents_overlap_(0),
       grandparents_index_(0),
-      seen_key_(false) {}
+      seen_key_(false),
+      deletion_compaction_(false),
+      boundary_cuts_(0),
+      boundary_cut_saved_bytes_(0) {}
 
-bool Compaction::StopBefore(std::string_view key) {
+bool Compaction::StopBefore(std::string_view key, uint64_t output_size) {
   const InternalKeyComparator* icmp = &input_version_->vset_->icmp_;
+  bool cross_boundary = false;
   while (grandparents_index_ < grandparents_.size() &&
          icmp->Compare(
              key, grandparents_[grandparents_index_]->largest.Encode()) > 0) {
     if (seen_key_) {
       grandparents_overlap_ += grandparents_[grandparents_index_]->file_size;
+      cross_boundary = true;
     }
     ++grandparents_index_;
   }
@@ -926,12 +1330,54 @@ bool Compaction::StopBefore(std::string_view key) {
     grandparents_overlap_ = 0;
     return true;
   }
+  const uint64_t cut_size =
+      input_version_->vset_->option_->output_boundary_cut_size;
+  if (cross_boundary && cut_size > 0 && output_size >= cut_size) {
+    // the file after the boundary would be overlapped by the current
+    // output and the next one if the current output went on.
+    grandparents_overlap_ = 0;
+    boundary_cuts_++;
+    if (grandparents_index_ < grandparents_.size()) {
+      boundary_cut_saved_bytes_ +=
+          grandparents_[grandparents_index_]->file_size;
+    }
+    return true;
+  }
   return false;
 }
 
+uint64_t Compaction::GrandparentsOverlapBytes(const InternalKey& smallest,
+                                              const InternalKey& largest) {
+  const Comparator* ucmp = input_version_->vset_->icmp_.UserComparator();
+  uint64_t bytes = 0;
+  for (const FileMeta* meta : grandparents_) {
+    if (ucmp->Compare(meta->largest.user_key(), smallest.user_key()) >= 0 &&
+        ucmp->Compare(meta->smallest.user_key(), largest.user_key()) <= 0) {
+      bytes += meta->file_size;
+    }
+  }
+  return bytes;
+}
+
+bool Compaction::IsBottommostLevel() const {
+  if (output_level_ == 0) {
+    return false;
+  }
+  for (int level = output_level_ + 1; level < config::kNumLevels; level++) {
+    if (!input_version_->files_[level].empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool Compaction::IsBaseLevelForKey(std::string_view key) {
+  if (output_level_ == 0) {
+    // other level-0 files may contain the key.
+    return false;
+  }
   const Comparator* ucmp = input_version_->vset_->icmp_.UserComparator();
-  for (int level = level_ + 2; level < config::kNumLevels; level++) {
+  for (int level = output_level_ + 1; level < config::kNumLevels; level++) {
     for (auto meta : input_version_->files_[level]) {
       if (ucmp->Compare(key, meta->smallest.user_key()) >= 0 &&
           ucmp->Compare(key, meta->largest.user_key()) <= 0) {
@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <map>
 
 #include "db/format/dbformat.h"
 #include "db/log/log_writer.h"
@@ -79,7 +80,10 @@ class Version {
         file_to_compact_level_(-1),
         file_to_compact_(nullptr),
         compaction_level(-1),
-        compaction_score(-1) {}
+        compaction_score(-1),
+        base_level_(1),
+        deletion_file_to_compact_level_(-1),
+        deletion_file_to_compact_(nullptr) {}
 
   Version(const Version&) = delete;
   Version& operator=(const Version&) = delete;
@@ -97,6 +101,11 @@ class Version {
   void ForEachFile(std::string_view user_key, std::string_view internal_key,
                    void* arg, bool (*fun)(void*, int, FileMeta*));
 
+  // the level that files of "level" are compacted into.
+  int OutputLevel(int level) const {
+    return level == 0 ? base_level_ : level + 1;
+  }
+
  private:
   VersionSet* vset_;
   Version* next_;
@@ -115,12 +124,36 @@ class Version {
   // the score is setted by EvalCompactionScore()
   int compaction_level;
   double compaction_score;
+
+  // level-0 is compacted into "base_level_", the levels between
+  // them are empty. It is always 1 unless "dynamic_level_size" is set.
+  // the max total file size of each level is setted by
+  // CalculateLevelMaxSize()
+  int base_level_;
+  double level_max_size_[config::kNumLevels];
+
+  // the total size of files in level-(N+1) that overlap with
+  // files_[N][i], N > 0. setted by VersionSet::Builder::SaveTo()
+  std::vector<uint64_t> overlapping_bytes_[config::kNumLevels];
+
+  // compaction case 3: When a file has too many deletion records,
+  // compact it to drop them. setted by EvalCompactionScore()
+  int deletion_file_to_compact_level_;
+  FileMeta* deletion_file_to_compact_;
 };
 
 class VersionSet {
  public:
+  // each column family has a VersionSet for its levels. "root" is the set
+  // of the default column family, which owns the meta file, the file
+  // numbers and the sequence shared by all the column families.
+  // the filters of "policies" are sized for the levels of every new
+  // version, see "Option::filter_bits_per_key_budget".
   VersionSet(const std::string name, const Option* option, TableCache* cache,
-             const InternalKeyComparator* cmp);
+             const InternalKeyComparator* cmp,
+             const InternalFilterPolicies* policies = nullptr,
+             VersionSet* root = nullptr, uint32_t column_family = 0,
+             const std::string& column_family_name = std::string());
 
   VersionSet(const VersionSet&) = delete;
   VersionSet& operator=(const VersionSet&) = delete;
@@ -131,19 +164,27 @@ class VersionSet {
 
   Status LogAndApply(VersionEdit* edit, Mutex* mu) EXCLUSIVE_LOCKS_REQUIRED(mu);
 
+  // recover all the column families, called on the root set after the
+  // sets of the column families in the meta file are created.
   Status Recover();
 
-  uint64_t NextFileNumber() { return next_file_number_++; }
+  // list the column families except the default one in the meta file.
+  Status ListColumnFamilies(std::map<uint32_t, std::string>* families);
+
+  uint32_t ColumnFamily() const { return column_family_; }
+
+  uint64_t NextFileNumber() { return root_->next_file_number_++; }
 
-  uint64_t LastSequence() const { return last_sequence_; }
+  uint64_t LastSequence() const { return root_->last_sequence_; }
 
+  // the logs before it are not needed by this column family.
   uint64_t LogNumber() const { return log_number_; }
 
-  uint64_t MetaFileNumber() const { return meta_file_number_; }
+  uint64_t MetaFileNumber() const { return root_->meta_file_number_; }
 
   void MarkFileNumberUsed(uint64_t number) {
-    if (number >= next_file_number_) {
-      next_file_number_ = number + 1;
+    if (number >= root_->next_file_number_) {
+      root_->next_file_number_ = number + 1;
     }
   }
 
@@ -151,37 +192,92 @@ class VersionSet {
     assert(level >= 0 && level <= config::kNumLevels);
     return current_->files_[level].size();
   }
+  // the level that level-0 is compacted into in the current version.
+  int BaseLevel() const { return current_->base_level_; }
+
+  // the max total file size of "level" in the current version.
+  double LevelMaxSize(int level) const {
+    assert(level >= 0 && level < config::kNumLevels);
+    return current_->level_max_size_[level];
+  }
+
+  const std::vector<FileMeta*>& LevelFiles(int level) const {
+    assert(level >= 0 && level < config::kNumLevels);
+    return current_->files_[level];
+  }
+
+  // the file picked from "level" by the next size compaction,
+  // only used by the tests.
+  FileMeta* TEST_PickFileToCompact(int level) {
+    return PickFileToCompact(level);
+  }
+
   void SetLastSequence(uint64_t s) {
-    assert(s >= last_sequence_);
-    last_sequence_ = s;
+    assert(s >= root_->last_sequence_);
+    root_->last_sequence_ = s;
   }
 
   void AddLiveFiles(std::set<uint64_t>* live);
 
   Compaction* PickCompaction();
 
+  // rebuild the compaction recorded in progress, return nullptr if
+  // its input files are not in the current version.
+  Compaction* ResumeCompaction(const CompactionProgress& progress);
+
   Iterator* MakeMergedIterator(Compaction* c);
 
   bool NeedCompaction() {
     Version* v = current_;
-    return (v->compaction_score >= 1) || (v->file_to_compact_ != nullptr);
+    return (v->compaction_score >= 1) || (v->file_to_compact_ != nullptr) ||
+           (v->deletion_file_to_compact_ != nullptr);
   }
 
  private:
   class Builder;
+  struct RecoverState;
 
   friend class Version;
   friend class Compaction;
 
+  static Status ApplyRecoveredEdit(void* arg, VersionEdit* edit);
+
+  // read the edits in the meta file.
+  Status ReadMetaFile(void* arg, Status (*handle)(void*, VersionEdit*));
+
+  // write an edit of any column family into the meta file, called on
+  // the root set.
+  Status WriteMetaRecord(VersionEdit* edit, Mutex* mu)
+      EXCLUSIVE_LOCKS_REQUIRED(mu);
+
+  // the edit of the current state of this column family
+  void SnapShotEdit(VersionEdit* edit);
+
   Status WriteSnapShot(log::Writer* writer);
 
   void AppendVersion(Version* v);
 
+  void CalculateLevelMaxSize(Version* v);
+
   void EvalCompactionScore(Version* v);
 
+  // size the filters of the levels of "v" by "policies_".
+  void UpdateFilterBits(Version* v);
+
+  void FindDeletionFileToCompact(Version* v);
+
   void GetRange(const std::vector<FileMeta*>& input, InternalKey* smallest,
                 InternalKey* largest);
 
+  FileMeta* PickFileToCompact(int level);
+
+  Compaction* PickIntraL0Compaction();
+
+  // add the level-0 files overlapping no other file in level-0 and the
+  // output level to a compaction of one such file, so that they are
+  // moved down together by one trivial move.
+  void AddDisjointLevel0Inputs(Compaction* c);
+
   void GetTwoRange(const std::vector<FileMeta*>& input1,
                    const std::vector<FileMeta*>& input2, InternalKey* smallest,
                    InternalKey* largest);
@@ -191,6 +287,7 @@ class VersionSet {
   const Option* option_;
   Env* env_;
   const InternalKeyComparator icmp_;
+  const InternalFilterPolicies* const policies_;
 
   TableCache* table_cache_;
   Version dummy_head_;
@@ -205,11 +302,17 @@ class VersionSet {
   log::Writer* meta_log_writer_;
 
   std::string compactor_pointer_[config::kNumLevels];
+
+  VersionSet* const root_;
+  const uint32_t column_family_;
+  const std::string column_family_name_;
+  // the sets of all the column families by id, only used in the root set
+  std::map<uint32_t, VersionSet*> families_;
 };
 
 class Compaction {
  public:
-  Compaction(const Option* option, int level);
+  Compaction(const Option* option, int level, int output_level);
 
   ~Compaction() {
     if (input_version_ != nullptr) {
@@ -217,20 +320,41 @@ class Compaction {
       input_version_ = nullptr;
     }
   }
-  bool SingalMove() const;
+  // the input files can be moved to the output level directly.
+  bool IsTrivialMove() const;
 
   int level() { return level_; }
 
+  int output_level() { return output_level_; }
+
+  bool deletion_compaction() const { return deletion_compaction_; }
+
   FileMeta* input(int which, int i) { return input_[which][i]; }
 
   VersionEdit* edit() { return &edit_; }
 
   size_t InputFilesNum(int which) { return input_[which].size(); }
 
-  bool StopBefore(std::string_view key);
+  // output_size is the size of the current output file
+  bool StopBefore(std::string_view key, uint64_t output_size);
+
+  // the total size of grandparents overlapped with [smallest, largest].
+  uint64_t GrandparentsOverlapBytes(const InternalKey& smallest,
+                                    const InternalKey& largest);
+
+  int boundary_cuts() const { return boundary_cuts_; }
+
+  // the grandparents bytes which would be overlapped by two outputs
+  // if the outputs were not cut at the boundaries.
+  uint64_t boundary_cut_saved_bytes() const {
+    return boundary_cut_saved_bytes_;
+  }
 
   bool IsBaseLevelForKey(std::string_view key);
 
+  // no file is in the levels below the output level.
+  bool IsBottommostLevel() const;
+
   uint64_t MaxOutputFileBytes() { return max_output_file_bytes_; }
 
   void ReleaseInput() {
@@ -260,15 +384,24 @@ class Compaction {
 
  private:
   int level_;
+  // level_ + 1, or the base level if level_ is level-0
+  int output_level_;
   uint64_t max_output_file_bytes_;
   std::vector<FileMeta*> input_[2];
-  std::vector<FileMeta*> grandparents_;  // level_ + 1
+  std::vector<FileMeta*> grandparents_;  // output_level_ + 1
   Version* input_version_;
   VersionEdit edit_;
 
   uint64_t grandparents_overlap_;
   size_t grandparents_index_;
   bool seen_key_;
+
+  // compact the file with too many deletion records,
+  // it must be rewritten to drop the deletions.
+  bool deletion_compaction_;
+
+  int boundary_cuts_;
+  uint64_t boundary_cut_saved_bytes_;
 };
 
 }  // namespace lsmkv
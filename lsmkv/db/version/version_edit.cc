@@ -13,9 +13,32 @@ enum Tag {
   KNewFiles = 5,
   KDeleteFiles = 6,
   KCompactionPointers = 7,
+  // new files with records statistics
+  KNewFilesWithStats = 8,
+  KColumnFamily = 9,
+  KColumnFamilyAdd = 10,
 };
 
+static void PutFileMeta(std::string* dst, const FileMeta& meta) {
+  PutVarint64(dst, meta.number);
+  PutVarint64(dst, meta.file_size);
+  PutLengthPrefixedSlice(dst, meta.smallest.Encode());
+  PutLengthPrefixedSlice(dst, meta.largest.Encode());
+  PutVarint64(dst, meta.num_entries);
+  PutVarint64(dst, meta.num_deletions);
+  PutVarint32(dst, meta.marked_for_compaction ? 1 : 0);
+}
+
 void VersionEdit::EncodeTo(std::string* dst) {
+  // the edits of the default column family keep the old format.
+  if (column_family_ != 0) {
+    PutVarint32(dst, KColumnFamily);
+    PutVarint32(dst, column_family_);
+  }
+  if (has_column_family_name_) {
+    PutVarint32(dst, KColumnFamilyAdd);
+    PutLengthPrefixedSlice(dst, column_family_name_);
+  }
   if (has_log_number_) {
     PutVarint32(dst, KLogNumber);
     PutVarint64(dst, log_number_);
@@ -34,12 +57,9 @@ void VersionEdit::EncodeTo(std::string* dst) {
   }
   for (size_t i = 0; i < new_files_.size(); i++) {
     const FileMeta& meta = new_files_[i].second;
-    PutVarint32(dst, KNewFiles);
+    PutVarint32(dst, KNewFilesWithStats);
     PutVarint32(dst, new_files_[i].first);
-    PutVarint64(dst, meta.number);
-    PutVarint64(dst, meta.file_size);
-    PutLengthPrefixedSlice(dst, meta.smallest.Encode());
-    PutLengthPrefixedSlice(dst, meta.largest.Encode());
+    PutFileMeta(dst, meta);
   }
   for (const auto& delete_file : delete_files_) {
     PutVarint32(dst, KDeleteFiles);
@@ -71,10 +91,26 @@ bool GetInternalKey(std::string_view* input, InternalKey* key) {
   return false;
 }
 
+static bool GetFileMeta(std::string_view* input, FileMeta* meta) {
+  uint32_t marked;
+  if (!GetVarint64(input, &meta->number) ||
+      !GetVarint64(input, &meta->file_size) ||
+      !GetInternalKey(input, &meta->smallest) ||
+      !GetInternalKey(input, &meta->largest) ||
+      !GetVarint64(input, &meta->num_entries) ||
+      !GetVarint64(input, &meta->num_deletions) ||
+      !GetVarint32(input, &marked)) {
+    return false;
+  }
+  meta->marked_for_compaction = (marked != 0);
+  return true;
+}
+
 Status VersionEdit::DecodeFrom(std::string_view src) {
   std::string_view input = src;
   int level;
   uint32_t tag;
+  uint32_t id;
   uint64_t number;
   std::string_view str;
   FileMeta meta;
@@ -122,6 +158,14 @@ Status VersionEdit::DecodeFrom(std::string_view src) {
         }
         new_files_.emplace_back(level, meta);
         break;
+      case KNewFilesWithStats:
+        if (!GetLevel(&input, &level) || !GetFileMeta(&input, &meta)) {
+          return Status::Corruption(
+              "VersionEdit DecodeFrom: new_files_with_stats");
+        }
+        new_files_.emplace_back(level, meta);
+        meta = FileMeta();
+        break;
       case KDeleteFiles:
         if (!GetLevel(&input, &level) || !GetVarint64(&input, &number)) {
           return Status::Corruption("VersionEdit DecodeFrom: delete_files");
@@ -135,6 +179,19 @@ Status VersionEdit::DecodeFrom(std::string_view src) {
         }
         compaction_pointers_.emplace_back(level, key);
         break;
+      case KColumnFamily:
+        if (!GetVarint32(&input, &id)) {
+          return Status::Corruption("VersionEdit DecodeFrom: column_family");
+        }
+        column_family_ = id;
+        break;
+      case KColumnFamilyAdd:
+        if (!GetLengthPrefixedSlice(&input, &str)) {
+          return Status::Corruption("VersionEdit DecodeFrom: column_family_add");
+        }
+        column_family_name_ = str;
+        has_column_family_name_ = true;
+        break;
       default:
         return Status::Corruption("VersionEdit DecodeFrom: unknown tag");
     }
@@ -142,4 +199,59 @@ Status VersionEdit::DecodeFrom(std::string_view src) {
   return Status::OK();
 }
 
+void CompactionProgress::EncodeTo(std::string* dst) const {
+  PutVarint32(dst, level);
+  PutVarint32(dst, output_level);
+  for (int which = 0; which < 2; which++) {
+    PutVarint32(dst, inputs[which].size());
+    for (uint64_t number : inputs[which]) {
+      PutVarint64(dst, number);
+    }
+  }
+  PutVarint32(dst, outputs.size());
+  for (const FileMeta& meta : outputs) {
+    PutFileMeta(dst, meta);
+  }
+  PutVarint32(dst, column_family);
+}
+
+Status CompactionProgress::DecodeFrom(std::string_view src) {
+  std::string_view input = src;
+  uint32_t num;
+  if (!GetLevel(&input, &level) || !GetLevel(&input, &output_level)) {
+    return Status::Corruption("CompactionProgress DecodeFrom: level");
+  }
+  for (int which = 0; which < 2; which++) {
+    inputs[which].clear();
+    if (!GetVarint32(&input, &num)) {
+      return Status::Corruption("CompactionProgress DecodeFrom: inputs");
+    }
+    for (uint32_t i = 0; i < num; i++) {
+      uint64_t number;
+      if (!GetVarint64(&input, &number)) {
+        return Status::Corruption("CompactionProgress DecodeFrom: inputs");
+      }
+      inputs[which].push_back(number);
+    }
+  }
+  outputs.clear();
+  if (!GetVarint32(&input, &num)) {
+    return Status::Corruption("CompactionProgress DecodeFrom: outputs");
+  }
+  for (uint32_t i = 0; i < num; i++) {
+    FileMeta meta;
+    if (!GetFileMeta(&input, &meta)) {
+      return Status::Corruption("CompactionProgress DecodeFrom: outputs");
+    }
+    outputs.push_back(meta);
+  }
+  if (!GetVarint32(&input, &column_family)) {
+    return Status::Corruption("CompactionProgress DecodeFrom: column family");
+  }
+  if (!input.empty()) {
+    return Status::Corruption("CompactionProgress DecodeFrom: extra bytes");
+  }
+  return Status::OK();
+}
+
 };  // namespace lsmkv
\ No newline at end of file
@@ -10,13 +10,42 @@ namespace lsmkv {
 class VersionSet;
 
 struct FileMeta {
-  FileMeta() : refs(0), file_size(0), allow_seeks(1 << 30) {}
+  FileMeta()
+      : refs(0),
+        file_size(0),
+        allow_seeks(1 << 30),
+        num_entries(0),
+        num_deletions(0),
+        marked_for_compaction(false) {}
   int refs;
   uint64_t number;
   uint64_t file_size;
   InternalKey smallest;
   InternalKey largest;
   int allow_seeks;
+  // records statistics, used to find the files full of deletions.
+  uint64_t num_entries;
+  uint64_t num_deletions;
+  // setted by SSTableBuilder when a dense range of deletions is found.
+  bool marked_for_compaction;
+};
+
+// the progress of a running compaction, persisted to resume the
+// compaction after a restart instead of redoing the finished outputs.
+struct CompactionProgress {
+  CompactionProgress() : column_family(0), level(0), output_level(0) {}
+
+  void EncodeTo(std::string* dst) const;
+
+  Status DecodeFrom(std::string_view src);
+
+  uint32_t column_family;
+  int level;
+  int output_level;
+  std::vector<uint64_t> inputs[2];
+  // the finished output files, the largest key of the last one is
+  // the position where the compaction resumes.
+  std::vector<FileMeta> outputs;
 };
 
 class VersionEdit {
@@ -28,7 +57,9 @@ class VersionEdit {
         has_log_number_(false),
         has_last_sequence_(false),
         has_next_file_number_(false),
-        has_comparator_name_(false) {
+        has_comparator_name_(false),
+        column_family_(0),
+        has_column_family_name_(false) {
     new_files_.clear();
     delete_files_.clear();
     compaction_pointers_.clear();
@@ -50,6 +81,15 @@ class VersionEdit {
     has_comparator_name_ = true;
     comparator_name_ = name;
   }
+  // the column family that the edit is applied to, 0 by default.
+  void SetColumnFamily(uint32_t column_family) {
+    column_family_ = column_family;
+  }
+  // the edit creates the column family with "name".
+  void AddColumnFamily(std::string_view name) {
+    has_column_family_name_ = true;
+    column_family_name_ = name;
+  }
   void AddFile(int level, uint64_t number, uint64_t file_size,
                const InternalKey& smallest, const InternalKey& largest) {
     FileMeta meta;
@@ -59,6 +99,11 @@ class VersionEdit {
     meta.largest = largest;
     new_files_.emplace_back(level, meta);
   }
+  void AddFile(int level, const FileMeta& meta) {
+    FileMeta new_meta = meta;
+    new_meta.refs = 0;
+    new_files_.emplace_back(level, new_meta);
+  }
   void DeleteFile(int level, uint64_t file_number) {
     delete_files_.emplace(level, file_number);
   }
@@ -84,6 +129,9 @@ class VersionEdit {
   bool has_last_sequence_;
   bool has_next_file_number_;
   bool has_comparator_name_;
+  uint32_t column_family_;
+  std::string column_family_name_;
+  bool has_column_family_name_;
 };
 
 };  // namespace lsmkv
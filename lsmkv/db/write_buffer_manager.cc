@@ -0,0 +1,124 @@
+#include "include/write_buffer_manager.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+namespace lsmkv {
+
+// the memory charged to cache by each dummy entry
+static constexpr size_t KDummyEntrySize = 256 * 1024;
+
+static void DeleteDummyEntry(std::string_view key, void* value) {}
+
+WriteBufferManager::WriteBufferManager(size_t buffer_size, Cache* cache)
+    : buffer_size_(buffer_size), cache_(cache), memory_usage_(0) {}
+
+WriteBufferManager::~WriteBufferManager() {
+  for (Cache::Handle* handle : dummy_handles_) {
+    cache_->Release(handle);
+  }
+}
+
+void WriteBufferManager::Register(const void* db,
+                                  void (*request_switch)(const void*)) {
+  MutexLock l(&mu_);
+  Usage usage;
+  usage.request_switch = request_switch;
+  usages_.emplace(db, usage);
+}
+
+void WriteBufferManager::Unregister(const void* db) {
+  MutexLock l(&mu_);
+  auto it = usages_.find(db);
+  if (it != usages_.end()) {
+    memory_usage_.fetch_sub(it->second.total_usage, std::memory_order_relaxed);
+    usages_.erase(it);
+    UpdateCacheCharge();
+  }
+}
+
+void WriteBufferManager::UpdateUsage(const void* db, size_t mutable_usage,
+                                     size_t total_usage) {
+  MutexLock l(&mu_);
+  auto it = usages_.find(db);
+  if (it == usages_.end()) {
+    return;
+  }
+  Usage& usage = it->second;
+  memory_usage_.fetch_add(total_usage, std::memory_order_relaxed);
+  memory_usage_.fetch_sub(usage.total_usage, std::memory_order_relaxed);
+  usage.mutable_usage = mutable_usage;
+  usage.total_usage = total_usage;
+  UpdateCacheCharge();
+  if (MemoryUsage() > buffer_size_) {
+    RequestSwitches();
+  }
+}
+
+bool WriteBufferManager::ShouldSwitch(const void* db) {
+  MutexLock l(&mu_);
+  auto it = usages_.find(db);
+  if (it == usages_.end() || !it->second.switch_requested) {
+    return false;
+  }
+  it->second.switch_requested = false;
+  return true;
+}
+
+void WriteBufferManager::RequestSwitches() {
+  mu_.AssertHeld();
+  // the memory freed by the requested switches
+  size_t freeing = 0;
+  std::vector<std::pair<const void*, Usage*>> candidates;
+  for (auto& kv : usages_) {
+    if (kv.second.switch_requested) {
+      freeing += kv.second.mutable_usage;
+    } else if (kv.second.mutable_usage > 0) {
+      candidates.emplace_back(kv.first, &kv.second);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const std::pair<const void*, Usage*>& a,
+               const std::pair<const void*, Usage*>& b) {
+              return a.second->mutable_usage > b.second->mutable_usage;
+            });
+  for (auto& candidate : candidates) {
+    if (MemoryUsage() - freeing <= buffer_size_) {
+      break;
+    }
+    Usage* usage = candidate.second;
+    usage->switch_requested = true;
+    freeing += usage->mutable_usage;
+    if (usage->request_switch != nullptr) {
+      usage->request_switch(candidate.first);
+    }
+  }
+}
+
+void WriteBufferManager::UpdateCacheCharge() {
+  mu_.AssertHeld();
+  if (cache_ == nullptr) {
+    return;
+  }
+  const size_t need =
+      (MemoryUsage() + KDummyEntrySize - 1) / KDummyEntrySize;
+  while (dummy_handles_.size() < need) {
+    std::string key = "WriteBufferManager." +
+                      std::to_string(reinterpret_cast<uintptr_t>(this)) +
+                      "." + std::to_string(dummy_handles_.size());
+    dummy_handles_.push_back(
+        cache_->Insert(key, nullptr, KDummyEntrySize, &DeleteDummyEntry));
+  }
+  // keep a dummy entry of slack to avoid charging back and forth.
+  while (dummy_handles_.size() > need + 1) {
+    std::string key = "WriteBufferManager." +
+                      std::to_string(reinterpret_cast<uintptr_t>(this)) +
+                      "." + std::to_string(dummy_handles_.size() - 1);
+    cache_->Release(dummy_handles_.back());
+    cache_->Erase(key);
+    dummy_handles_.pop_back();
+  }
+}
+
+}  // namespace lsmkv
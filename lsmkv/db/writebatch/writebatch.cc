@@ -1,19 +1,41 @@
 #include "db/writebatch/writebatch_helper.h"
 
+#include "include/column_family.h"
+
 namespace lsmkv {
 
+// the record types of the column families except the default one,
+// followed by the column family id.
+enum ColumnFamilyRecordType {
+    KTypeColumnFamilyDeletion = 0x4,
+    KTypeColumnFamilyInsertion = 0x5,
+};
+
+Status WriteBatch::Handle::PutCF(uint32_t column_family, std::string_view key,
+                                 std::string_view value) {
+    return Status::InvalidArgument("column family is not supported");
+}
+
+Status WriteBatch::Handle::DeleteCF(uint32_t column_family, std::string_view key) {
+    return Status::InvalidArgument("column family is not supported");
+}
+
 void WriteBatchHelper::Append(WriteBatch *dst , const WriteBatch *src) {
     SetCount(dst, GetCount(dst) + GetCount(src));
+    dst->has_column_family_ |= src->has_column_family_;
     dst->rep_.append(src->rep_.data() + KHeaderSize, src->rep_.size() - KHeaderSize);
 }
 void WriteBatch::Clear() {
     rep_.clear();
     rep_.resize(KHeaderSize);
+    has_column_family_ = false;
 }
 
 void WriteBatchHelper::SetContent(WriteBatch *b, std::string_view content) {
     assert(content.size() > KHeaderSize);
     b->rep_.assign(content.data(), content.size());
+    // the content may have the records of any column family
+    b->has_column_family_ = true;
 }
 
 std::string_view WriteBatchHelper::GetContent(WriteBatch *b) {
@@ -34,6 +56,32 @@ void WriteBatch::Delete(std::string_view key) {
     PutLengthPrefixedSlice(&rep_,key);
 }
 
+void WriteBatch::Put(ColumnFamilyHandle* column_family, std::string_view key,
+                     std::string_view value) {
+    if (column_family == nullptr || column_family->GetID() == 0) {
+        Put(key, value);
+        return;
+    }
+    WriteBatchHelper::SetCount(this, WriteBatchHelper::GetCount(this) + 1);
+    rep_.push_back(static_cast<char>(KTypeColumnFamilyInsertion));
+    PutVarint32(&rep_, column_family->GetID());
+    PutLengthPrefixedSlice(&rep_,key);
+    PutLengthPrefixedSlice(&rep_,value);
+    has_column_family_ = true;
+}
+
+void WriteBatch::Delete(ColumnFamilyHandle* column_family, std::string_view key) {
+    if (column_family == nullptr || column_family->GetID() == 0) {
+        Delete(key);
+        return;
+    }
+    WriteBatchHelper::SetCount(this, WriteBatchHelper::GetCount(this) + 1);
+    rep_.push_back(static_cast<char>(KTypeColumnFamilyDeletion));
+    PutVarint32(&rep_, column_family->GetID());
+    PutLengthPrefixedSlice(&rep_,key);
+    has_column_family_ = true;
+}
+
 Status WriteBatch::Iterate(Handle* handle) const {
     std::string_view input(rep_);
     if (input.size() < KHeaderSize) {
@@ -41,11 +89,13 @@ Status WriteBatch::Iterate(Handle* handle) const {
     }
     input.remove_prefix(KHeaderSize);
     std::string_view key, value;
+    uint32_t column_family;
+    Status s;
     int count = 0;
 
     while(!input.empty()) {
         count++;
-        RecordType type = static_cast<RecordType>(input[0]);
+        const int type = static_cast<unsigned char>(input[0]);
         input.remove_prefix(1);
         switch (type)
         {
@@ -64,6 +114,28 @@ Status WriteBatch::Iterate(Handle* handle) const {
                 return Status::Corruption("writebatch delete record bad");
             }
             break;
+        case KTypeColumnFamilyInsertion:
+            if (GetVarint32(&input, &column_family) &&
+                GetLengthPrefixedSlice(&input, &key) &&
+                GetLengthPrefixedSlice(&input, &value)) {
+                s = handle->PutCF(column_family, key, value);
+            } else {
+                return Status::Corruption("writebatch column family insert record bad");
+            }
+            break;
+        case KTypeColumnFamilyDeletion:
+            if (GetVarint32(&input, &column_family) &&
+                GetLengthPrefixedSlice(&input, &key)) {
+                s = handle->DeleteCF(column_family, key);
+            } else {
+                return Status::Corruption("writebatch column family delete record bad");
+            }
+            break;
+        default:
+            return Status::Corruption("writebatch unknown record type");
+        }
+        if (!s.ok()) {
+            return s;
         }
     }
     if (count != WriteBatchHelper::GetCount(this)) {
@@ -74,10 +146,35 @@ Status WriteBatch::Iterate(Handle* handle) const {
 }
 
 Status WriteBatchHelper::InsertMemTable(const WriteBatch* b, MemTable* mem) {
+    return InsertMemTables(b, std::vector<MemTable*>{mem});
+}
+
+Status WriteBatchHelper::InsertMemTables(const WriteBatch* b,
+                                         const std::vector<MemTable*>& mems) {
     MemTableInserter inserter;
     inserter.seq_ = WriteBatchHelper::GetSequenceNum(b);
-    inserter.mem_ = mem;
+    inserter.mems_ = &mems;
+    inserter.hints_.assign(mems.size(), nullptr);
+    // a single record gains nothing from the hint.
+    inserter.use_hint_ = (WriteBatchHelper::GetCount(b) > 1);
     return b->Iterate(&inserter);
 }
 
+Status ColumnFamilyChecker::PutCF(uint32_t column_family, std::string_view key,
+                                  std::string_view value) {
+    return Check(column_family);
+}
+
+Status ColumnFamilyChecker::DeleteCF(uint32_t column_family, std::string_view key) {
+    return Check(column_family);
+}
+
+Status ColumnFamilyChecker::Check(uint32_t column_family) {
+    if (column_family >= column_family_num_) {
+        return Status::InvalidArgument("writebatch has an invalid column family");
+    }
+    Collect(column_family);
+    return Status::OK();
+}
+
 }
\ No newline at end of file
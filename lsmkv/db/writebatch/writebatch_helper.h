@@ -1,6 +1,9 @@
 #ifndef STORAGE_XDB_DB_WRITEBATCH_WRITEBATCH_HELPER_H_
 #define STORAGE_XDB_DB_WRITEBATCH_WRITEBATCH_HELPER_H_
 
+#include <set>
+#include <vector>
+
 #include "include/writebatch.h"
 #include "db/memtable/memtable.h"
 
@@ -26,22 +29,81 @@ class WriteBatchHelper {
 
     static size_t GetSize(const WriteBatch *b) { return b->rep_.size(); }
 
+    static bool HasColumnFamily(const WriteBatch *b) { return b->has_column_family_; }
+
     static Status InsertMemTable(const WriteBatch* b, MemTable* mem);
+
+    // mems[i] is the memtable of the column family i,
+    // the records of a column family are skipped if its memtable is nullptr.
+    static Status InsertMemTables(const WriteBatch* b, const std::vector<MemTable*>& mems);
 };
 
 class MemTableInserter : public WriteBatch::Handle {
  public:
     SequenceNum seq_;
-    MemTable* mem_;
+    const std::vector<MemTable*>* mems_;
+    // caches the insert positions across the records of a batch,
+    // one for each memtable.
+    std::vector<void*> hints_;
+    bool use_hint_;
     void Put(std::string_view key, std::string_view value) override {
-        mem_->Put(seq_, KTypeInsertion, key, value);
-        seq_++;
+        PutCF(0, key, value);
     }
     void Delete(std::string_view key) override {
-        mem_->Put(seq_, KTypeDeletion, key, "");
+        DeleteCF(0, key);
+    }
+    Status PutCF(uint32_t column_family, std::string_view key,
+                 std::string_view value) override {
+        return Insert(column_family, KTypeInsertion, key, value);
+    }
+    Status DeleteCF(uint32_t column_family, std::string_view key) override {
+        return Insert(column_family, KTypeDeletion, key, "");
+    }
+
+ private:
+    Status Insert(uint32_t column_family, RecordType type, std::string_view key,
+                  std::string_view value) {
+        if (column_family >= mems_->size()) {
+            return Status::InvalidArgument("writebatch has an invalid column family");
+        }
+        MemTable* mem = (*mems_)[column_family];
+        if (mem != nullptr) {
+            mem->Put(seq_, type, key, value,
+                     use_hint_ ? &hints_[column_family] : nullptr);
+        }
+        // the sequence is consumed even if the record is skipped.
         seq_++;
+        return Status::OK();
+    }
+};
+
+// check the column families of the records in a WriteBatch, and collect
+// them into "column_families" if it is not nullptr.
+class ColumnFamilyChecker : public WriteBatch::Handle {
+ public:
+    explicit ColumnFamilyChecker(uint32_t column_family_num,
+                                 std::set<uint32_t>* column_families = nullptr)
+        : column_family_num_(column_family_num),
+          column_families_(column_families) {}
+    void Put(std::string_view key, std::string_view value) override {
+        Collect(0);
+    }
+    void Delete(std::string_view key) override { Collect(0); }
+    Status PutCF(uint32_t column_family, std::string_view key,
+                 std::string_view value) override;
+    Status DeleteCF(uint32_t column_family, std::string_view key) override;
+
+ private:
+    Status Check(uint32_t column_family);
+
+    void Collect(uint32_t column_family) {
+        if (column_families_ != nullptr) {
+            column_families_->insert(column_family);
+        }
     }
 
+    const uint32_t column_family_num_;
+    std::set<uint32_t>* const column_families_;
 };
 }
 
@@ -1,6 +1,8 @@
 #ifndef STORAGE_XDB_DB_INCLUDE_CACHE_H_
 #define STORAGE_XDB_DB_INCLUDE_CACHE_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 
 namespace lsmkv {
@@ -16,6 +18,10 @@ class Cache {
     // handle is used to handle an entry stored in cache
     struct Handle {};
 
+    // the low priority records are evicted first, the high priority ones
+    // are evicted only if they exceed the high priority pool.
+    enum Priority { KHighPriority, KLowPriority };
+
     // If cache include a record with "key", return it;
     // the handle must be "Release()" after used;
     virtual Handle* Lookup(std::string_view key) = 0;
@@ -37,9 +43,25 @@ class Cache {
     // the handle must be "Release()" after used.
     virtual Handle* Insert(std::string_view key, void* value,
             size_t charge, void (*deleter)(std::string_view key, void* value)) = 0;
+
+    // insert an record with "priority".
+    virtual Handle* Insert(std::string_view key, void* value, size_t charge,
+            void (*deleter)(std::string_view key, void* value),
+            Priority priority) {
+        return Insert(key, value, charge, deleter);
+    }
+
+    // the total charge of the records in cache
+    virtual size_t TotalCharge() = 0;
+
+    // the number of Lookup() that found the key or not.
+    virtual uint64_t HitCount() { return 0; }
+    virtual uint64_t MissCount() { return 0; }
 };
 
-Cache* NewLRUCache(size_t capacity);
+// a cache of "capacity" charge, of which "high_priority_ratio" is
+// reserved for the high priority records.
+Cache* NewLRUCache(size_t capacity, double high_priority_ratio = 0);
 
 }
 
@@ -0,0 +1,39 @@
+#ifndef STORAGE_XDB_INCLUDE_COLUMN_FAMILY_H_
+#define STORAGE_XDB_INCLUDE_COLUMN_FAMILY_H_
+
+#include <cstdint>
+#include <string>
+
+#include "include/option.h"
+
+namespace lsmkv {
+
+// the name of the column family every DB has
+extern const char* const KDefaultColumnFamilyName;
+
+// a column family is a keyspace with its own option, memtable and levels
+// in a DB. the column families share the log and the meta file of the
+// DB, so a WriteBatch can update several of them atomically.
+// the handles are owned by the DB, valid until the DB is deleted.
+class ColumnFamilyHandle {
+ public:
+  virtual ~ColumnFamilyHandle() = default;
+
+  virtual uint32_t GetID() const = 0;
+
+  virtual const std::string& GetName() const = 0;
+};
+
+struct ColumnFamilyDescriptor {
+  ColumnFamilyDescriptor(const std::string& name, const Option& option)
+      : name(name), option(option) {}
+
+  std::string name;
+  // "env", "logger", "table_cache" and "write_buffer_manager" are
+  // shared by the DB, the ones here are ignored.
+  Option option;
+};
+
+}  // namespace lsmkv
+
+#endif  // STORAGE_XDB_INCLUDE_COLUMN_FAMILY_H_
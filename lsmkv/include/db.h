@@ -1,6 +1,9 @@
 #ifndef STORAGE_XDB_INCLUDE_DB_H_
 #define STORAGE_XDB_INCLUDE_DB_H_
 
+#include <vector>
+
+#include "include/column_family.h"
 #include "include/status.h"
 #include "include/writebatch.h"
 #include "include/option.h"
@@ -12,6 +15,13 @@ class DB {
 
     static Status Open(const Option& option, const std::string& name, DB** ptr);
 
+    // Open the DB with column families. "option" is the option of the default
+    // column family, every existing column family must be in "families".
+    // the families not existing are created. the i-th handle is for families[i].
+    static Status Open(const Option& option, const std::string& name,
+            const std::vector<ColumnFamilyDescriptor>& families,
+            std::vector<ColumnFamilyHandle*>* handles, DB** ptr);
+
     virtual Status Get(const ReadOption& option,std::string_view key, std::string* value) = 0;
 
     virtual Status Put(const WriteOption& option, std::string_view key, std::string_view value) = 0;
@@ -19,6 +29,25 @@ class DB {
     virtual Status Delete(const WriteOption& option,std::string_view key) = 0;
 
     virtual Status Write(const WriteOption& option,WriteBatch* batch) = 0;
+
+    // Get the values of several keys, the i-th status and value are for keys[i].
+    virtual std::vector<Status> MultiGet(const ReadOption& option,
+            const std::vector<std::string_view>& keys, std::vector<std::string>* values);
+
+    // the column family interfaces, not supported by default.
+    virtual Status CreateColumnFamily(const Option& option, const std::string& name,
+            ColumnFamilyHandle** handle);
+
+    virtual ColumnFamilyHandle* DefaultColumnFamily() const { return nullptr; }
+
+    virtual Status Get(const ReadOption& option, ColumnFamilyHandle* column_family,
+            std::string_view key, std::string* value);
+
+    virtual Status Put(const WriteOption& option, ColumnFamilyHandle* column_family,
+            std::string_view key, std::string_view value);
+
+    virtual Status Delete(const WriteOption& option, ColumnFamilyHandle* column_family,
+            std::string_view key);
 };
 
 Status DestoryDB(const Option& option, const std::string& name);
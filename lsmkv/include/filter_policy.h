@@ -24,6 +24,19 @@ class FilterPolicy {
   virtual bool KeyMayMatch(std::string_view key, std::string_view filter) const = 0;
 };
 
-FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
+// if "cache_local" is true, all the probes of a key fall in one cache
+// line, so a lookup costs one cache miss at the price of a slightly
+// higher false positive rate. the filters of both kinds are read by
+// either policy, as they share the name.
+FilterPolicy* NewBloomFilterPolicy(int bits_per_key, bool cache_local = false);
+
+// a binary fuse filter, which builds several times slower than a bloom
+// filter. the fingerprint has about "bits_per_key" / 1.125 bits (at
+// most 16), and the false positive rate is 2^-fingerprint_bits. it
+// needs up to about 20% less memory than a bloom filter of the same false
+// positive rate for the full or partitioned filters of thousands of
+// keys, but not for the filters of a few hundred keys, like those of
+// every 2KB of data blocks, which are built as such a bloom filter.
+FilterPolicy* NewBinaryFuseFilterPolicy(int bits_per_key);
 }  // namespace lsmkv
 #endif  // STORAGE_XDB_INCLUDE_FILTER_POLICY_H_
\ No newline at end of file
@@ -1,16 +1,51 @@
 #ifndef STORAGE_XDB_INCLUDE_OPTION_H_
 #define STORAGE_XDB_INCLUDE_OPTION_H_
 
+#include <vector>
+
 #include "include/env.h"
 namespace lsmkv {
 
+class Cache;
 class Comparator;
 class Env;
 class FilterPolicy;
+class PrefixExtractor;
+class WriteBufferManager;
 
 enum CompressType {
     KUnCompress = 0,
-    KSnappyCompress = 1
+    KSnappyCompress = 1,
+    // lz4 and zstd are only available if the library is found when
+    // building, otherwise DB::Open returns InvalidArgument.
+    KLZ4Compress = 2,
+    KZSTDCompress = 3
+};
+
+// the way to pick the input file of a size compaction in level-N (N > 0).
+enum CompactionPriority {
+    // pick the files in turn, start after the last compaction's range.
+    KByCompactionPointer = 0,
+    // pick the file whose overlapping bytes in level-(N+1) is
+    // smallest relative to its own size. minimize the write amplification.
+    KMinOverlappingRatio = 1,
+    // pick the file which is created earliest (smallest file number).
+    KOldestFileFirst = 2
+};
+
+// the in-memory structure of the memtable.
+enum MemTableRepType {
+    // a skiplist of all records, suited to most workloads.
+    KSkipListRep = 0,
+    // the records are hashed into buckets by the prefix of user key,
+    // each bucket is a skiplist. a point lookup only searches a small
+    // bucket, but a full scan has to sort the records of all buckets.
+    KHashSkipListRep = 1,
+    // the records are appended to a vector, and sorted only when the
+    // memtable is read. suited to bulk loads, a read after writes sorts
+    // the new records and merges them, which is O(n) while blocking the
+    // writers, so the Gets mixed with writes are slow.
+    KVectorRep = 2
 };
 
 struct Option {
@@ -25,8 +60,54 @@ struct Option {
     // the disk.
     const FilterPolicy* filter_policy = nullptr;
 
+    // the filter policy of each level, the sstables of level i are
+    // written with level_filter_policy[i] if it is not nullptr, and with
+    // "filter_policy" otherwise. the sstables are read with whichever
+    // of these policies they were written with. the binary fuse filters
+    // only save memory with "full_filter" or "index_partition_size".
+    std::vector<const FilterPolicy*> level_filter_policy;
+
+    // if true, no filter is built for the sstables of the bottommost
+    // level, which holds most of the keys and is mostly reached by the
+    // Gets that find their keys there.
+    bool skip_bottommost_filter = false;
+
+    // if > 0, bloom filters sized from this average bits per key over
+    // all the levels replace "filter_policy" and "level_filter_policy".
+    // like Monkey, the false positive rate of a level is proportional to
+    // its size, so the upper levels get more bits. the bits follow the
+    // current sizes of the levels, and are sized again whenever they
+    // change.
+    double filter_bits_per_key_budget = 0;
+
+    // if true, one filter is built for all the keys of a sstable instead
+    // of a filter for each 2KB of data blocks, so a Get checks it before
+    // seeking the index. ignored if "index_partition_size" > 0.
+    bool full_filter = false;
+
     // Compress the sstable use the compression algorithm.
     CompressType compress_type = KSnappyCompress;
+
+    // the compression level of zstd, higher is smaller and slower.
+    int zstd_compression_level = 3;
+
+    // the compress type of the sstables in level-N is
+    // level_compress_type[N], levels out of range use "compress_type".
+    // such as a fast lz4 for the upper levels and zstd for the last.
+    std::vector<CompressType> level_compress_type;
+
+    // if > 0, a zstd dictionary of at most "zstd_max_dict_bytes" is
+    // trained for each sstable written to the bottommost level by zstd,
+    // and shared by its data blocks. the dictionary is trained from the
+    // data blocks of the first "zstd_max_train_bytes" of the sstable,
+    // which are buffered in memory, 0 means 100 * "zstd_max_dict_bytes".
+    size_t zstd_max_dict_bytes = 0;
+    size_t zstd_max_train_bytes = 0;
+
+    // if > 1, the data blocks of a sstable are compressed and checksummed
+    // by "parallel_threads" threads, while the thread building the
+    // sstable writes the finished blocks in order.
+    int parallel_threads = 1;
     
     // include the methods that interact with the os.
     // such as start thread, open file, lock file, etc.
@@ -44,6 +125,26 @@ struct Option {
     // default : 4KB
     size_t block_size = 4 * 1024;
 
+    // the block size of the sstables in level-N is level_block_size[N],
+    // levels out of range use "block_size".
+    std::vector<size_t> level_block_size;
+
+    // if true, a hash index from the user keys to the restarts is
+    // appended to each data block, so that a Get finds the restart of
+    // the key without binary search, or rules the key out.
+    bool data_block_hash_index = false;
+
+    // the number of keys per bucket in the hash index of data block,
+    // a lower ratio has less collisions but more space.
+    double data_block_hash_util_ratio = 0.75;
+
+    // if > 0, the index block and the filter of a sstable are split into
+    // partitions of about this size, which are found by a small top
+    // level index and loaded on demand. 0 means not partitioned.
+    // the partitions are cached in "metadata_cache", or in an 8MB cache
+    // of the DB if it is not set.
+    size_t index_partition_size = 0;
+
     // if true, while check the block of sstable is whether complete.
     // when one record is break, it may cause all the block is unseenable. 
     bool check_crc = false;
@@ -61,6 +162,127 @@ struct Option {
 
     // write up to this amount bytes to a file before switch
     uint64_t max_file_size = 2 * 1024 * 1024;
+
+    // level-0 compaction is started when level-0 has this
+    // number of files.
+    int l0_compaction_threshold = 4;
+
+    // writes are stopped when level-0 has this number of files,
+    // until the background compaction catches up.
+    int l0_stop_write_threshold = 12;
+
+    // the max total file size of level-1. level-N (N > 1) is
+    // level_size_multiplier times larger than level-(N-1).
+    // default : 10MB
+    uint64_t level_base_size = 10 * 1024 * 1024;
+
+    double level_size_multiplier = 10;
+
+    // if true, the max size of each level is derived backward from
+    // the actual size of the last level, so that about 90% of data
+    // is stored in the last level whatever the db size is.
+    // level-0 is compacted into the first level whose max size is
+    // not less than "level_base_size", the levels above it are empty.
+    bool dynamic_level_size = false;
+
+    // how to pick the input file of a size compaction.
+    CompactionPriority compaction_priority = KByCompactionPointer;
+
+    // if true, when level-0 should be compacted but the base level is
+    // also beyond its max size, merge the newest small level-0 files
+    // among themselves first instead of compacting them into the base level.
+    // this reduces the level-0 file num that reads and
+    // "l0_stop_write_threshold" depend on.
+    bool intra_l0_compaction = false;
+
+    // a file is compacted when its deletion records are more than
+    // this ratio of its records. 0 means disabled.
+    double deletion_compaction_ratio = 0;
+
+    // a file is compacted when any "deletion_compaction_window"
+    // consecutive records of it contain at least
+    // "deletion_compaction_trigger" deletion records.
+    // 0 means disabled.
+    int deletion_compaction_window = 0;
+    int deletion_compaction_trigger = 0;
+
+    // if true, the finished outputs of a compaction are recorded,
+    // a compaction interrupted by closing or crash is resumed after
+    // the DB is reopened instead of starting over. it applies to the
+    // compactions of all the column families.
+    bool resumable_compaction = false;
+
+    // a compaction output at least this size is cut at the next file
+    // boundary of the level below the output level, so that it overlaps
+    // fewer files and its future compaction rewrites less data.
+    // 0 means disabled.
+    uint64_t output_boundary_cut_size = 0;
+
+    // the in-memory structure of the memtable.
+    MemTableRepType memtable_rep = KSkipListRep;
+
+    // the records of KHashSkipListRep are hashed by this prefix of
+    // user key. if nullptr, hashed by the whole user key.
+    const PrefixExtractor* prefix_extractor = nullptr;
+
+    // the bucket number of KHashSkipListRep.
+    size_t memtable_hash_bucket_num = 16 * 1024;
+
+    // the size of the memtable's bloom filter, a ratio of
+    // "write_mem_size". a Get of the key not in the memtable can skip
+    // searching it. 0 means disabled.
+    double memtable_bloom_size_ratio = 0;
+
+    // if true and "prefix_extractor" is set, the memtable's bloom filter
+    // is built on the prefixes of user keys instead of the whole keys.
+    bool memtable_prefix_bloom = false;
+
+    // the memtable allocates memory by blocks of this size.
+    size_t arena_block_size = 4 * 1024;
+
+    // if true, the memtable's blocks are allocated by mmap and backed by
+    // huge pages: MAP_HUGETLB if huge pages are reserved, otherwise
+    // transparent huge pages. "arena_block_size" is rounded up to a
+    // multiple of the huge page size (2MB).
+    bool arena_huge_page = false;
+
+    // the blocks of the flushed memtables are kept in a process-wide
+    // pool and reused by new memtables. every open DB adds this to the
+    // max bytes of blocks kept in the pool until it is closed. 0 means
+    // not using the pool.
+    size_t arena_block_pool_size = 0;
+
+    // if not nullptr, the memtables of all the DB instances sharing it
+    // are limited by its buffer size. when the limit is exceeded, the
+    // instances with the largest memtables switch them at their next
+    // write, even if "write_mem_size" is not reached.
+    WriteBufferManager* write_buffer_manager = nullptr;
+
+    // if not nullptr, the opened tables are cached in it, which can be
+    // shared by several DB instances, and "max_open_file" is ignored.
+    // the cache must outlive the DB instances.
+    Cache* table_cache = nullptr;
+
+    // if not nullptr, the index and filter blocks of the tables are
+    // charged to it by their sizes and loaded on demand, instead of
+    // being kept in memory as long as the tables are open.
+    // the cache must outlive the DB instances.
+    Cache* metadata_cache = nullptr;
+
+    // the metadata of the tables at this level and the upper levels is
+    // inserted into "metadata_cache" with high priority, which is kept
+    // in the high priority pool of the cache. -1 means none.
+    int metadata_high_priority_level = 1;
+
+    // if not nullptr, the data blocks are kept in it as they are stored
+    // in the files, compressed, charged by their stored sizes, and looked
+    // up before the files are read. a hit saves the read, but not the
+    // decompression. the hits and misses are counted by the cache.
+    // the blocks are keyed by the id of the DB kept in its IDENTITY
+    // file, so they are found again after the DB is reopened, and
+    // erased when their files are deleted.
+    // the cache must outlive the DB instances.
+    Cache* compressed_block_cache = nullptr;
 };
 
 struct WriteOption {
@@ -73,6 +295,11 @@ struct ReadOption {
     // if true, the data are readed will be checked the completeness
     // when read from files.
     bool check_crc = false;
+
+    // if false, the data blocks read are not inserted into
+    // "Option::compressed_block_cache", for the bulk reads such as
+    // compaction, which would evict the blocks of the foreground reads.
+    bool fill_cache = true;
 };
 
 }
@@ -0,0 +1,24 @@
+#ifndef STORAGE_XDB_INCLUDE_PREFIX_EXTRACTOR_H_
+#define STORAGE_XDB_INCLUDE_PREFIX_EXTRACTOR_H_
+#include <cstddef>
+
+#include <string_view>
+namespace lsmkv {
+
+// extract the prefix of a user key. the keys with the same prefix
+// are grouped together, such as in the same hash bucket of memtable.
+class PrefixExtractor {
+ public:
+  virtual ~PrefixExtractor() = default;
+
+  virtual const char* Name() const = 0;
+
+  // return the prefix of key, it must be a prefix of key.
+  virtual std::string_view Transform(std::string_view key) const = 0;
+};
+
+// the prefix is the first "prefix_len" bytes of key,
+// or the whole key if it is shorter.
+PrefixExtractor* NewFixedPrefixExtractor(size_t prefix_len);
+}  // namespace lsmkv
+#endif  // STORAGE_XDB_INCLUDE_PREFIX_EXTRACTOR_H_
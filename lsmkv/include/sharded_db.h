@@ -0,0 +1,82 @@
+#ifndef STORAGE_XDB_INCLUDE_SHARDED_DB_H_
+#define STORAGE_XDB_INCLUDE_SHARDED_DB_H_
+
+#include <string>
+#include <vector>
+
+#include "include/db.h"
+
+namespace lsmkv {
+
+enum ShardingType {
+  // a key is in the shard chosen by its hash
+  KHashSharding,
+  // the shards hold the key ranges split by "ShardingOption::boundaries"
+  KRangeSharding,
+};
+
+struct ShardingOption {
+  ShardingType type = KHashSharding;
+
+  // the number of shards for hash sharding.
+  int shard_num = 4;
+
+  // the sorted split keys for range sharding, shard i holds the keys in
+  // [boundaries[i - 1], boundaries[i]), so there are boundaries.size() + 1
+  // shards.
+  std::vector<std::string> boundaries;
+};
+
+// a DB made of several DB instances, each with its own write queue, log
+// and memtable, so the writes to different shards are concurrent.
+// the shards share the background thread of the Env and a table cache.
+// a WriteBatch is atomic within each shard, not across the shards.
+// a DB must be always opened with the same ShardingOption.
+class ShardedDB : public DB {
+ public:
+  static Status Open(const Option& option, const ShardingOption& sharding,
+                     const std::string& name, DB** ptr);
+
+  ShardedDB(const ShardedDB&) = delete;
+  ShardedDB& operator=(const ShardedDB&) = delete;
+
+  ~ShardedDB() override;
+
+  using DB::Delete;
+  using DB::Get;
+  using DB::Put;
+
+  Status Get(const ReadOption& option, std::string_view key,
+             std::string* value) override;
+
+  Status Put(const WriteOption& option, std::string_view key,
+             std::string_view value) override;
+
+  Status Delete(const WriteOption& option, std::string_view key) override;
+
+  Status Write(const WriteOption& option, WriteBatch* batch) override;
+
+  // the keys are grouped by shards, the shards are looked up in parallel.
+  std::vector<Status> MultiGet(const ReadOption& option,
+                               const std::vector<std::string_view>& keys,
+                               std::vector<std::string>* values) override;
+
+  // return the index of the shard holding "key"
+  size_t ShardOf(std::string_view key) const;
+
+ private:
+  ShardedDB(const Option& option, const ShardingOption& sharding);
+
+  const Option option_;
+  const ShardingOption sharding_;
+  // shared by the shards
+  Cache* table_cache_;
+  std::vector<DB*> shards_;
+};
+
+Status DestoryShardedDB(const Option& option, const ShardingOption& sharding,
+                        const std::string& name);
+
+}  // namespace lsmkv
+
+#endif  // STORAGE_XDB_INCLUDE_SHARDED_DB_H_
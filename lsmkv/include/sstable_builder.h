@@ -14,7 +14,10 @@ class FileMeta;
 
 class SSTableBuilder {
  public:
-    SSTableBuilder(const Option& option,WritableFile* file);
+    // "level" is the level the sstable is written to, -1 if unknown.
+    // "bottommost" is true if the levels below it are empty.
+    SSTableBuilder(const Option& option, WritableFile* file, int level = -1,
+                   bool bottommost = false);
 
     SSTableBuilder(const SSTableBuilder&) = delete;
     SSTableBuilder& operator=(const SSTableBuilder&) = delete;
@@ -32,12 +35,52 @@ class SSTableBuilder {
     uint64_t FileSize() const;
 
     uint64_t NumEntries() const;
+
+    // the number of deletion records, only counted if the keys
+    // are internal keys.
+    uint64_t NumDeletions() const;
+
+    // Return true if a dense range of deletion records is found
+    // by the sliding window. see "Option::deletion_compaction_window".
+    bool NeedCompaction() const;
  private:
     bool ok() const { return status().ok(); }
     void WriteBlock(BlockBuilder* builder, BlockHandle* handle);
 
+    void UpdateDeletionStats(std::string_view key);
+
+    // train the zstd dictionary from the buffered records, then add
+    // them to the sstable.
+    void EnterUnbuffered();
+
+    // add the key to the filter of the data blocks, the filter partition
+    // or the full filter.
+    void AddFilterKey(std::string_view key);
+
+    // write the index partition and its filter partition if the
+    // partition is full or "force", see "Option::index_partition_size".
+    // "last_key" is the last index key of the partition.
+    void CutPartition(bool force, std::string_view last_key);
+
+    // write a filter of the keys collected for a filter partition or
+    // the full filter, and clear them.
+    void WriteFilterOfKeys(BlockHandle* handle);
+
     void WriteRawBlock(std::string_view contents,
              CompressType type, BlockHandle* handle);
+
+    void AppendBlock(std::string_view contents, const char* tail,
+             BlockHandle* handle);
+
+    // write the compressed blocks at the head of the parallel pipeline,
+    // then add their keys to the filters and their index entries.
+    // if "wait", all the blocks are written.
+    // see "Option::parallel_threads".
+    void WriteParallelBlocks(bool wait);
+
+    static void CompressThreadMain(void* arg);
+
+    struct ParallelBlock;
     struct Rep;
     Rep* rep_;
 };
@@ -1,10 +1,15 @@
 #ifndef STORAGE_XDB_INCLUDE_SSTABLE_READER_H_
 #define STORAGE_XDB_INCLUDE_SSTABLE_READER_H_
 
+#include "include/cache.h"
 #include "include/option.h"
 #include "util/file.h"
 namespace lsmkv {
 
+struct BlockContents;
+struct BlockHandle;
+class BlockReader;
+class FilterBlockReader;
 class Footer;
 class Iterator;
 
@@ -18,6 +23,13 @@ class SSTableReader {
     static Status Open(const Option& option, RandomReadFile* file,
         uint64_t file_size, SSTableReader** table);
 
+    // "db_id" and "file_number" identify the table, by which its data
+    // blocks are keyed in "option.compressed_block_cache". the tables
+    // opened without them do not use the cache.
+    static Status Open(const Option& option, RandomReadFile* file,
+        uint64_t file_size, uint64_t db_id, uint64_t file_number,
+        SSTableReader** table);
+
     Iterator* NewIterator(const ReadOption& option) const;
  private:
     struct Rep;
@@ -25,14 +37,85 @@ class SSTableReader {
 
     explicit SSTableReader(Rep* rep) : rep_(rep) {}
 
-    void ReadFilterIndex(const Footer& footer);
+    // read the filter and the compression dictionary of the meta index.
+    void ReadMetaIndex(const Footer& footer);
+
+    // load the zstd dictionary of the data blocks, see
+    // "Option::zstd_max_dict_bytes".
+    void ReadCompressionDict(Iterator* meta_iter);
+
+    // read the filter block, "*data" is set if it is owned by the filter.
+    // "*filter" is nullptr for the full filter, which is "*contents".
+    Status ReadFilter(FilterBlockReader** filter, std::string_view* contents,
+            const char** data) const;
+
+    // the index block and filter are kept by the table, or loaded on
+    // demand into "option.metadata_cache". "*handle" must be released
+    // by ReleaseMetadata after used.
+    Status GetIndexBlock(BlockReader** block, Cache::Handle** handle) const;
+
+    // remember a partition inserted into "option.metadata_cache",
+    // which is erased when the table is closed.
+    void AddPartition(const BlockHandle& handle) const;
+
+    // read an index block, or find it in "option.metadata_cache". the
+    // partitions are read on every use if the cache is not set.
+    // "*block" is owned by the caller if "*handle" is nullptr.
+    Status ReadIndexBlock(const BlockHandle& block_handle, BlockReader** block,
+            Cache::Handle** handle) const;
+
+    // check the key in a filter created by the policy directly,
+    // a partition of the partitioned filter or the full filter.
+    bool RawFilterMayMatch(const BlockHandle& filter_handle,
+            std::string_view key) const;
+
+    // return false if the key is surely not in the table by the full
+    // filter, always true for the tables without full filter.
+    bool KeyMayMatch(std::string_view key) const;
+
+    FilterBlockReader* GetFilter(Cache::Handle** handle) const;
 
-    void ReadFilter(std::string_view handle_contents);
+    void ReleaseMetadata(Cache::Handle* handle) const;
 
+    // the key of a metadata block in "option.metadata_cache"
+    void EncodeMetadataKey(const BlockHandle& handle, char* buf) const;
+
+    // the level of the table when it is read last time, which decides
+    // the priority of its metadata in cache.
+    void SetLevel(int level);
+
+    // the full filter is not checked, the caller checks KeyMayMatch
+    // first to skip the table without seeking its index.
     Status InternalGet(const ReadOption& option, std::string_view key, void* arg,
              void (*handle_result)(void*, std::string_view, std::string_view));
     
+    // read a data block, or uncompress it from
+    // "option.compressed_block_cache".
+    Status ReadDataBlock(const ReadOption& option, const BlockHandle& handle,
+            BlockContents* contents) const;
+
+    // the key of a data block in "option.compressed_block_cache"
+    void EncodeBlockKey(const BlockHandle& handle, char* buf) const;
+
+    // erase the data blocks from "option.compressed_block_cache" before
+    // the file is deleted.
+    void EraseCompressedBlocks() const;
+
+    // the iterator over the handles of the data blocks
+    Iterator* NewIndexIterator(const ReadOption& option) const;
+
+    // find the key in the data block of "handle_contents".
+    Status BlockGet(const ReadOption& option, std::string_view handle_contents,
+            std::string_view key, void* arg,
+            void (*handle_result)(void*, std::string_view, std::string_view));
+
+    Status PartitionedGet(const ReadOption& option, std::string_view key, void* arg,
+             void (*handle_result)(void*, std::string_view, std::string_view));
+
     static Iterator* ReadBlockHandle(void* arg, const ReadOption& option, std::string_view handle_contents);
+
+    static Iterator* ReadIndexPartition(void* arg, const ReadOption& option,
+            std::string_view handle_contents);
     
     Rep* const rep_;
 };
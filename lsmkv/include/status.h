@@ -29,18 +29,23 @@ class Status {
   static Status Corruption(std::string_view msg1, std::string_view msg2 = std::string_view()) {
     return Status(KCorruption, msg1, msg2);
   }
+  static Status InvalidArgument(std::string_view msg1, std::string_view msg2 = std::string_view()) {
+    return Status(KInvalidArgument, msg1, msg2);
+  }
   bool IsNotFound() const { return code() == KNotFound; }
 
   bool IsIOError() const { return code() == KIOError; }
 
   bool IsCorruption() const { return code() == KCorruption; }
 
+  bool IsInvalidArgument() const { return code() == KInvalidArgument; }
+
   bool ok() const { return state_ == nullptr; }
 
   std::string ToString() const;
 
  private:
-  enum Code { KOK = 0, KNotFound = 1, KIOError = 2, KCorruption = 3 };
+  enum Code { KOK = 0, KNotFound = 1, KIOError = 2, KCorruption = 3, KInvalidArgument = 4 };
 
   Code code() const {
     return (state_ == nullptr ? KOK : static_cast<Code>(state_[4]));
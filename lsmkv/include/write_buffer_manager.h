@@ -0,0 +1,78 @@
+#ifndef STORAGE_XDB_INCLUDE_WRITE_BUFFER_MANAGER_H_
+#define STORAGE_XDB_INCLUDE_WRITE_BUFFER_MANAGER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "include/cache.h"
+#include "util/mutex.h"
+
+namespace lsmkv {
+
+// limit the total memtable memory of the DB instances sharing it,
+// passed to the instances by "Option::write_buffer_manager".
+class WriteBufferManager {
+ public:
+  // "buffer_size" is the memory limit of all the memtables. when it is
+  // exceeded, the instances with the largest memtables are asked to
+  // switch their memtables, which are flushed then.
+  // if "cache" is not nullptr, the memtable memory is charged to it, so
+  // the memtables and the cached data share the cache's capacity.
+  explicit WriteBufferManager(size_t buffer_size, Cache* cache = nullptr);
+
+  WriteBufferManager(const WriteBufferManager&) = delete;
+  WriteBufferManager& operator=(const WriteBufferManager&) = delete;
+
+  ~WriteBufferManager();
+
+  size_t buffer_size() const { return buffer_size_; }
+
+  // the total memtable memory of the instances
+  size_t MemoryUsage() const {
+    return memory_usage_.load(std::memory_order_relaxed);
+  }
+
+  // the following methods are called by the DB instances.
+
+  // "request_switch" is called with "db" when it is asked to switch its
+  // memtable, so that an idle instance switches without waiting for its
+  // next write. it is called with the manager locked, so it must not
+  // block or call the manager.
+  void Register(const void* db, void (*request_switch)(const void*) = nullptr);
+
+  void Unregister(const void* db);
+
+  // report the memtable memory of "db". "mutable_usage" is the memory of
+  // the memtable being written, which can be switched.
+  void UpdateUsage(const void* db, size_t mutable_usage, size_t total_usage);
+
+  // return true if "db" is asked to switch its memtable,
+  // the request is cleared then.
+  bool ShouldSwitch(const void* db);
+
+ private:
+  struct Usage {
+    size_t mutable_usage = 0;
+    size_t total_usage = 0;
+    bool switch_requested = false;
+    void (*request_switch)(const void*) = nullptr;
+  };
+
+  void RequestSwitches() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  void UpdateCacheCharge() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const size_t buffer_size_;
+  Cache* const cache_;
+  Mutex mu_;
+  std::map<const void*, Usage> usages_ GUARDED_BY(mu_);
+  // the pinned dummy entries charging the memory to cache_
+  std::vector<Cache::Handle*> dummy_handles_ GUARDED_BY(mu_);
+  std::atomic<size_t> memory_usage_;
+};
+
+}  // namespace lsmkv
+
+#endif  // STORAGE_XDB_INCLUDE_WRITE_BUFFER_MANAGER_H_
@@ -6,6 +6,8 @@
 #include "include/status.h"
 namespace lsmkv {
 
+class ColumnFamilyHandle;
+
 class WriteBatch {
  public:
     class Handle {
@@ -13,6 +15,11 @@ class WriteBatch {
          virtual ~Handle() = default;
          virtual void Put(std::string_view key, std::string_view value) = 0;
          virtual void Delete(std::string_view key) = 0;
+         // the records of the column families except the default one,
+         // not supported by default.
+         virtual Status PutCF(uint32_t column_family, std::string_view key,
+                              std::string_view value);
+         virtual Status DeleteCF(uint32_t column_family, std::string_view key);
     };
     WriteBatch();
 
@@ -26,6 +33,11 @@ class WriteBatch {
 
     void Delete(std::string_view key);
 
+    // update the column family, the default one if it is nullptr.
+    void Put(ColumnFamilyHandle* column_family, std::string_view key, std::string_view value);
+
+    void Delete(ColumnFamilyHandle* column_family, std::string_view key);
+
     void Clear();
 
     Status Iterate(Handle* handle) const;
@@ -33,6 +45,8 @@ class WriteBatch {
    friend class WriteBatchHelper;
 
    std::string rep_;
+   // there are records of the column families except the default one
+   bool has_column_family_;
 
 };
 
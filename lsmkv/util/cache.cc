@@ -1,5 +1,6 @@
 #include "include/cache.h"
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
@@ -20,6 +21,7 @@ struct LRUHandle {
   uint32_t refs;
   uint32_t hash;
   bool in_cache;
+  bool high_priority;
   char key_data[1];
 
   std::string_view key() const {
@@ -103,22 +105,32 @@ class HandleTable {
 
 class LRUCache {
  public:
-  LRUCache() : capacity_(0), usage_(0) {
+  LRUCache() : capacity_(0), high_capacity_(0), usage_(0), high_usage_(0) {
     lru_.prev = &lru_;
+    high_lru_.prev = &high_lru_;
     in_use_.prev = &in_use_;
     lru_.next = &lru_;
+    high_lru_.next = &high_lru_;
     in_use_.next = &in_use_;
   }
   ~LRUCache();
 
-  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+  void SetCapacity(size_t capacity, size_t high_capacity) {
+    capacity_ = capacity;
+    high_capacity_ = high_capacity;
+  }
 
   Cache::Handle* Lookup(std::string_view key, uint32_t hash);
   Cache::Handle* Insert(std::string_view key, uint32_t hash, void* value,
                         size_t charge,
-                        void (*deleter)(std::string_view key, void* value));
+                        void (*deleter)(std::string_view key, void* value),
+                        bool high_priority);
   void Release(Cache::Handle* handle);
   void Erase(std::string_view key, uint32_t hash);
+  size_t TotalCharge() {
+    MutexLock lock(&mu_);
+    return usage_;
+  }
 
  private:
   void Ref(LRUHandle* e);
@@ -126,24 +138,34 @@ class LRUCache {
   void LRU_Append(LRUHandle* list, LRUHandle* e);
   void LRU_Remove(LRUHandle* e);
   void FinishErase(LRUHandle* e);
+  // the unused record to evict, nullptr if none
+  LRUHandle* EvictCandidate() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   Mutex mu_;
   size_t capacity_;
+  // the high priority records are evicted before the low priority
+  // ones only when they use more than this
+  size_t high_capacity_;
   size_t usage_ GUARDED_BY(mu_);
+  size_t high_usage_ GUARDED_BY(mu_);
+  // the unused records of low and high priority in LRU order
   LRUHandle lru_ GUARDED_BY(mu_);
+  LRUHandle high_lru_ GUARDED_BY(mu_);
   LRUHandle in_use_ GUARDED_BY(mu_);
   HandleTable table_ GUARDED_BY(mu_);
 };
 
 LRUCache::~LRUCache() {
-  LRUHandle* e = lru_.next;
-  while (e != &lru_) {
-    LRUHandle* next = e->next;
-    assert(e->in_cache);
-    e->in_cache = false;
-    assert(e->refs == 1);
-    Unref(e);
-    e = next;
+  for (LRUHandle* list : {&lru_, &high_lru_}) {
+    LRUHandle* e = list->next;
+    while (e != list) {
+      LRUHandle* next = e->next;
+      assert(e->in_cache);
+      e->in_cache = false;
+      assert(e->refs == 1);
+      Unref(e);
+      e = next;
+    }
   }
 }
 Cache::Handle* LRUCache::Lookup(std::string_view key, uint32_t hash) {
@@ -158,7 +180,8 @@ Cache::Handle* LRUCache::Lookup(std::string_view key, uint32_t hash) {
 Cache::Handle* LRUCache::Insert(std::string_view key, uint32_t hash,
                                 void* value, size_t charge,
                                 void (*deleter)(std::string_view key,
-                                                void* value)) {
+                                                void* value),
+                                bool high_priority) {
   MutexLock lock(&mu_);
 
   LRUHandle* handle =
@@ -170,6 +193,8 @@ Cache::Handle* LRUCache::Insert(std::string_view key, uint32_t hash,
   handle->key_length = key.size();
   handle->refs = 1;
   handle->in_cache = false;
+  // without the high priority pool, the record is a low priority one.
+  handle->high_priority = high_priority && high_capacity_ > 0;
   memcpy(handle->key_data, key.data(), key.size());
 
   if (capacity_ > 0) {
@@ -177,13 +202,16 @@ Cache::Handle* LRUCache::Insert(std::string_view key, uint32_t hash,
     handle->in_cache = true;
     LRU_Append(&in_use_, handle);
     usage_ += charge;
+    if (high_priority) {
+      high_usage_ += charge;
+    }
     FinishErase(table_.Insert(handle));
   } else {
     handle->next = nullptr;
   }
 
-  while (usage_ > capacity_ && lru_.next != &lru_) {
-    LRUHandle* old = lru_.next;
+  LRUHandle* old;
+  while (usage_ > capacity_ && (old = EvictCandidate()) != nullptr) {
     assert(old->refs == 1);
     FinishErase(table_.Remove(old->key(), old->hash));
   }
@@ -191,6 +219,14 @@ Cache::Handle* LRUCache::Insert(std::string_view key, uint32_t hash,
   return reinterpret_cast<Cache::Handle*>(handle);
 }
 
+LRUHandle* LRUCache::EvictCandidate() {
+  const bool high_empty = (high_lru_.next == &high_lru_);
+  if (!high_empty && (high_usage_ > high_capacity_ || lru_.next == &lru_)) {
+    return high_lru_.next;
+  }
+  return lru_.next == &lru_ ? nullptr : lru_.next;
+}
+
 void LRUCache::Release(Cache::Handle* handle) {
   MutexLock lock(&mu_);
   Unref(reinterpret_cast<LRUHandle*>(handle));
@@ -229,7 +265,7 @@ void LRUCache::Unref(LRUHandle* e) {
     free(e);
   } else if (e->in_cache && e->refs == 1) {
     LRU_Remove(e);
-    LRU_Append(&lru_, e);
+    LRU_Append(e->high_priority ? &high_lru_ : &lru_, e);
   }
 }
 
@@ -239,6 +275,9 @@ void LRUCache::FinishErase(LRUHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
     LRU_Remove(e);
     e->in_cache = false;
     usage_ -= e->charge;
+    if (e->high_priority) {
+      high_usage_ -= e->charge;
+    }
     Unref(e);
   }
 }
@@ -248,15 +287,21 @@ static constexpr int KNumShard = 1 << KNumShardBits;
 
 class ShardLRUCache : public Cache {
  public:
-  ShardLRUCache(size_t capacity) {
+  ShardLRUCache(size_t capacity, double high_priority_ratio)
+      : hits_(0), misses_(0) {
     size_t shard_capacity = (capacity + (KNumShard - 1)) / KNumShard;
+    size_t high_capacity = static_cast<size_t>(shard_capacity *
+                                               high_priority_ratio);
     for (int i = 0; i < KNumShard; i++) {
-      shard_[i].SetCapacity(shard_capacity);
+      shard_[i].SetCapacity(shard_capacity, high_capacity);
     }
   }
   Handle* Lookup(std::string_view key) override {
     uint32_t hash = Hash(key);
-    return shard_[Shard(hash)].Lookup(key, hash);
+    Handle* handle = shard_[Shard(hash)].Lookup(key, hash);
+    (handle != nullptr ? hits_ : misses_)
+        .fetch_add(1, std::memory_order_relaxed);
+    return handle;
   }
 
   void Release(Handle* handle) override {
@@ -276,7 +321,32 @@ class ShardLRUCache : public Cache {
   Handle* Insert(std::string_view key, void* value, size_t charge,
                  void (*deleter)(std::string_view key, void* value)) override {
     uint32_t hash = Hash(key);
-    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      false);
+  }
+
+  Handle* Insert(std::string_view key, void* value, size_t charge,
+                 void (*deleter)(std::string_view key, void* value),
+                 Priority priority) override {
+    uint32_t hash = Hash(key);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      priority == KHighPriority);
+  }
+
+  size_t TotalCharge() override {
+    size_t total = 0;
+    for (int i = 0; i < KNumShard; i++) {
+      total += shard_[i].TotalCharge();
+    }
+    return total;
+  }
+
+  uint64_t HitCount() override {
+    return hits_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t MissCount() override {
+    return misses_.load(std::memory_order_relaxed);
   }
 
  private:
@@ -285,7 +355,11 @@ class ShardLRUCache : public Cache {
   }
   uint32_t Shard(uint32_t hash) { return hash >> (32 - KNumShardBits); }
   LRUCache shard_[KNumShard];
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
 };
 
-Cache* NewLRUCache(size_t capacity) { return new ShardLRUCache(capacity); }
+Cache* NewLRUCache(size_t capacity, double high_priority_ratio) {
+  return new ShardLRUCache(capacity, high_priority_ratio);
+}
 }  // namespace lsmkv
\ No newline at end of file
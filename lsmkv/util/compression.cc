@@ -0,0 +1,226 @@
+#include "util/compression.h"
+
+#include <memory>
+
+#include "snappy.h"
+#include "util/coding.h"
+
+#ifdef LSMKV_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef LSMKV_HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+namespace lsmkv {
+
+#ifdef LSMKV_HAVE_ZSTD
+// the contexts are reused by the blocks compressed in the same thread.
+static ZSTD_CCtx* ThreadCCtx() {
+  thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> cctx(
+      ZSTD_createCCtx(), &ZSTD_freeCCtx);
+  return cctx.get();
+}
+
+static ZSTD_DCtx* ThreadDCtx() {
+  thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> dctx(
+      ZSTD_createDCtx(), &ZSTD_freeDCtx);
+  return dctx.get();
+}
+#endif
+
+CompressionDict::CompressionDict(std::string_view dict, int level)
+    : cdict_(nullptr) {
+#ifdef LSMKV_HAVE_ZSTD
+  cdict_ = ZSTD_createCDict(dict.data(), dict.size(), level);
+#else
+  (void)dict;
+  (void)level;
+#endif
+}
+
+CompressionDict::~CompressionDict() {
+#ifdef LSMKV_HAVE_ZSTD
+  ZSTD_freeCDict(static_cast<ZSTD_CDict*>(cdict_));
+#endif
+}
+
+UncompressionDict::UncompressionDict(std::string_view dict) : ddict_(nullptr) {
+#ifdef LSMKV_HAVE_ZSTD
+  ddict_ = ZSTD_createDDict(dict.data(), dict.size());
+#else
+  (void)dict;
+#endif
+}
+
+UncompressionDict::~UncompressionDict() {
+#ifdef LSMKV_HAVE_ZSTD
+  ZSTD_freeDDict(static_cast<ZSTD_DDict*>(ddict_));
+#endif
+}
+
+bool TrainCompressionDict(const std::vector<std::string>& samples,
+                          size_t max_bytes, std::string* dict) {
+#ifdef LSMKV_HAVE_ZSTD
+  std::string buffer;
+  std::vector<size_t> sizes;
+  for (const std::string& sample : samples) {
+    buffer.append(sample);
+    sizes.push_back(sample.size());
+  }
+  dict->resize(max_bytes);
+  const size_t n =
+      ZDICT_trainFromBuffer(&(*dict)[0], max_bytes, buffer.data(), sizes.data(),
+                            static_cast<unsigned>(sizes.size()));
+  if (ZDICT_isError(n)) {
+    dict->clear();
+    return false;
+  }
+  dict->resize(n);
+  return true;
+#else
+  (void)samples;
+  (void)max_bytes;
+  dict->clear();
+  return false;
+#endif
+}
+
+bool CompressionSupported(CompressType type) {
+  switch (type) {
+    case KUnCompress:
+    case KSnappyCompress:
+      return true;
+    case KLZ4Compress:
+#ifdef LSMKV_HAVE_LZ4
+      return true;
+#else
+      return false;
+#endif
+    case KZSTDCompress:
+#ifdef LSMKV_HAVE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+bool CompressBlock(CompressType type, int level, std::string_view raw,
+                   std::string* output, const CompressionDict* dict) {
+  output->clear();
+  switch (type) {
+    case KSnappyCompress:
+      return snappy::Compress(raw.data(), raw.size(), output) > 0;
+    case KLZ4Compress: {
+#ifdef LSMKV_HAVE_LZ4
+      PutVarint32(output, static_cast<uint32_t>(raw.size()));
+      const size_t header = output->size();
+      const int bound = LZ4_compressBound(static_cast<int>(raw.size()));
+      output->resize(header + bound);
+      const int n = LZ4_compress_default(raw.data(), &(*output)[header],
+                                         static_cast<int>(raw.size()), bound);
+      if (n <= 0) {
+        return false;
+      }
+      output->resize(header + n);
+      return true;
+#else
+      (void)level;
+      return false;
+#endif
+    }
+    case KZSTDCompress: {
+#ifdef LSMKV_HAVE_ZSTD
+      PutVarint32(output, static_cast<uint32_t>(raw.size()));
+      const size_t header = output->size();
+      const size_t bound = ZSTD_compressBound(raw.size());
+      output->resize(header + bound);
+      size_t n;
+      if (dict != nullptr && dict->cdict_ != nullptr) {
+        n = ZSTD_compress_usingCDict(
+            ThreadCCtx(), &(*output)[header], bound, raw.data(), raw.size(),
+            static_cast<const ZSTD_CDict*>(dict->cdict_));
+      } else {
+        n = ZSTD_compressCCtx(ThreadCCtx(), &(*output)[header], bound,
+                              raw.data(), raw.size(), level);
+      }
+      if (ZSTD_isError(n)) {
+        return false;
+      }
+      output->resize(header + n);
+      return true;
+#else
+      (void)level;
+      (void)dict;
+      return false;
+#endif
+    }
+    default:
+      return false;
+  }
+}
+
+Status UncompressBlock(CompressType type, const char* data, size_t n,
+                       char** result, size_t* result_size,
+                       const UncompressionDict* dict) {
+  if (type == KSnappyCompress) {
+    size_t len = 0;
+    if (!snappy::GetUncompressedLength(data, n, &len)) {
+      return Status::Corruption("ReadBlock: snappy GetUncompressedLength error");
+    }
+    char* buf = new char[len];
+    if (!snappy::RawUncompress(data, n, buf)) {
+      delete[] buf;
+      return Status::Corruption("ReadBlock: snappy RawUncompress error");
+    }
+    *result = buf;
+    *result_size = len;
+    return Status::OK();
+  }
+  if (type != KLZ4Compress && type != KZSTDCompress) {
+    return Status::Corruption("ReadBlock: bad block record");
+  }
+  if (!CompressionSupported(type)) {
+    return Status::Corruption("ReadBlock: compression type is not supported",
+                              type == KLZ4Compress ? "lz4" : "zstd");
+  }
+  uint32_t len = 0;
+  const char* p = DecodeVarint32(data, data + n, &len);
+  if (p == nullptr) {
+    return Status::Corruption("ReadBlock: bad uncompressed length");
+  }
+  const size_t compressed = n - (p - data);
+  char* buf = new char[len];
+  bool ok = false;
+#ifdef LSMKV_HAVE_LZ4
+  if (type == KLZ4Compress) {
+    ok = LZ4_decompress_safe(p, buf, static_cast<int>(compressed),
+                             static_cast<int>(len)) == static_cast<int>(len);
+  }
+#endif
+#ifdef LSMKV_HAVE_ZSTD
+  if (type == KZSTDCompress) {
+    if (dict != nullptr && dict->ddict_ != nullptr) {
+      ok = ZSTD_decompress_usingDDict(
+               ThreadDCtx(), buf, len, p, compressed,
+               static_cast<const ZSTD_DDict*>(dict->ddict_)) == len;
+    } else {
+      ok = ZSTD_decompressDCtx(ThreadDCtx(), buf, len, p, compressed) == len;
+    }
+  }
+#endif
+  (void)compressed;
+  (void)dict;
+  if (!ok) {
+    delete[] buf;
+    return Status::Corruption("ReadBlock: uncompress error");
+  }
+  *result = buf;
+  *result_size = len;
+  return Status::OK();
+}
+
+}  // namespace lsmkv
@@ -0,0 +1,72 @@
+#ifndef STORAGE_XDB_UTIL_COMPRESSION_H_
+#define STORAGE_XDB_UTIL_COMPRESSION_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "include/option.h"
+#include "include/status.h"
+
+namespace lsmkv {
+
+// a zstd dictionary digested for compression, shared by all the data
+// blocks of a sstable. see "Option::zstd_max_dict_bytes".
+class CompressionDict {
+ public:
+    CompressionDict(std::string_view dict, int level);
+    ~CompressionDict();
+
+    CompressionDict(const CompressionDict&) = delete;
+    CompressionDict& operator=(const CompressionDict&) = delete;
+
+ private:
+    friend bool CompressBlock(CompressType, int, std::string_view,
+                              std::string*, const CompressionDict*);
+    void* cdict_;
+};
+
+// a zstd dictionary digested for decompression, loaded once per sstable.
+class UncompressionDict {
+ public:
+    explicit UncompressionDict(std::string_view dict);
+    ~UncompressionDict();
+
+    UncompressionDict(const UncompressionDict&) = delete;
+    UncompressionDict& operator=(const UncompressionDict&) = delete;
+
+ private:
+    friend Status UncompressBlock(CompressType, const char*, size_t, char**,
+                                  size_t*, const UncompressionDict*);
+    void* ddict_;
+};
+
+// train a zstd dictionary of at most "max_bytes" from the "samples".
+// return false if zstd is not supported or the samples are too few.
+bool TrainCompressionDict(const std::vector<std::string>& samples,
+                          size_t max_bytes, std::string* dict);
+
+// return true if the compression "type" is linked into this build.
+// snappy is always supported, lz4 and zstd are optional.
+bool CompressionSupported(CompressType type);
+
+// compress "raw" into "output" by "type". "level" and "dict" are only
+// used by zstd. return false if "type" is not supported or the
+// compression fails.
+//
+// the lz4 and zstd blocks are prefixed with the varint32 length of the
+// uncompressed data, so the reader can allocate the result buffer once.
+bool CompressBlock(CompressType type, int level, std::string_view raw,
+                   std::string* output,
+                   const CompressionDict* dict = nullptr);
+
+// uncompress the "n" bytes of "data" into a buffer allocated by new[],
+// which is stored in "*result" and owned by the caller. "dict" must be
+// the dictionary the block is compressed with, if any.
+Status UncompressBlock(CompressType type, const char* data, size_t n,
+                       char** result, size_t* result_size,
+                       const UncompressionDict* dict = nullptr);
+
+}  // namespace lsmkv
+
+#endif  // STORAGE_XDB_UTIL_COMPRESSION_H_
@@ -35,6 +35,12 @@ bool ParseFilename(const std::string& filename, uint64_t* number, FileType* type
     } else if (filename == "LOGGER"){
         *number = 0;
         *type = KLoggerFile;
+    } else if (filename == "COMPACTION"){
+        *number = 0;
+        *type = KCompactionFile;
+    } else if (filename == "IDENTITY"){
+        *number = 0;
+        *type = KIdentityFile;
     } else {
         uint64_t num;
         if(!ParseNumder(&rest,&num)) {
@@ -90,6 +96,14 @@ std::string CurrentFileName(const std::string& dbname) {
     return dbname + "/CURRENT";
 }
 
+std::string CompactionFileName(const std::string& dbname) {
+    return dbname + "/COMPACTION";
+}
+
+std::string IdentityFileName(const std::string& dbname) {
+    return dbname + "/IDENTITY";
+}
+
 std::string SSTableFileName(const std::string& dbname, uint64_t number) {
     return MakeFileName(dbname, number, "sst");
 }
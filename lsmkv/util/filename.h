@@ -18,6 +18,8 @@ enum FileType {
   KTmpFile = 4,
   KSSTableFile = 5,
   KLoggerFile = 6,
+  KCompactionFile = 7,
+  KIdentityFile = 8,
 };
 std::string LogFileName(const std::string& dbname, uint64_t number);
 
@@ -33,6 +35,12 @@ std::string SSTableFileName(const std::string& dbname, uint64_t number);
 
 std::string CurrentFileName(const std::string& dbname);
 
+// records the progress of the running compaction
+std::string CompactionFileName(const std::string& dbname);
+
+// holds the id of the DB, which keys its blocks in the shared caches
+std::string IdentityFileName(const std::string& dbname);
+
 bool ParseFilename(const std::string& filename, uint64_t* number,
                    FileType* type);
 
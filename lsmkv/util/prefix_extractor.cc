@@ -0,0 +1,24 @@
+#include "include/prefix_extractor.h"
+
+#include <algorithm>
+
+namespace lsmkv {
+
+class FixedPrefixExtractor : public PrefixExtractor {
+ public:
+  explicit FixedPrefixExtractor(size_t prefix_len) : prefix_len_(prefix_len) {}
+
+  const char* Name() const override { return "lsmkv.FixedPrefix"; }
+
+  std::string_view Transform(std::string_view key) const override {
+    return key.substr(0, std::min(prefix_len_, key.size()));
+  }
+
+ private:
+  size_t prefix_len_;
+};
+
+PrefixExtractor* NewFixedPrefixExtractor(size_t prefix_len) {
+  return new FixedPrefixExtractor(prefix_len);
+}
+}  // namespace lsmkv
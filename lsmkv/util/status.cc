@@ -50,6 +50,9 @@ std::string Status::ToString() const {
       case KCorruption:
         type = "Corruption: ";
         break;
+      case KInvalidArgument:
+        type = "Invalid argument: ";
+        break;
       default:
         std::snprintf(tmp, sizeof(tmp),
                       "Unknown(%d): ", static_cast<Code>(code()));
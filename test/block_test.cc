@@ -1,4 +1,5 @@
 #include "gtest/gtest.h"
+#include "db/format/internal_key.h"
 #include "db/sstable/block_reader.h"
 #include "db/sstable/block_builder.h"
 #include "db/sstable/block_format.h"
@@ -28,4 +29,53 @@ namespace lsmkv {
         delete iter;
     }
 
-}
\ No newline at end of file
+    TEST(ExampleTest, HashIndex) {
+        Option option;
+        InternalKeyComparator cmp(DefaultComparator());
+        BlockBuilder builder(&option, true);
+        char buf[10];
+        for (int i = 0; i < 1000; i += 2) {
+            std::snprintf(buf, sizeof(buf), "%06d", i);
+            builder.Add(InternalKey(2, buf, KTypeInsertion).Encode(), "NEW");
+            builder.Add(InternalKey(1, buf, KTypeInsertion).Encode(), "OLD");
+        }
+        std::string_view s = builder.Finish();
+        BlockContents contents;
+        contents.data = s;
+        contents.heap_allocated_ = false;
+        contents.table_cache_ = false;
+        BlockReader reader(contents);
+        Iterator* iter = reader.NewIterator(&cmp);
+        int ruled_out = 0;
+        for (int i = 0; i < 1000; i++) {
+            std::snprintf(buf, sizeof(buf), "%06d", i);
+            InternalKey latest(2, buf, KTypeLookup);
+            InternalKey old(1, buf, KTypeLookup);
+            if (i % 2 == 0) {
+                ASSERT_TRUE(reader.SeekForGet(iter, latest.Encode()));
+                ASSERT_TRUE(iter->Valid());
+                ASSERT_EQ(ExtractUserKey(iter->Key()), buf);
+                ASSERT_EQ(iter->Value(), "NEW");
+                ASSERT_TRUE(reader.SeekForGet(iter, old.Encode()));
+                ASSERT_TRUE(iter->Valid());
+                ASSERT_EQ(iter->Value(), "OLD");
+            } else if (!reader.SeekForGet(iter, latest.Encode())) {
+                ruled_out++;
+            } else if (iter->Valid()) {
+                ASSERT_NE(ExtractUserKey(iter->Key()), buf);
+            }
+        }
+        ASSERT_GT(ruled_out, 0);
+        // the iterator is not affected by the hash index
+        iter->SeekToFirst();
+        for (int i = 0; i < 1000; i += 2) {
+            ASSERT_TRUE(iter->Valid());
+            iter->Next();
+            ASSERT_TRUE(iter->Valid());
+            iter->Next();
+        }
+        ASSERT_FALSE(iter->Valid());
+        delete iter;
+    }
+
+}
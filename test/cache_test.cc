@@ -1,3 +1,6 @@
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "include/cache.h"
 namespace lsmkv {
@@ -18,4 +21,68 @@ namespace lsmkv {
         delete cache;
     }
 
+    TEST(ExampleTest, HighPriority) {
+        // each shard has 128 charge, 64 of them for high priority.
+        Cache* cache = NewLRUCache(256, 0.5);
+        std::string val{"val"};
+        std::vector<std::string> keys;
+        for (int i = 0; i < 64; i++) {
+            keys.push_back("high" + std::to_string(i));
+        }
+        for (int i = 0; i < 64; i++) {
+            keys.push_back("low" + std::to_string(i));
+        }
+        for (int i = 0; i < 128; i++) {
+            Cache::Handle* e = cache->Insert(keys[i], &val, 1, &NullDeleter,
+                i < 64 ? Cache::KHighPriority : Cache::KLowPriority);
+            cache->Release(e);
+        }
+        ASSERT_EQ(cache->TotalCharge(), 128);
+        // the low priority records are evicted first.
+        for (int i = 0; i < 512; i++) {
+            std::string key = "new" + std::to_string(i);
+            cache->Release(cache->Insert(key, &val, 1, &NullDeleter));
+        }
+        ASSERT_LE(cache->TotalCharge(), 256);
+        for (int i = 0; i < 64; i++) {
+            Cache::Handle* e = cache->Lookup(keys[i]);
+            ASSERT_TRUE(e != nullptr);
+            cache->Release(e);
+        }
+        for (int i = 64; i < 128; i++) {
+            ASSERT_TRUE(cache->Lookup(keys[i]) == nullptr);
+        }
+        delete cache;
+    }
+
+    TEST(ExampleTest, ZeroHighPriorityRatio) {
+        // without the high priority pool, all the records are evicted in
+        // the LRU order.
+        Cache* cache = NewLRUCache(128, 0);
+        std::string val{"val"};
+        std::vector<std::string> keys;
+        for (int i = 0; i < 64; i++) {
+            keys.push_back("low" + std::to_string(i));
+        }
+        for (int i = 0; i < 64; i++) {
+            keys.push_back("high" + std::to_string(i));
+        }
+        for (int i = 0; i < 128; i++) {
+            Cache::Handle* e = cache->Insert(keys[i], &val, 1, &NullDeleter,
+                i < 64 ? Cache::KLowPriority : Cache::KHighPriority);
+            cache->Release(e);
+        }
+        for (int i = 0; i < 32; i++) {
+            std::string key = "new" + std::to_string(i);
+            cache->Release(cache->Insert(key, &val, 1, &NullDeleter));
+        }
+        ASSERT_LE(cache->TotalCharge(), 128);
+        for (int i = 64; i < 128; i++) {
+            Cache::Handle* e = cache->Lookup(keys[i]);
+            ASSERT_TRUE(e != nullptr);
+            cache->Release(e);
+        }
+        delete cache;
+    }
+
 }
\ No newline at end of file
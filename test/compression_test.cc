@@ -0,0 +1,77 @@
+#include "util/compression.h"
+
+#include "db/sstable/block_format.h"
+#include "gtest/gtest.h"
+
+namespace lsmkv {
+
+static std::string CompressibleData(size_t n) {
+  std::string data;
+  for (size_t i = 0; data.size() < n; i++) {
+    data.append("key" + std::to_string(i % 100) + "value");
+  }
+  data.resize(n);
+  return data;
+}
+
+TEST(CompressionTest, RoundTrip) {
+  const std::string raw = CompressibleData(4096);
+  for (CompressType type : {KSnappyCompress, KLZ4Compress, KZSTDCompress}) {
+    std::string compressed;
+    if (!CompressionSupported(type)) {
+      ASSERT_FALSE(CompressBlock(type, 1, raw, &compressed));
+      continue;
+    }
+    ASSERT_TRUE(CompressBlock(type, 1, raw, &compressed));
+    char* result = nullptr;
+    size_t result_size = 0;
+    Status s = UncompressBlock(type, compressed.data(), compressed.size(),
+                               &result, &result_size);
+    ASSERT_TRUE(s.ok()) << s.ToString();
+    ASSERT_EQ(std::string(result, result_size), raw);
+    delete[] result;
+  }
+}
+
+TEST(CompressionTest, Corruption) {
+  const std::string raw = CompressibleData(4096);
+  for (CompressType type : {KSnappyCompress, KLZ4Compress, KZSTDCompress}) {
+    std::string compressed;
+    if (!CompressBlock(type, 1, raw, &compressed)) {
+      continue;
+    }
+    // a truncated block
+    char* result = nullptr;
+    size_t result_size = 0;
+    Status s = UncompressBlock(type, compressed.data(), compressed.size() - 1,
+                               &result, &result_size);
+    ASSERT_TRUE(s.IsCorruption());
+    ASSERT_EQ(result, nullptr);
+  }
+  // an unknown type
+  char* result = nullptr;
+  size_t result_size = 0;
+  Status s = UncompressBlock(static_cast<CompressType>(9), raw.data(),
+                             raw.size(), &result, &result_size);
+  ASSERT_TRUE(s.IsCorruption());
+  ASSERT_EQ(result, nullptr);
+}
+
+TEST(CompressionTest, BlockTypeByte) {
+  const std::string raw = CompressibleData(4096);
+  std::string stored;
+  ASSERT_TRUE(CompressBlock(KSnappyCompress, 1, raw, &stored));
+  const size_t n = stored.size();
+  stored.push_back(static_cast<char>(KSnappyCompress));
+  BlockContents contents;
+  ASSERT_TRUE(UncompressBlockContents(stored.data(), n, &contents).ok());
+  ASSERT_EQ(contents.data, raw);
+  delete[] contents.data.data();
+
+  // the block is rejected by a type byte out of CompressType
+  stored[n] = 9;
+  ASSERT_TRUE(
+      UncompressBlockContents(stored.data(), n, &contents).IsCorruption());
+}
+
+}  // namespace lsmkv
@@ -1,10 +1,23 @@
 #include "include/db.h"
 
 #include <iostream>
+#include <memory>
 #include <random>
+#include <thread>
 
 #include "crc32c/crc32c.h"
+#include "db/dbimpl.h"
+#include "db/sstable/block_format.h"
+#include "db/sstable/block_reader.h"
 #include "gtest/gtest.h"
+#include "include/cache.h"
+#include "include/comparator.h"
+#include "include/filter_policy.h"
+#include "include/sharded_db.h"
+#include "include/sstable_builder.h"
+#include "include/write_buffer_manager.h"
+#include "util/compression.h"
+#include "util/filename.h"
 namespace lsmkv {
 
 TEST(DBTest, Sometest) {
@@ -122,6 +135,1384 @@ TEST(DBTest, DeletionTest) {
   }
   delete db;
 }
+TEST(DBTest, DynamicLevelSizeTest) {
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  option.max_file_size = 64 * 1024;
+  option.level_base_size = 256 * 1024;
+  option.l0_compaction_threshold = 2;
+  option.dynamic_level_size = true;
+  WriteOption write_option;
+  ReadOption read_option;
+  DB* db;
+  DestoryDB(option, "/home/lei/MyLSMKV/folder_for_test/db_test");
+  DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+  const size_t data_size = 20000;
+  char val[100];
+  for (int i = 0; i < data_size; i++) {
+    std::snprintf(val, sizeof(val), "%-80d", i);
+    db->Put(write_option, std::to_string(i), val);
+  }
+  delete db;
+  db = nullptr;
+  DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+  DBImpl* impl = static_cast<DBImpl*>(db);
+  ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+  // the data fills only the last levels, level-0 is compacted into
+  // one of them instead of level-1.
+  VersionSet* vset = impl->TEST_VersionSet();
+  const int base_level = vset->BaseLevel();
+  ASSERT_GT(base_level, 1);
+  uint64_t max_level_size = 0;
+  for (int level = 1; level < config::kNumLevels; level++) {
+    uint64_t level_size = 0;
+    for (const FileMeta* meta : vset->LevelFiles(level)) {
+      level_size += meta->file_size;
+    }
+    if (level < base_level) {
+      ASSERT_EQ(level_size, 0);
+    }
+    max_level_size = std::max(max_level_size, level_size);
+  }
+  ASSERT_GT(max_level_size, option.level_base_size);
+  ASSERT_EQ(vset->LevelMaxSize(base_level), option.level_base_size);
+  ASSERT_NEAR(vset->LevelMaxSize(config::kNumLevels - 1), max_level_size,
+              max_level_size * 1e-6);
+  for (int level = base_level + 1; level < config::kNumLevels; level++) {
+    ASSERT_GE(vset->LevelMaxSize(level), vset->LevelMaxSize(level - 1));
+  }
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    std::snprintf(val, sizeof(val), "%-80d", i);
+    ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+    ASSERT_EQ(result, val);
+  }
+  delete db;
+}
+
+TEST(DBTest, CompactionPriorityTest) {
+  for (CompactionPriority priority : {KMinOverlappingRatio, KOldestFileFirst}) {
+    Option option;
+    option.write_mem_size = 64 * 1024;
+    option.max_file_size = 32 * 1024;
+    option.level_base_size = 128 * 1024;
+    option.compaction_priority = priority;
+    WriteOption write_option;
+    ReadOption read_option;
+    DB* db;
+    DestoryDB(option, "/home/lei/MyLSMKV/folder_for_test/db_test");
+    DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+    std::mt19937 rng(std::random_device{}());
+    const size_t data_size = 5000;
+    std::vector<std::string> data(data_size);
+    char val[100];
+    for (int iter = 0; iter < 4; iter++) {
+      for (int i = 0; i < data_size; i++) {
+        size_t k = rng() % data_size;
+        std::snprintf(val, sizeof(val), "%d.%-60d", iter, i);
+        db->Put(write_option, std::to_string(k), val);
+        data[k] = val;
+      }
+    }
+    DBImpl* impl = static_cast<DBImpl*>(db);
+    ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+    VersionSet* vset = impl->TEST_VersionSet();
+    int checked_levels = 0;
+    for (int level = 1; level + 1 < config::kNumLevels; level++) {
+      const std::vector<FileMeta*>& files = vset->LevelFiles(level);
+      if (files.empty()) {
+        continue;
+      }
+      const FileMeta* expected = nullptr;
+      double min_ratio = 0;
+      for (const FileMeta* meta : files) {
+        if (priority == KOldestFileFirst) {
+          if (expected == nullptr || meta->number < expected->number) {
+            expected = meta;
+          }
+          continue;
+        }
+        uint64_t overlapping_bytes = 0;
+        for (const FileMeta* next : vset->LevelFiles(level + 1)) {
+          if (next->largest.user_key() >= meta->smallest.user_key() &&
+              next->smallest.user_key() <= meta->largest.user_key()) {
+            overlapping_bytes += next->file_size;
+          }
+        }
+        const double ratio = static_cast<double>(overlapping_bytes) /
+                             static_cast<double>(meta->file_size + 1);
+        if (expected == nullptr || ratio < min_ratio) {
+          expected = meta;
+          min_ratio = ratio;
+        }
+      }
+      ASSERT_EQ(vset->TEST_PickFileToCompact(level), expected);
+      checked_levels++;
+    }
+    ASSERT_GT(checked_levels, 0);
+    std::string result;
+    for (int i = 0; i < data_size; i++) {
+      if (data[i].empty()) {
+        continue;
+      }
+      ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+      ASSERT_EQ(result, data[i]);
+    }
+    delete db;
+  }
+}
+
+TEST(DBTest, OutputBoundaryCutTest) {
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  option.max_file_size = 32 * 1024;
+  option.level_base_size = 128 * 1024;
+  option.output_boundary_cut_size = 8 * 1024;
+  WriteOption write_option;
+  ReadOption read_option;
+  DB* db;
+  DestoryDB(option, "/home/lei/MyLSMKV/folder_for_test/db_test");
+  DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+  std::mt19937 rng(std::random_device{}());
+  const size_t data_size = 5000;
+  std::vector<std::string> data(data_size);
+  char val[100];
+  for (int iter = 0; iter < 6; iter++) {
+    for (int i = 0; i < data_size; i++) {
+      size_t k = rng() % data_size;
+      std::snprintf(val, sizeof(val), "%d.%-60d", iter, i);
+      db->Put(write_option, std::to_string(k), val);
+      data[k] = val;
+    }
+  }
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    if (data[i].empty()) {
+      continue;
+    }
+    ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+    ASSERT_EQ(result, data[i]);
+  }
+  delete db;
+}
+
+TEST(DBTest, IntraL0CompactionTest) {
+  Option option;
+  option.write_mem_size = 32 * 1024;
+  option.max_file_size = 64 * 1024;
+  option.level_base_size = 64 * 1024;
+  option.intra_l0_compaction = true;
+  WriteOption write_option;
+  ReadOption read_option;
+  DB* db;
+  DestoryDB(option, "/home/lei/MyLSMKV/folder_for_test/db_test");
+  DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+  std::mt19937 rng(std::random_device{}());
+  const size_t data_size = 3000;
+  std::vector<std::string> data(data_size);
+  char val[100];
+  for (int iter = 0; iter < 5; iter++) {
+    for (int i = 0; i < data_size; i++) {
+      size_t k = rng() % data_size;
+      if (rng() % 10 == 0) {
+        db->Delete(write_option, std::to_string(k));
+        data[k].clear();
+      } else {
+        std::snprintf(val, sizeof(val), "%d.%-60d", iter, i);
+        db->Put(write_option, std::to_string(k), val);
+        data[k] = val;
+      }
+    }
+  }
+  DBImpl* impl = static_cast<DBImpl*>(db);
+  ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+  // level-1 is kept over its max size by the random writes.
+  ASSERT_GT(impl->TEST_CompactionStats().intra_l0_compactions, 0);
+  ASSERT_LT(impl->TEST_VersionSet()->LevelFileNum(0),
+            option.l0_compaction_threshold);
+  delete db;
+  db = nullptr;
+  DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    Status s = db->Get(read_option, std::to_string(i), &result);
+    if (data[i].empty()) {
+      ASSERT_TRUE(s.IsNotFound());
+    } else {
+      ASSERT_TRUE(s.ok());
+      ASSERT_EQ(result, data[i]);
+    }
+  }
+  delete db;
+
+  // the flushed files of sequential keys are disjoint, every level-0
+  // compaction moves all the files in level-0 into level-1 at once.
+  option.intra_l0_compaction = false;
+  option.level_base_size = 64 * 1024 * 1024;
+  DestoryDB(option, "/home/lei/MyLSMKV/folder_for_test/db_test");
+  DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+  for (int i = 0; i < 10 * data_size; i++) {
+    std::snprintf(val, sizeof(val), "%08d", i);
+    db->Put(write_option, val, val);
+  }
+  impl = static_cast<DBImpl*>(db);
+  ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+  VersionSet* vset = impl->TEST_VersionSet();
+  ASSERT_GT(impl->TEST_CompactionStats().multi_file_trivial_moves, 0);
+  ASSERT_LT(vset->LevelFileNum(0), option.l0_compaction_threshold);
+  ASSERT_GE(vset->LevelFileNum(1), option.l0_compaction_threshold);
+  for (int level = 2; level < config::kNumLevels; level++) {
+    ASSERT_EQ(vset->LevelFileNum(level), 0);
+  }
+  for (int i = 0; i < 10 * data_size; i++) {
+    std::snprintf(val, sizeof(val), "%08d", i);
+    ASSERT_TRUE(db->Get(read_option, val, &result).ok());
+    ASSERT_EQ(result, val);
+  }
+  delete db;
+}
+
+TEST(DBTest, DeletionCompactionTest) {
+  // a file is picked by its deletion ratio or by its dense deletions
+  // marked when it is written.
+  for (bool by_ratio : {true, false}) {
+    Option option;
+    option.write_mem_size = 64 * 1024;
+    option.max_file_size = 64 * 1024;
+    option.level_base_size = 128 * 1024;
+    if (by_ratio) {
+      option.deletion_compaction_ratio = 0.5;
+    } else {
+      option.deletion_compaction_window = 100;
+      option.deletion_compaction_trigger = 50;
+    }
+    WriteOption write_option;
+    ReadOption read_option;
+    DB* db;
+    DestoryDB(option, "/home/lei/MyLSMKV/folder_for_test/db_test");
+    DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+    const size_t data_size = 10000;
+    char val[100];
+    for (int i = 0; i < data_size; i++) {
+      std::snprintf(val, sizeof(val), "%-60d", i);
+      db->Put(write_option, std::to_string(i), val);
+    }
+    // the deletion records are compacted into the levels above the data,
+    // where they can't be dropped by the size compactions.
+    DBImpl* impl = static_cast<DBImpl*>(db);
+    ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+    for (int i = 0; i < data_size; i++) {
+      if (i % 4 != 0) {
+        db->Delete(write_option, std::to_string(i));
+      }
+    }
+    ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+    // only picked if "num_deletions" or "marked_for_compaction" is set.
+    ASSERT_GT(impl->TEST_CompactionStats().deletion_compactions, 0);
+    delete db;
+    db = nullptr;
+    DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+    impl = static_cast<DBImpl*>(db);
+    ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+    // the deletion records are dropped with the records they delete.
+    VersionSet* vset = impl->TEST_VersionSet();
+    uint64_t num_entries = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      for (const FileMeta* meta : vset->LevelFiles(level)) {
+        ASSERT_EQ(meta->num_deletions, 0);
+        ASSERT_FALSE(meta->marked_for_compaction);
+        num_entries += meta->num_entries;
+      }
+    }
+    ASSERT_EQ(num_entries, data_size / 4);
+    std::string result;
+    for (int i = 0; i < data_size; i++) {
+      Status s = db->Get(read_option, std::to_string(i), &result);
+      if (i % 4 != 0) {
+        ASSERT_TRUE(s.IsNotFound());
+      } else {
+        std::snprintf(val, sizeof(val), "%-60d", i);
+        ASSERT_TRUE(s.ok());
+        ASSERT_EQ(result, val);
+      }
+    }
+    delete db;
+  }
+}
+
+TEST(DBTest, ResumableCompactionTest) {
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  option.max_file_size = 16 * 1024;
+  option.resumable_compaction = true;
+  WriteOption write_option;
+  ReadOption read_option;
+  DB* db;
+  DestoryDB(option, "/home/lei/MyLSMKV/folder_for_test/db_test");
+  const size_t data_size = 5000;
+  const int restart_num = 10;
+  char val[100];
+  const std::string progress_file =
+      CompactionFileName("/home/lei/MyLSMKV/folder_for_test/db_test");
+  int interrupted = 0;
+  int resumed_outputs = 0;
+  // each round closes the DB while a compaction is paused after its first
+  // output file.
+  for (int round = 0; round < restart_num; round++) {
+    DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+    DBImpl* impl = static_cast<DBImpl*>(db);
+    ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+    resumed_outputs += impl->TEST_CompactionStats().resumed_outputs;
+    impl->TEST_PauseCompactionAfter(1);
+    for (int i = 0; i < data_size; i++) {
+      std::snprintf(val, sizeof(val), "%d.%-60d", round, i);
+      ASSERT_TRUE(db->Put(write_option, std::to_string(i), val).ok());
+    }
+    delete db;
+    if (option.env->FileExist(progress_file)) {
+      interrupted++;
+    }
+  }
+  // the progress of the interrupted compactions is recorded at closing,
+  // and their finished outputs are not written again after reopening.
+  ASSERT_EQ(interrupted, restart_num);
+  ASSERT_GE(resumed_outputs, restart_num - 1);
+  DB::Open(option, "/home/lei/MyLSMKV/folder_for_test/db_test", &db);
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    std::snprintf(val, sizeof(val), "%d.%-60d", restart_num - 1, i);
+    ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+    ASSERT_EQ(result, val);
+  }
+  delete db;
+}
+
+TEST(DBTest, ColumnFamilyResumableCompactionTest) {
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  option.max_file_size = 16 * 1024;
+  option.resumable_compaction = true;
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+  DestoryDB(option, name);
+  const std::vector<ColumnFamilyDescriptor> families = {
+      {KDefaultColumnFamilyName, option}, {"cf", option}};
+  std::vector<ColumnFamilyHandle*> handles;
+  DB* db;
+  const size_t data_size = 5000;
+  const int restart_num = 10;
+  char val[100];
+  int interrupted = 0;
+  int resumed_outputs = 0;
+  // only the column family is written, its compactions are interrupted.
+  for (int round = 0; round < restart_num; round++) {
+    ASSERT_TRUE(DB::Open(option, name, families, &handles, &db).ok());
+    DBImpl* impl = static_cast<DBImpl*>(db);
+    ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+    resumed_outputs += impl->TEST_CompactionStats().resumed_outputs;
+    impl->TEST_PauseCompactionAfter(1);
+    for (int i = 0; i < data_size; i++) {
+      std::snprintf(val, sizeof(val), "%d.%-60d", round, i);
+      ASSERT_TRUE(db->Put(write_option, handles[1], std::to_string(i), val)
+                      .ok());
+    }
+    delete db;
+    if (option.env->FileExist(CompactionFileName(name))) {
+      interrupted++;
+    }
+  }
+  ASSERT_EQ(interrupted, restart_num);
+  ASSERT_GE(resumed_outputs, restart_num - 1);
+  ASSERT_TRUE(DB::Open(option, name, families, &handles, &db).ok());
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    std::snprintf(val, sizeof(val), "%d.%-60d", restart_num - 1, i);
+    ASSERT_TRUE(db->Get(read_option, handles[1], std::to_string(i), &result)
+                    .ok());
+    ASSERT_EQ(result, val);
+    ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).IsNotFound());
+  }
+  delete db;
+}
+
+TEST(DBTest, WriteBufferManagerTest) {
+  std::unique_ptr<Cache> cache(NewLRUCache(64 * 1024 * 1024));
+  WriteBufferManager manager(256 * 1024, cache.get());
+  Option option;
+  // the memtables are switched by the manager, not by the size
+  option.write_mem_size = 4 * 1024 * 1024;
+  option.write_buffer_manager = &manager;
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string names[2] = {"/home/lei/MyLSMKV/folder_for_test/db_test",
+                                "/home/lei/MyLSMKV/folder_for_test/db_test2"};
+  DB* dbs[2];
+  for (int k = 0; k < 2; k++) {
+    DestoryDB(option, names[k]);
+    ASSERT_TRUE(DB::Open(option, names[k], &dbs[k]).ok());
+  }
+  const size_t data_size = 10000;
+  char val[101];
+  for (int i = 0; i < data_size; i++) {
+    std::snprintf(val, sizeof(val), "%-100d", i);
+    for (int k = 0; k < 2; k++) {
+      ASSERT_TRUE(dbs[k]->Put(write_option, std::to_string(i), val).ok());
+    }
+  }
+  // about 1MB is written into each DB
+  ASSERT_LT(manager.MemoryUsage(), 2 * 1024 * 1024);
+  std::string result;
+  for (int k = 0; k < 2; k++) {
+    for (int i = 0; i < data_size; i++) {
+      std::snprintf(val, sizeof(val), "%-100d", i);
+      ASSERT_TRUE(dbs[k]->Get(read_option, std::to_string(i), &result).ok());
+      ASSERT_EQ(result, val);
+    }
+    delete dbs[k];
+  }
+  ASSERT_EQ(manager.MemoryUsage(), 0);
+}
+
+TEST(DBTest, IdleWriteBufferManagerTest) {
+  WriteBufferManager manager(256 * 1024);
+  Option option;
+  option.write_mem_size = 4 * 1024 * 1024;
+  option.write_buffer_manager = &manager;
+  WriteOption write_option;
+  const std::string names[2] = {"/home/lei/MyLSMKV/folder_for_test/db_test",
+                                "/home/lei/MyLSMKV/folder_for_test/db_test2"};
+  DB* dbs[2];
+  for (int k = 0; k < 2; k++) {
+    DestoryDB(option, names[k]);
+    ASSERT_TRUE(DB::Open(option, names[k], &dbs[k]).ok());
+  }
+  // the first DB has the largest memtable and is asked to switch it by
+  // the writes of the second one, but it is never written again.
+  const size_t data_size = 1500;
+  char val[101];
+  for (int k = 0; k < 2; k++) {
+    for (int i = 0; i < data_size; i++) {
+      std::snprintf(val, sizeof(val), "%-100d", i);
+      ASSERT_TRUE(dbs[k]->Put(write_option, std::to_string(i), val).ok());
+    }
+  }
+  ASSERT_TRUE(static_cast<DBImpl*>(dbs[0])->TEST_WaitForBackgroundWork().ok());
+  ASSERT_LT(manager.MemoryUsage(), manager.buffer_size());
+  std::string result;
+  for (int k = 0; k < 2; k++) {
+    for (int i = 0; i < data_size; i++) {
+      std::snprintf(val, sizeof(val), "%-100d", i);
+      ASSERT_TRUE(dbs[k]->Get(ReadOption(), std::to_string(i), &result).ok());
+      ASSERT_EQ(result, val);
+    }
+    delete dbs[k];
+  }
+}
+
+TEST(DBTest, ShardedDBTest) {
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/sharded_db_test";
+  ShardingOption hash_sharding;
+  ShardingOption range_sharding;
+  range_sharding.type = KRangeSharding;
+  range_sharding.boundaries = {"3", "6"};
+  for (const ShardingOption& sharding : {hash_sharding, range_sharding}) {
+    DestoryShardedDB(option, sharding, name);
+    DB* db;
+    ASSERT_TRUE(ShardedDB::Open(option, sharding, name, &db).ok());
+    const size_t data_size = 10000;
+    char val[100];
+    WriteBatch batch;
+    for (int i = 0; i < data_size; i++) {
+      std::snprintf(val, sizeof(val), "%-60d", i);
+      batch.Put(std::to_string(i), val);
+      if (i % 3 == 0) {
+        batch.Delete(std::to_string(i));
+      }
+      if (i % 100 == 99) {
+        ASSERT_TRUE(db->Write(write_option, &batch).ok());
+        batch.Clear();
+      }
+    }
+    delete db;
+    ASSERT_TRUE(ShardedDB::Open(option, sharding, name, &db).ok());
+    std::vector<std::string> keys;
+    for (int i = 0; i < data_size; i++) {
+      keys.push_back(std::to_string(i));
+    }
+    std::vector<std::string_view> key_views(keys.begin(), keys.end());
+    std::vector<std::string> values;
+    std::vector<Status> ret = db->MultiGet(read_option, key_views, &values);
+    ASSERT_EQ(ret.size(), data_size);
+    for (int i = 0; i < data_size; i++) {
+      if (i % 3 == 0) {
+        ASSERT_TRUE(ret[i].IsNotFound());
+      } else {
+        std::snprintf(val, sizeof(val), "%-60d", i);
+        ASSERT_TRUE(ret[i].ok());
+        ASSERT_EQ(values[i], val);
+      }
+    }
+
+    // the writers of the shards are concurrent, each batch is split into
+    // several shards.
+    const int thread_num = 8;
+    const int thread_data_size = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; t++) {
+      threads.emplace_back([&, t] {
+        WriteBatch thread_batch;
+        for (int i = 0; i < thread_data_size; i++) {
+          std::string key = std::to_string(i) + "." + std::to_string(t);
+          thread_batch.Put(key, key);
+          if (i % 10 == 9) {
+            ASSERT_TRUE(db->Write(write_option, &thread_batch).ok());
+            thread_batch.Clear();
+          }
+        }
+      });
+    }
+    for (std::thread& t : threads) {
+      t.join();
+    }
+    keys.clear();
+    for (int t = 0; t < thread_num; t++) {
+      for (int i = 0; i < thread_data_size; i++) {
+        keys.push_back(std::to_string(i) + "." + std::to_string(t));
+      }
+    }
+    key_views.assign(keys.begin(), keys.end());
+    ret = db->MultiGet(read_option, key_views, &values);
+    ASSERT_EQ(ret.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      ASSERT_TRUE(ret[i].ok()) << keys[i];
+      ASSERT_EQ(values[i], keys[i]);
+    }
+    delete db;
+  }
+  range_sharding.boundaries = {"6", "3"};
+  DB* db;
+  ASSERT_TRUE(
+      ShardedDB::Open(option, range_sharding, name, &db).IsInvalidArgument());
+}
+
+TEST(DBTest, ColumnFamilyTest) {
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  Option small_option;
+  small_option.write_mem_size = 16 * 1024;
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+  DestoryDB(option, name);
+  DB* db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  ColumnFamilyHandle* cf;
+  ASSERT_TRUE(db->CreateColumnFamily(small_option, "small", &cf).ok());
+  ASSERT_EQ(cf->GetID(), 1);
+  ASSERT_EQ(cf->GetName(), "small");
+  const size_t data_size = 10000;
+  char val[100];
+  WriteBatch batch;
+  for (int i = 0; i < data_size; i++) {
+    std::snprintf(val, sizeof(val), "%-60d", i);
+    // the records of both column families are written atomically.
+    batch.Put(std::to_string(i), val);
+    batch.Put(cf, std::to_string(i), std::to_string(i));
+    if (i % 3 == 0) {
+      batch.Delete(cf, std::to_string(i));
+    }
+    if (i % 100 == 99) {
+      ASSERT_TRUE(db->Write(write_option, &batch).ok());
+      batch.Clear();
+    }
+  }
+  delete db;
+
+  // every column family must be opened.
+  ASSERT_TRUE(DB::Open(option, name, &db).IsInvalidArgument());
+  std::vector<ColumnFamilyDescriptor> families = {
+      {KDefaultColumnFamilyName, option}, {"small", small_option}};
+  std::vector<ColumnFamilyHandle*> handles;
+  ASSERT_TRUE(DB::Open(option, name, families, &handles, &db).ok());
+  ASSERT_EQ(handles.size(), 2);
+  cf = handles[1];
+  ASSERT_EQ(cf->GetName(), "small");
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    std::snprintf(val, sizeof(val), "%-60d", i);
+    ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+    ASSERT_EQ(result, val);
+    Status s = db->Get(read_option, cf, std::to_string(i), &result);
+    if (i % 3 == 0) {
+      ASSERT_TRUE(s.IsNotFound());
+    } else {
+      ASSERT_TRUE(s.ok());
+      ASSERT_EQ(result, std::to_string(i));
+    }
+  }
+  delete db;
+}
+
+TEST(DBTest, ColumnFamilyGroupWriteTest) {
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  Option small_option;
+  small_option.write_mem_size = 16 * 1024;
+  small_option.l0_stop_write_threshold = 4;
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+  DestoryDB(option, name);
+  DB* db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  ColumnFamilyHandle* cf;
+  ASSERT_TRUE(db->CreateColumnFamily(small_option, "small", &cf).ok());
+  // the writers of both column families are merged into the same groups,
+  // every merged batch must be written to its own column family.
+  const int thread_num = 8;
+  const int data_size = 5000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; t++) {
+    threads.emplace_back([&, t] {
+      ColumnFamilyHandle* family = (t % 2 == 0 ? nullptr : cf);
+      for (int i = 0; i < data_size; i++) {
+        std::string key = std::to_string(t) + "." + std::to_string(i);
+        WriteBatch batch;
+        batch.Put(family, key, key);
+        ASSERT_TRUE(db->Write(write_option, &batch).ok());
+      }
+    });
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  std::string result;
+  for (int t = 0; t < thread_num; t++) {
+    ColumnFamilyHandle* family = (t % 2 == 0 ? nullptr : cf);
+    ColumnFamilyHandle* other = (t % 2 == 0 ? cf : nullptr);
+    for (int i = 0; i < data_size; i++) {
+      std::string key = std::to_string(t) + "." + std::to_string(i);
+      ASSERT_TRUE(db->Get(read_option, family, key, &result).ok()) << key;
+      ASSERT_EQ(result, key);
+      ASSERT_TRUE(db->Get(read_option, other, key, &result).IsNotFound());
+    }
+  }
+  delete db;
+}
+
+TEST(DBTest, MetadataCacheTest) {
+  const size_t capacity = 16 * 1024;
+  std::unique_ptr<Cache> cache(NewLRUCache(capacity, 0.5));
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  option.max_file_size = 64 * 1024;
+  option.metadata_cache = cache.get();
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+  DestoryDB(option, name);
+  DB* db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  const size_t data_size = 20000;
+  char val[100];
+  for (int i = 0; i < data_size; i++) {
+    std::snprintf(val, sizeof(val), "%-80d", i);
+    ASSERT_TRUE(db->Put(write_option, std::to_string(i), val).ok());
+  }
+  delete db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    std::snprintf(val, sizeof(val), "%-80d", i);
+    ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+    ASSERT_EQ(result, val);
+  }
+  // the index blocks are loaded on demand within the capacity.
+  ASSERT_GT(cache->TotalCharge(), 0);
+  ASSERT_LE(cache->TotalCharge(), capacity);
+  delete db;
+  ASSERT_EQ(cache->TotalCharge(), 0);
+}
+
+// the keys of the index block of the sstable "meta", or of its meta
+// index block if "meta_index" is true.
+static std::vector<std::string> SSTableBlockKeys(Env* env,
+                                                 const std::string& name,
+                                                 const FileMeta* meta,
+                                                 bool meta_index) {
+  std::vector<std::string> keys;
+  RandomReadFile* file;
+  if (!env->NewRamdomReadFile(SSTableFileName(name, meta->number), &file)
+           .ok()) {
+    return keys;
+  }
+  char buf[Footer::KEncodeLength];
+  std::string_view result;
+  Footer footer;
+  BlockContents contents;
+  if (file->Read(meta->file_size - Footer::KEncodeLength,
+                 Footer::KEncodeLength, &result, buf)
+          .ok() &&
+      footer.DecodeFrom(&result).ok() &&
+      ReadBlock(ReadOption(), file,
+                meta_index ? footer.GetFilterHandle() : footer.GetIndexHandle(),
+                &contents)
+          .ok()) {
+    BlockReader block(contents);
+    Iterator* iter = block.NewIterator(DefaultComparator());
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      keys.emplace_back(iter->Key());
+    }
+    delete iter;
+  }
+  delete file;
+  return keys;
+}
+
+TEST(DBTest, PartitionedIndexTest) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  std::unique_ptr<Cache> cache(NewLRUCache(64 * 1024));
+  for (Cache* metadata_cache : {static_cast<Cache*>(nullptr), cache.get()}) {
+    Option option;
+    option.write_mem_size = 64 * 1024;
+    option.max_file_size = 64 * 1024;
+    option.index_partition_size = 64;
+    option.filter_policy = policy.get();
+    option.metadata_cache = metadata_cache;
+    WriteOption write_option;
+    ReadOption read_option;
+    const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+    DestoryDB(option, name);
+    DB* db;
+    ASSERT_TRUE(DB::Open(option, name, &db).ok());
+    const int data_size = 20000;
+    for (int i = 0; i < data_size; i++) {
+      ASSERT_TRUE(
+          db->Put(write_option, std::to_string(i), std::to_string(i * 2)).ok());
+    }
+    delete db;
+    ASSERT_TRUE(DB::Open(option, name, &db).ok());
+    // the top level index of a table of several data blocks points to
+    // several partitions.
+    VersionSet* vset = reinterpret_cast<DBImpl*>(db)->TEST_VersionSet();
+    for (int level = 0; level < config::kNumLevels; level++) {
+      for (const FileMeta* meta : vset->LevelFiles(level)) {
+        if (meta->file_size > 16 * 1024) {
+          ASSERT_GT(SSTableBlockKeys(option.env, name, meta, false).size(), 1);
+        }
+      }
+    }
+    const uint64_t last_misses = cache->MissCount();
+    std::string result;
+    for (int i = 0; i < data_size; i++) {
+      ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+      ASSERT_EQ(result, std::to_string(i * 2));
+    }
+    ASSERT_TRUE(db->Get(read_option, "missing", &result).IsNotFound());
+    if (metadata_cache != nullptr) {
+      // the partitions are loaded through the cache.
+      ASSERT_GT(metadata_cache->MissCount(), last_misses);
+      ASSERT_GT(metadata_cache->HitCount(), 0);
+      ASSERT_GT(metadata_cache->TotalCharge(), 0);
+    }
+    delete db;
+    if (metadata_cache != nullptr) {
+      // the partitions of the closed tables are erased with them.
+      ASSERT_EQ(metadata_cache->TotalCharge(), 0);
+    }
+  }
+}
+
+TEST(DBTest, LevelFilterPolicyTest) {
+  std::unique_ptr<const FilterPolicy> bloom(NewBloomFilterPolicy(10));
+  std::unique_ptr<const FilterPolicy> fuse(NewBinaryFuseFilterPolicy(10));
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  option.max_file_size = 64 * 1024;
+  option.level_base_size = 64 * 1024;
+  option.index_partition_size = 1024;
+  // level 0 and 1 with bloom filters, the others with binary fuse filters.
+  option.filter_policy = fuse.get();
+  option.level_filter_policy = {bloom.get(), bloom.get()};
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+  DestoryDB(option, name);
+  DB* db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  const int data_size = 50000;
+  // in scattered order, the files are merged rather than moved to the
+  // next level, so they are written with the policy of their level.
+  for (int i = 0; i < data_size; i++) {
+    const int key = i * 7919 % data_size;
+    ASSERT_TRUE(
+        db->Put(write_option, std::to_string(key), std::to_string(key * 3))
+            .ok());
+  }
+  delete db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+    ASSERT_EQ(result, std::to_string(i * 3));
+  }
+  ASSERT_TRUE(db->Get(read_option, "missing", &result).IsNotFound());
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db);
+  ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+  VersionSet* vset = impl->TEST_VersionSet();
+  // a file moved down without being rewritten keeps the filter of the
+  // level it is written for.
+  const std::string bloom_key =
+      std::string(KPartitionedFilterMetaPrefix) + bloom->Name();
+  const std::string fuse_key =
+      std::string(KPartitionedFilterMetaPrefix) + fuse->Name();
+  int fuse_files = 0;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    for (const FileMeta* meta : vset->LevelFiles(level)) {
+      const std::vector<std::string> keys =
+          SSTableBlockKeys(option.env, name, meta, true);
+      const int is_fuse = std::count(keys.begin(), keys.end(), fuse_key);
+      ASSERT_EQ(std::count(keys.begin(), keys.end(), bloom_key) + is_fuse, 1);
+      ASSERT_TRUE(level >= 2 || is_fuse == 0) << level;
+      fuse_files += is_fuse;
+    }
+  }
+  ASSERT_GT(fuse_files, 0);
+  delete db;
+}
+
+TEST(DBTest, FullFilterTest) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  std::unique_ptr<Cache> cache(NewLRUCache(64 * 1024));
+  for (bool full_filter : {false, true}) {
+    for (Cache* metadata_cache : {static_cast<Cache*>(nullptr), cache.get()}) {
+      Option option;
+      option.write_mem_size = 64 * 1024;
+      option.max_file_size = 64 * 1024;
+      option.filter_policy = policy.get();
+      option.full_filter = full_filter;
+      option.metadata_cache = metadata_cache;
+      WriteOption write_option;
+      ReadOption read_option;
+      const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+      DestoryDB(option, name);
+      DB* db;
+      ASSERT_TRUE(DB::Open(option, name, &db).ok());
+      const int data_size = 20000;
+      for (int i = 0; i < data_size; i += 2) {
+        ASSERT_TRUE(db->Put(write_option, std::to_string(i), "v").ok());
+      }
+      delete db;
+      ASSERT_TRUE(DB::Open(option, name, &db).ok());
+      std::string result;
+      for (int i = 0; i < data_size; i++) {
+        Status s = db->Get(read_option, std::to_string(i), &result);
+        if (i % 2 == 0) {
+          ASSERT_TRUE(s.ok());
+          ASSERT_EQ(result, "v");
+        } else {
+          ASSERT_TRUE(s.IsNotFound());
+        }
+      }
+      delete db;
+    }
+  }
+
+  // the metadata looked up by the Gets of a single table: a Get probes
+  // the full filter once, and only seeks the index if it may match.
+  Option option;
+  option.filter_policy = policy.get();
+  option.full_filter = true;
+  option.metadata_cache = cache.get();
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+  DestoryDB(option, name);
+  DB* db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  const int data_size = 20000;
+  for (int i = 0; i < data_size; i += 2) {
+    ASSERT_TRUE(db->Put(WriteOption(), std::to_string(i), "v").ok());
+  }
+  delete db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  VersionSet* vset = reinterpret_cast<DBImpl*>(db)->TEST_VersionSet();
+  ASSERT_EQ(vset->LevelFileNum(0), 1);
+  std::string result;
+  uint64_t lookups = cache->HitCount() + cache->MissCount();
+  for (int i = 0; i < data_size; i += 2) {
+    ASSERT_TRUE(db->Get(ReadOption(), std::to_string(i), &result).ok());
+  }
+  // the filter and the index
+  ASSERT_EQ(cache->HitCount() + cache->MissCount() - lookups, data_size);
+  lookups = cache->HitCount() + cache->MissCount();
+  for (int i = 1; i < data_size; i += 2) {
+    ASSERT_TRUE(db->Get(ReadOption(), std::to_string(i), &result).IsNotFound());
+  }
+  // the filter, and the index of the false positives
+  const uint64_t negative_lookups =
+      cache->HitCount() + cache->MissCount() - lookups;
+  ASSERT_GE(negative_lookups, data_size / 2);
+  ASSERT_LT(negative_lookups, data_size / 2 * 1.03);
+  delete db;
+}
+
+// the bytes of the full filter of the sstable "meta".
+static uint64_t FullFilterBytes(Env* env, const std::string& name,
+                                const FileMeta* meta) {
+  RandomReadFile* file;
+  if (!env->NewRamdomReadFile(SSTableFileName(name, meta->number), &file)
+           .ok()) {
+    return 0;
+  }
+  char buf[Footer::KEncodeLength];
+  std::string_view result;
+  Footer footer;
+  BlockContents contents;
+  uint64_t bytes = 0;
+  if (file->Read(meta->file_size - Footer::KEncodeLength,
+                 Footer::KEncodeLength, &result, buf)
+          .ok() &&
+      footer.DecodeFrom(&result).ok() &&
+      ReadBlock(ReadOption(), file, footer.GetFilterHandle(), &contents)
+          .ok()) {
+    BlockReader block(contents);
+    Iterator* iter = block.NewIterator(DefaultComparator());
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      if (iter->Key().substr(0, strlen(KFullFilterMetaPrefix)) ==
+          KFullFilterMetaPrefix) {
+        std::string_view value = iter->Value();
+        BlockHandle handle;
+        if (handle.DecodeFrom(&value).ok()) {
+          bytes += handle.GetSize();
+        }
+      }
+    }
+    delete iter;
+  }
+  delete file;
+  return bytes;
+}
+
+TEST(DBTest, LevelFilterBitsTest) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  for (bool skip_bottommost : {false, true}) {
+    Option option;
+    option.write_mem_size = 64 * 1024;
+    option.max_file_size = 64 * 1024;
+    option.level_base_size = 256 * 1024;
+    option.full_filter = true;
+    if (skip_bottommost) {
+      option.filter_policy = policy.get();
+      option.skip_bottommost_filter = true;
+    } else {
+      option.filter_bits_per_key_budget = 8;
+    }
+    WriteOption write_option;
+    ReadOption read_option;
+    const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+    DestoryDB(option, name);
+    DB* db;
+    ASSERT_TRUE(DB::Open(option, name, &db).ok());
+    const int data_size = 50000;
+    for (int i = 0; i < data_size; i += 2) {
+      ASSERT_TRUE(db->Put(write_option, std::to_string(i), "v").ok());
+    }
+    delete db;
+    ASSERT_TRUE(DB::Open(option, name, &db).ok());
+    DBImpl* impl = static_cast<DBImpl*>(db);
+    ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+    std::string result;
+    for (int i = 0; i < data_size; i++) {
+      Status s = db->Get(read_option, std::to_string(i), &result);
+      if (i % 2 == 0) {
+        ASSERT_TRUE(s.ok());
+        ASSERT_EQ(result, "v");
+      } else {
+        ASSERT_TRUE(s.IsNotFound());
+      }
+    }
+    // the bits per key of the filters of each level
+    VersionSet* vset = impl->TEST_VersionSet();
+    std::vector<double> level_bits;
+    uint64_t total_bytes = 0, total_entries = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      uint64_t bytes = 0, entries = 0;
+      for (const FileMeta* meta : vset->LevelFiles(level)) {
+        bytes += FullFilterBytes(option.env, name, meta);
+        entries += meta->num_entries;
+      }
+      if (entries > 0) {
+        level_bits.push_back(bytes * 8.0 / entries);
+      }
+      total_bytes += bytes;
+      total_entries += entries;
+    }
+    ASSERT_FALSE(level_bits.empty());
+    if (skip_bottommost) {
+      ASSERT_EQ(level_bits.back(), 0);
+    } else {
+      // the budget is spent on the levels with keys rather than on the
+      // empty levels below them, the last level has no more bits but
+      // the few bytes of the filter blocks.
+      ASSERT_NEAR(total_bytes * 8.0 / total_entries, 8, 1);
+      ASSERT_LE(level_bits.back(), 9);
+    }
+    delete db;
+  }
+}
+
+// the type byte of the first data block of the sstable "meta", and its
+// uncompressed size.
+static bool FirstDataBlock(Env* env, const std::string& name,
+                           const FileMeta* meta, CompressType* type,
+                           size_t* size) {
+  RandomReadFile* file;
+  if (!env->NewRamdomReadFile(SSTableFileName(name, meta->number), &file)
+           .ok()) {
+    return false;
+  }
+  char buf[Footer::KEncodeLength];
+  std::string_view result;
+  Footer footer;
+  BlockContents index_contents;
+  bool ok = false;
+  if (file->Read(meta->file_size - Footer::KEncodeLength,
+                 Footer::KEncodeLength, &result, buf)
+          .ok() &&
+      footer.DecodeFrom(&result).ok() &&
+      ReadBlock(ReadOption(), file, footer.GetIndexHandle(), &index_contents)
+          .ok()) {
+    BlockReader index_block(index_contents);
+    Iterator* iter = index_block.NewIterator(DefaultComparator());
+    iter->SeekToFirst();
+    BlockHandle handle;
+    std::string_view handle_contents;
+    if (iter->Valid()) {
+      handle_contents = iter->Value();
+    }
+    if (handle.DecodeFrom(&handle_contents).ok()) {
+      std::string stored(handle.GetSize() + 1, '\0');
+      BlockContents contents;
+      if (file->Read(handle.GetOffset(), stored.size(), &result, &stored[0])
+              .ok() &&
+          result.size() == stored.size() &&
+          UncompressBlockContents(result.data(), handle.GetSize(), &contents)
+              .ok()) {
+        *type = static_cast<CompressType>(result[handle.GetSize()]);
+        *size = contents.data.size();
+        delete[] contents.data.data();
+        ok = true;
+      }
+    }
+    delete iter;
+  }
+  delete file;
+  return ok;
+}
+
+TEST(DBTest, LevelCompressionTest) {
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  option.max_file_size = 64 * 1024;
+  option.level_base_size = 64 * 1024;
+  option.level_compress_type = {KUnCompress, KLZ4Compress, KSnappyCompress,
+                                KZSTDCompress};
+  option.level_block_size = {1024, 4 * 1024, 16 * 1024, 8 * 1024};
+  option.zstd_compression_level = 9;
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+  DestoryDB(option, name);
+  DB* db;
+  if (!CompressionSupported(KLZ4Compress) ||
+      !CompressionSupported(KZSTDCompress)) {
+    // the levels would be left uncompressed
+    ASSERT_TRUE(DB::Open(option, name, &db).IsInvalidArgument());
+    return;
+  }
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  const int data_size = 50000;
+  // in scattered order, every compaction merges files rather than
+  // moving them to the next level.
+  for (int i = 0; i < data_size; i++) {
+    const std::string key = std::to_string(i * 7919 % data_size);
+    ASSERT_TRUE(db->Put(write_option, key, key + std::string(20, 'v')).ok());
+  }
+  delete db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    const std::string key = std::to_string(i);
+    ASSERT_TRUE(db->Get(read_option, key, &result).ok());
+    ASSERT_EQ(result, key + std::string(20, 'v'));
+  }
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db);
+  ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+  VersionSet* vset = impl->TEST_VersionSet();
+  // the first data block of a file of several blocks is full, and shows
+  // the compress type and block size of the level the file is written
+  // for, which may be above its level after trivial moves. a block is
+  // left uncompressed if it is not compressed well enough.
+  const std::vector<CompressType>& types = option.level_compress_type;
+  const std::vector<size_t>& sizes = option.level_block_size;
+  std::vector<int> written(types.size(), 0);
+  int zstd_files = 0;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    for (const FileMeta* meta : vset->LevelFiles(level)) {
+      if (meta->file_size <= 2 * sizes[2]) {
+        continue;
+      }
+      CompressType type;
+      size_t size;
+      ASSERT_TRUE(FirstDataBlock(option.env, name, meta, &type, &size));
+      bool matched = false;
+      for (int w = std::min<int>(level, types.size() - 1); w >= 0; w--) {
+        if ((type == types[w] || type == KUnCompress) && size >= sizes[w] &&
+            size < sizes[w] + 64) {
+          written[w]++;
+          matched = true;
+          break;
+        }
+      }
+      ASSERT_TRUE(matched) << level << " " << type << " " << size;
+      zstd_files += (type == KZSTDCompress);
+    }
+  }
+  ASSERT_GT(written[2], 0);
+  ASSERT_GT(written[3], 0);
+  ASSERT_GT(zstd_files, 0);
+  delete db;
+}
+
+TEST(DBTest, CompressionDictTest) {
+  Option option;
+  option.write_mem_size = 64 * 1024;
+  option.max_file_size = 256 * 1024;
+  option.level_base_size = 256 * 1024;
+  option.compress_type = KZSTDCompress;
+  option.zstd_max_dict_bytes = 8 * 1024;
+  option.zstd_max_train_bytes = 128 * 1024;
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+  DestoryDB(option, name);
+  DB* db;
+  if (!CompressionSupported(KZSTDCompress)) {
+    ASSERT_TRUE(DB::Open(option, name, &db).IsInvalidArgument());
+    return;
+  }
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  auto value_of = [](int i) {
+    return "{\"id\":" + std::to_string(i) + ",\"name\":\"user" +
+           std::to_string(i % 97) + "\",\"active\":" +
+           (i % 3 == 0 ? "true" : "false") + "}";
+  };
+  const int data_size = 50000;
+  for (int i = 0; i < data_size; i++) {
+    ASSERT_TRUE(db->Put(write_option, std::to_string(i), value_of(i)).ok());
+  }
+  delete db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  std::string result;
+  for (int i = 0; i < data_size; i++) {
+    ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+    ASSERT_EQ(result, value_of(i));
+  }
+  // the tables of the bottommost level carry the dictionary.
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db);
+  ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+  VersionSet* vset = impl->TEST_VersionSet();
+  int bottommost = config::kNumLevels - 1;
+  while (bottommost > 0 && vset->LevelFiles(bottommost).empty()) {
+    bottommost--;
+  }
+  ASSERT_GT(bottommost, 0);
+  int dict_files = 0;
+  for (const FileMeta* meta : vset->LevelFiles(bottommost)) {
+    const std::vector<std::string> keys =
+        SSTableBlockKeys(option.env, name, meta, true);
+    dict_files += std::count(keys.begin(), keys.end(),
+                             std::string(KCompressionDictMetaKey));
+  }
+  ASSERT_GT(dict_files, 0);
+  delete db;
+}
+
+// write the keys "%08d" of [0, n) with values of their keys into the
+// sstable "filename", return the contents of the file.
+static std::string WriteSSTableContents(const Option& option,
+                                        const std::string& filename, int n) {
+  Env* env = option.env;
+  WritableFile* write_file;
+  if (!env->NewWritableFile(filename, &write_file).ok()) {
+    return std::string();
+  }
+  SSTableBuilder* builder = new SSTableBuilder(option, write_file);
+  char key[16];
+  for (int i = 0; i < n; i++) {
+    std::snprintf(key, sizeof(key), "%08d", i);
+    builder->Add(key, std::string(key) + std::string(50, 'v'));
+  }
+  Status s = builder->Finish();
+  delete builder;
+  if (s.ok()) {
+    s = write_file->Sync();
+  }
+  delete write_file;
+  uint64_t file_size = 0;
+  RandomReadFile* read_file;
+  if (!s.ok() || !env->FileSize(filename, &file_size).ok() ||
+      !env->NewRamdomReadFile(filename, &read_file).ok()) {
+    return std::string();
+  }
+  std::string buf(file_size, '\0');
+  std::string_view result;
+  s = read_file->Read(0, file_size, &result, buf.data());
+  // "result" may point into the mapped file
+  std::string contents = s.ok() ? std::string(result) : std::string();
+  delete read_file;
+  env->RemoveFile(filename);
+  return contents;
+}
+
+TEST(DBTest, ParallelCompressionTest) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  // the filter per data blocks, the full filter, the partitioned filter
+  for (int filter_type = 0; filter_type < 3; filter_type++) {
+    Option option;
+    option.write_mem_size = 64 * 1024;
+    option.max_file_size = 64 * 1024;
+    option.level_base_size = 256 * 1024;
+    option.parallel_threads = 4;
+    option.filter_policy = policy.get();
+    option.full_filter = (filter_type == 1);
+    option.index_partition_size = (filter_type == 2 ? 256 : 0);
+    WriteOption write_option;
+    ReadOption read_option;
+    const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+    DestoryDB(option, name);
+    // the same sstable as written by one thread, byte by byte
+    Option serial_option = option;
+    serial_option.parallel_threads = 1;
+    const std::string serial = WriteSSTableContents(
+        serial_option, "/home/lei/MyLSMKV/folder_for_test/serial_sst", 20000);
+    const std::string parallel = WriteSSTableContents(
+        option, "/home/lei/MyLSMKV/folder_for_test/parallel_sst", 20000);
+    ASSERT_FALSE(serial.empty());
+    ASSERT_TRUE(serial == parallel);
+    DB* db;
+    ASSERT_TRUE(DB::Open(option, name, &db).ok());
+    const int data_size = 50000;
+    for (int i = 0; i < data_size; i += 2) {
+      const std::string key = std::to_string(i);
+      ASSERT_TRUE(db->Put(write_option, key, key + std::string(50, 'v')).ok());
+    }
+    delete db;
+    ASSERT_TRUE(DB::Open(option, name, &db).ok());
+    std::string result;
+    for (int i = 0; i < data_size; i++) {
+      const std::string key = std::to_string(i);
+      Status s = db->Get(read_option, key, &result);
+      if (i % 2 == 0) {
+        ASSERT_TRUE(s.ok());
+        ASSERT_EQ(result, key + std::string(50, 'v'));
+      } else {
+        ASSERT_TRUE(s.IsNotFound());
+      }
+    }
+    delete db;
+  }
+}
+
+TEST(DBTest, CompressedBlockCacheTest) {
+  std::unique_ptr<Cache> cache(NewLRUCache(4 * 1024 * 1024));
+  // the data is in a single sstable after reopen, so no compaction is
+  // triggered by the reads.
+  Option option;
+  option.compressed_block_cache = cache.get();
+  WriteOption write_option;
+  ReadOption read_option;
+  const std::string name = "/home/lei/MyLSMKV/folder_for_test/db_test";
+  DestoryDB(option, name);
+  DB* db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  const int data_size = 20000;
+  for (int i = 0; i < data_size; i++) {
+    const std::string key = std::to_string(i);
+    ASSERT_TRUE(db->Put(write_option, key, key + std::string(50, 'v')).ok());
+  }
+  delete db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  std::string result;
+  uint64_t misses[2];
+  for (int round = 0; round < 2; round++) {
+    const uint64_t last_misses = cache->MissCount();
+    for (int i = 0; i < data_size; i++) {
+      const std::string key = std::to_string(i);
+      ASSERT_TRUE(db->Get(read_option, key, &result).ok());
+      ASSERT_EQ(result, key + std::string(50, 'v'));
+    }
+    misses[round] = cache->MissCount() - last_misses;
+  }
+  // all the blocks are cached by the first round.
+  ASSERT_GT(misses[0], 0);
+  ASSERT_EQ(misses[1], 0);
+  ASSERT_GT(cache->HitCount(), 0);
+  ASSERT_GT(cache->TotalCharge(), 0);
+  delete db;
+
+  // the blocks are keyed by the DB, not by the opened table.
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  uint64_t last_misses = cache->MissCount();
+  for (int i = 0; i < data_size; i++) {
+    ASSERT_TRUE(db->Get(read_option, std::to_string(i), &result).ok());
+  }
+  ASSERT_EQ(cache->MissCount(), last_misses);
+  std::set<uint64_t> old_files;
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db);
+  impl->TEST_VersionSet()->AddLiveFiles(&old_files);
+  ASSERT_FALSE(old_files.empty());
+
+  // the reads without fill_cache do not insert.
+  ReadOption no_fill;
+  no_fill.fill_cache = false;
+  ASSERT_TRUE(db->Put(write_option, "0", "new").ok());
+  delete db;
+  ASSERT_TRUE(DB::Open(option, name, &db).ok());
+  impl = reinterpret_cast<DBImpl*>(db);
+  const size_t charge = cache->TotalCharge();
+  last_misses = cache->MissCount();
+  ASSERT_TRUE(db->Get(no_fill, "0", &result).ok());
+  ASSERT_EQ(result, "new");
+  ASSERT_EQ(cache->MissCount(), last_misses + 1);
+  ASSERT_EQ(cache->TotalCharge(), charge);
+
+  // the compactions do not fill the cache, and the blocks of their
+  // inputs are erased with the files.
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < data_size; i++) {
+      const std::string key = std::to_string(i);
+      ASSERT_TRUE(db->Put(write_option, key, key + std::string(50, 'w')).ok());
+    }
+    ASSERT_TRUE(impl->TEST_WaitForBackgroundWork().ok());
+    std::set<uint64_t> live;
+    impl->TEST_VersionSet()->AddLiveFiles(&live);
+    bool any_old = false;
+    for (uint64_t number : old_files) {
+      any_old = any_old || live.count(number) > 0;
+    }
+    if (!any_old) {
+      break;
+    }
+  }
+  ASSERT_EQ(cache->TotalCharge(), 0);
+  delete db;
+}
+
 const int KthreadNum = 30;
 struct TestState {
   TestState(DB* db) : db(db), rng(std::random_device{}()), done(0) {}
@@ -103,4 +103,150 @@ namespace lsmkv {
         ASSERT_TRUE(!reader.KeyMayMatch(3000,"do"));
         ASSERT_TRUE(!reader.KeyMayMatch(6000,"int"));
     }
-}
\ No newline at end of file
+
+    TEST(FilterTest, CacheLocalTest) {
+        FilterPolicy* legacy_policy = NewBloomFilterPolicy(10);
+        FilterPolicy* policy = NewBloomFilterPolicy(10, true);
+        ASSERT_EQ(std::string(policy->Name()), legacy_policy->Name());
+        const int n = 10000;
+        std::vector<std::string> keys;
+        for (int i = 0; i < n; i++) {
+            keys.push_back(std::to_string(i));
+        }
+        std::vector<std::string_view> key_views(keys.begin(), keys.end());
+        std::string filter, legacy_filter;
+        policy->CreatFilter(key_views.data(), n, &filter);
+        legacy_policy->CreatFilter(key_views.data(), n, &legacy_filter);
+        int false_positives = 0;
+        for (int i = 0; i < n; i++) {
+            ASSERT_TRUE(policy->KeyMayMatch(keys[i], filter));
+            ASSERT_TRUE(legacy_policy->KeyMayMatch(keys[i], filter));
+            // the legacy filter is still readable
+            ASSERT_TRUE(policy->KeyMayMatch(keys[i], legacy_filter));
+            if (policy->KeyMayMatch(std::to_string(i + n), filter)) {
+                false_positives++;
+            }
+        }
+        ASSERT_LT(false_positives, n / 50);
+        delete policy;
+        delete legacy_policy;
+    }
+
+    TEST(FilterTest, BinaryFuseTest) {
+        FilterPolicy* bloom_policy = NewBloomFilterPolicy(10);
+        FilterPolicy* policy = NewBinaryFuseFilterPolicy(7);
+        for (int n : {0, 1, 10, 1000, 100000}) {
+            std::vector<std::string> keys;
+            for (int i = 0; i < n; i++) {
+                keys.push_back(std::to_string(i));
+            }
+            std::vector<std::string_view> key_views(keys.begin(), keys.end());
+            std::string filter, bloom_filter;
+            policy->CreatFilter(key_views.data(), n, &filter);
+            bloom_policy->CreatFilter(key_views.data(), n, &bloom_filter);
+            for (int i = 0; i < n; i++) {
+                ASSERT_TRUE(policy->KeyMayMatch(keys[i], filter));
+            }
+            if (n < 100000) {
+                continue;
+            }
+            int false_positives = 0, bloom_false_positives = 0;
+            for (int i = 0; i < n; i++) {
+                const std::string key = std::to_string(i + n);
+                false_positives += policy->KeyMayMatch(key, filter);
+                bloom_false_positives +=
+                    bloom_policy->KeyMayMatch(key, bloom_filter);
+            }
+            // as accurate as the bloom filter with less memory
+            ASSERT_LE(false_positives, bloom_false_positives * 1.2);
+            ASSERT_LT(filter.size(), bloom_filter.size() * 0.75);
+        }
+        delete policy;
+        delete bloom_policy;
+    }
+
+    TEST(FilterTest, SmallBinaryFuseTest) {
+        FilterPolicy* policy = NewBinaryFuseFilterPolicy(7);
+        for (int n : {20, 40, 100, 1000, 10000}) {
+            size_t total_size = 0;
+            int total_keys = 0, false_positives = 0, probes = 0;
+            for (int f = 0; total_keys < 100000; f++) {
+                std::vector<std::string> keys;
+                for (int i = 0; i < n; i++) {
+                    keys.push_back(std::to_string(f * n + i));
+                }
+                std::vector<std::string_view> key_views(keys.begin(),
+                                                        keys.end());
+                std::string filter;
+                policy->CreatFilter(key_views.data(), n, &filter);
+                for (int i = 0; i < n; i++) {
+                    ASSERT_TRUE(policy->KeyMayMatch(keys[i], filter));
+                }
+                for (int i = 0; i < 1000; i++) {
+                    const std::string key = "x" + std::to_string(i);
+                    false_positives += policy->KeyMayMatch(key, filter);
+                    probes++;
+                }
+                total_size += filter.size();
+                total_keys += n;
+            }
+            // no more than a bloom filter of the false positive rate of
+            // the 6 bits fingerprints (9 bits per key) and its trailer.
+            const double bits_per_key = total_size * 8.0 / total_keys;
+            ASSERT_LE(bits_per_key, 10);
+            ASSERT_LT(static_cast<double>(false_positives) / probes, 0.025);
+            if (n >= 10000) {
+                ASSERT_LT(bits_per_key, 9 * 0.9);
+            }
+        }
+        delete policy;
+    }
+
+    TEST(FilterTest, MonkeyBitsPerKey) {
+        // level-0 is as large as level-1, and every level is 10 times
+        // larger than the upper one.
+        std::vector<uint64_t> sizes = {1, 1};
+        for (int level = 2; level < 7; level++) {
+            sizes.push_back(sizes.back() * 10);
+        }
+        std::vector<int> bits = MonkeyBitsPerKey(10, sizes);
+        ASSERT_EQ(bits.size(), 7);
+        ASSERT_EQ(bits[0], bits[1]);
+        double total_size = 0, total_bits = 0;
+        for (int level = 0; level < 7; level++) {
+            if (level > 1) {
+                ASSERT_LT(bits[level], bits[level - 1]);
+            }
+            total_size += sizes[level];
+            total_bits += sizes[level] * bits[level];
+        }
+        // the most keys are at the last level with less bits
+        ASSERT_LT(bits[6], 10);
+        ASSERT_NEAR(total_bits / total_size, 10, 0.5);
+        // at least 1 bit per key with a small budget
+        for (int b : MonkeyBitsPerKey(1, sizes)) {
+            ASSERT_GE(b, 1);
+        }
+        // only level-0 to level-2 have keys, the budget is spent on them
+        // rather than on the empty levels. the empty levels get the bits
+        // of the next non-empty level, or the last one.
+        sizes = {1, 0, 10, 100, 0, 0, 0};
+        bits = MonkeyBitsPerKey(10, sizes);
+        total_size = 0, total_bits = 0;
+        for (int level = 0; level < 7; level++) {
+            total_size += sizes[level];
+            total_bits += sizes[level] * bits[level];
+        }
+        ASSERT_NEAR(total_bits / total_size, 10, 0.5);
+        ASSERT_GT(bits[0], bits[2]);
+        ASSERT_GT(bits[2], bits[3]);
+        ASSERT_EQ(bits[1], bits[2]);
+        for (int level = 4; level < 7; level++) {
+            ASSERT_EQ(bits[level], bits[3]);
+        }
+        // no keys at all
+        for (int b : MonkeyBitsPerKey(10, std::vector<uint64_t>(7, 0))) {
+            ASSERT_EQ(b, 10);
+        }
+    }
+}
@@ -1,7 +1,13 @@
 #include "gtest/gtest.h"
 #include "db/memtable/memtable.h"
+#include "db/memtable/memtable_bloom.h"
 #include "include/env.h"
+#include "include/prefix_extractor.h"
 #include "iostream"
+#include <cstring>
+#include <map>
+#include <random>
+#include <set>
 
 namespace lsmkv {
  
@@ -46,6 +52,279 @@ namespace lsmkv {
         mem->Unref();
     }
 
+    TEST(MemTableTest, MemTableRepTest) {
+        InternalKeyComparator cmp(DefaultComparator());
+        const PrefixExtractor* prefix_extractor = NewFixedPrefixExtractor(2);
+        for (MemTableRepType rep : {KSkipListRep, KHashSkipListRep, KVectorRep}) {
+            Option option;
+            option.memtable_rep = rep;
+            option.prefix_extractor = prefix_extractor;
+            option.memtable_hash_bucket_num = 64;
+            MemTable* mem = new MemTable(cmp, option);
+            mem->Ref();
+            std::mt19937 rng(std::random_device{}());
+            std::map<std::string, std::string> data;
+            for (int i = 0; i < 2000; i++) {
+                std::string key = std::to_string(rng() % 500);
+                std::string val = std::to_string(i);
+                mem->Put(i, KTypeInsertion, key, val);
+                data[key] = val;
+            }
+            for (int i = 0; i < 500; i++) {
+                LookupKey key(std::to_string(i), 2000);
+                std::string result;
+                Status status;
+                auto it = data.find(std::to_string(i));
+                ASSERT_EQ(mem->Get(key, &result, &status), it != data.end());
+                if (it != data.end()) {
+                    ASSERT_EQ(result, it->second);
+                }
+            }
+            // the iterator is ordered by key, and newer record first
+            Iterator* iter = mem->NewIterator();
+            auto it = data.begin();
+            std::string last_key;
+            for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+                std::string key(ExtractUserKey(iter->Key()));
+                if (key == last_key) {
+                    continue;
+                }
+                ASSERT_TRUE(it != data.end());
+                ASSERT_EQ(key, it->first);
+                ASSERT_EQ(std::string(iter->Value()), it->second);
+                last_key = key;
+                ++it;
+            }
+            ASSERT_TRUE(it == data.end());
+            iter->Seek(LookupKey("250", 2000).InternalKey());
+            ASSERT_TRUE(iter->Valid());
+            ASSERT_EQ(std::string(ExtractUserKey(iter->Key())),
+                      data.lower_bound("250")->first);
+            delete iter;
+            // the reads mixed with writes
+            for (int i = 2000; i < 3000; i++) {
+                std::string key = std::to_string(rng() % 1000);
+                std::string val = std::to_string(i);
+                mem->Put(i, KTypeInsertion, key, val);
+                data[key] = val;
+                LookupKey lookup(key, i);
+                std::string result;
+                Status status;
+                ASSERT_TRUE(mem->Get(lookup, &result, &status));
+                ASSERT_EQ(result, val);
+            }
+            mem->Unref();
+        }
+        delete prefix_extractor;
+    }
+
+    class ReverseComparator : public Comparator {
+     public:
+        int Compare(std::string_view a, std::string_view b) const override {
+            return DefaultComparator()->Compare(b, a);
+        }
+
+        const char* Name() const override { return "ReverseComparator"; }
+
+        void FindShortestMiddle(std::string* start,
+                                std::string_view limit) const override {}
+
+        void FindShortestBigger(std::string* start) const override {}
+    };
+
+    TEST(MemTableTest, InlineKeyPrefixTest) {
+        ReverseComparator reverse;
+        // the keys share the 8 bytes prefix, or only differ in the
+        // trailing '\0' bytes, which are as the padding of short keys.
+        std::vector<std::string> keys;
+        for (int i = 0; i < 200; i++) {
+            keys.push_back("prefix00" + std::to_string(i));
+            keys.push_back(std::string("ab\0\0", 2 + i % 3) +
+                           std::string(i / 3 % 3, '\0'));
+            keys.push_back(std::string("prefix0\0", 8) + std::to_string(i));
+        }
+        for (const Comparator* user_cmp : {DefaultComparator(),
+                                           static_cast<const Comparator*>(
+                                               &reverse)}) {
+            InternalKeyComparator cmp(user_cmp);
+            // the prefix is not in the order of the other comparators
+            ASSERT_EQ(MemTableKeyComparator(cmp).bytewise,
+                      user_cmp == DefaultComparator());
+            MemTable* mem = new MemTable(cmp);
+            mem->Ref();
+            auto less = [user_cmp](const std::string& a, const std::string& b) {
+                return user_cmp->Compare(a, b) < 0;
+            };
+            std::map<std::string, std::string, decltype(less)> data(less);
+            std::mt19937 rng(301);
+            for (int i = 0; i < 3000; i++) {
+                const std::string& key = keys[rng() % keys.size()];
+                mem->Put(i, KTypeInsertion, key, std::to_string(i));
+                data[key] = std::to_string(i);
+            }
+            for (const std::string& key : keys) {
+                LookupKey lookup(key, 3000);
+                std::string result;
+                Status status;
+                auto it = data.find(key);
+                ASSERT_EQ(mem->Get(lookup, &result, &status), it != data.end());
+                if (it != data.end()) {
+                    ASSERT_EQ(result, it->second);
+                }
+            }
+            Iterator* iter = mem->NewIterator();
+            auto it = data.begin();
+            std::string last_key;
+            for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+                std::string key(ExtractUserKey(iter->Key()));
+                if (key == last_key) {
+                    continue;
+                }
+                ASSERT_TRUE(it != data.end());
+                ASSERT_EQ(key, it->first);
+                ASSERT_EQ(std::string(iter->Value()), it->second);
+                last_key = key;
+                ++it;
+            }
+            ASSERT_TRUE(it == data.end());
+            delete iter;
+            mem->Unref();
+        }
+    }
+
+    TEST(MemTableTest, HashSkipListRepUsageTest) {
+        // the buckets are not charged to a memtable smaller than them
+        InternalKeyComparator cmp(DefaultComparator());
+        Option option;
+        option.memtable_rep = KHashSkipListRep;
+        MemTable* mem = new MemTable(cmp, option);
+        mem->Ref();
+        ASSERT_LT(mem->ApproximateSize(), 16 * 1024);
+        mem->Unref();
+    }
+
+    TEST(MemTableTest, MemTableBloomTest) {
+        InternalKeyComparator cmp(DefaultComparator());
+        const PrefixExtractor* prefix_extractor = NewFixedPrefixExtractor(3);
+        for (bool prefix_bloom : {false, true}) {
+            Option option;
+            option.memtable_bloom_size_ratio = 0.1;
+            option.prefix_extractor = prefix_extractor;
+            option.memtable_prefix_bloom = prefix_bloom;
+            MemTable* mem = new MemTable(cmp, option);
+            mem->Ref();
+            const int N = 10000;
+            for (int i = 0; i < N; i++) {
+                mem->Put(i, KTypeInsertion, std::to_string(i), std::to_string(i));
+            }
+            std::string result;
+            Status status;
+            for (int i = 0; i < N; i++) {
+                LookupKey key(std::to_string(i), N);
+                ASSERT_TRUE(mem->Get(key, &result, &status));
+                ASSERT_EQ(result, std::to_string(i));
+            }
+            for (int i = 0; i < N; i++) {
+                LookupKey key("x" + std::to_string(i), N);
+                ASSERT_FALSE(mem->Get(key, &result, &status));
+            }
+            mem->Unref();
+        }
+        delete prefix_extractor;
+    }
+
+    TEST(MemTableTest, MemTableBloomFalsePositiveTest) {
+        // 64 bytes blocks of 10 bits per key, the number of blocks is a
+        // power of 2 or not.
+        for (int num_blocks : {256, 250}) {
+            const int N = num_blocks * 64 * 8 / 10;
+            Arena arena;
+            MemTableBloom bloom(&arena, num_blocks * 64);
+            for (int i = 0; i < N; i++) {
+                bloom.Add(std::to_string(i));
+            }
+            for (int i = 0; i < N; i++) {
+                ASSERT_TRUE(bloom.MayContain(std::to_string(i)));
+            }
+            // the keys with other prefixes
+            int false_positives = 0;
+            for (int i = 0; i < N; i++) {
+                false_positives += bloom.MayContain("x" + std::to_string(i));
+            }
+            ASSERT_LT(false_positives, N * 0.03);
+        }
+    }
+
+    TEST(MemTableTest, InsertHintAndSeekTest) {
+        InternalKeyComparator cmp(DefaultComparator());
+        MemTable* mem = new MemTable(cmp);
+        mem->Ref();
+        std::mt19937 rng(std::random_device{}());
+        std::set<std::string> keys;
+        void* hint = nullptr;
+        char buf[32];
+        // sequential keys, then random keys sharing the same hint
+        for (int i = 0; i < 3000; i++) {
+            std::snprintf(buf, sizeof(buf), "%08d", i < 2000 ? i : static_cast<int>(rng() % 100000));
+            if (keys.insert(buf).second) {
+                mem->Put(i, KTypeInsertion, buf, buf, &hint);
+            }
+        }
+        Iterator* iter = mem->NewIterator();
+        auto it = keys.begin();
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+            ASSERT_TRUE(it != keys.end());
+            ASSERT_EQ(std::string(ExtractUserKey(iter->Key())), *it);
+        }
+        ASSERT_TRUE(it == keys.end());
+        // forward seeks use the finger, backward seeks restart from head
+        for (int i = 0; i < 2000; i++) {
+            int k = (i % 10 == 0 ? rng() % 100000 : i * 50);
+            std::snprintf(buf, sizeof(buf), "%08d", k);
+            iter->Seek(LookupKey(buf, 3000).InternalKey());
+            auto expect = keys.lower_bound(buf);
+            if (expect == keys.end()) {
+                ASSERT_FALSE(iter->Valid());
+            } else {
+                ASSERT_TRUE(iter->Valid());
+                ASSERT_EQ(std::string(ExtractUserKey(iter->Key())), *expect);
+            }
+        }
+        delete iter;
+        mem->Unref();
+    }
+
+    TEST(MemTableTest, ArenaBlockPoolTest) {
+        const size_t block_size = 2 * 1024 * 1024;
+        for (bool huge_page : {false, true}) {
+            ArenaBlockPool pool;
+            pool.Reserve(4 * block_size);
+            Arena* arena = new Arena(block_size, huge_page, &pool);
+            for (int i = 0; i < 3 * 1024; i++) {
+                char* p = arena->Allocate(1024);
+                std::memset(p, i, 1024);
+            }
+            ASSERT_GE(arena->MemoryUsed(), 3 * 1024 * 1024);
+            delete arena;
+            // the blocks are kept in the pool, and reused by the next arena
+            ASSERT_EQ(pool.MemoryUsed(), 2 * block_size);
+            arena = new Arena(block_size, huge_page, &pool);
+            arena->Allocate(1024);
+            ASSERT_EQ(pool.MemoryUsed(), block_size);
+            delete arena;
+            ASSERT_EQ(pool.MemoryUsed(), 2 * block_size);
+            // the blocks over the capacity are freed
+            pool.Release(3 * block_size);
+            ASSERT_EQ(pool.MemoryUsed(), block_size);
+            pool.Release(block_size);
+            ASSERT_EQ(pool.MemoryUsed(), 0);
+        }
+        // a huge page block is not smaller than a huge page
+        Arena arena(4096, true, nullptr);
+        arena.Allocate(1024);
+        ASSERT_GE(arena.MemoryUsed(), Arena::KHugePageSize);
+    }
+
     class ConcurrencyTester {
     public:
         ConcurrencyTester(int N) 